@@ -0,0 +1,127 @@
+#include <AsteroidCatalogue.h>
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+static const double DEGREES = 3.14159265358979323846 / 180.0;
+static const double TWO_PI = 2.0 * 3.14159265358979323846;
+
+// One line's field, 0 if blank
+static double field(const std::string & line, size_t first, size_t length) {
+	return std::atof(line.substr(first, length).c_str());
+}
+
+// Packed MPC date, e.g. K2555 for 2025-05-05, to its Julian day at 0h
+static bool packedEpoch(const std::string & packed, double & day) {
+
+	auto digit = [] (char c) {
+		return c >= '0' && c <= '9' ? c - '0' : (c >= 'A' && c <= 'V' ? c - 'A' + 10 : -1);
+	};
+	int century = packed[0] - 'I' + 18;
+	int month = digit(packed[3]), date = digit(packed[4]);
+	if (century < 18 || century > 21 || packed[1] < '0' || packed[1] > '9' || packed[2] < '0' || packed[2] > '9'
+		|| month < 1 || month > 12 || date < 1)
+		return false;
+	int year = 100 * century + 10 * (packed[1] - '0') + (packed[2] - '0');
+
+	// Meeus, ch. 7
+	if (month <= 2) {
+		year--;
+		month += 12;
+	}
+	int a = year / 100, b = 2 - a + a / 4;
+	day = std::floor(365.25 * (year + 4716)) + std::floor(30.6001 * (month + 1)) + date + b - 1524.5;
+	return true;
+}
+
+AsteroidCatalogue :: AsteroidCatalogue() : vao(0), vbo(0), count(0), epoch(0.0) {
+
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vbo);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	for (int i=0; i<3; i++)
+		glEnableVertexAttribArray(i);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void *) 0);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void *) (4 * sizeof(float)));
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void *) (8 * sizeof(float)));
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+AsteroidCatalogue :: ~AsteroidCatalogue() {
+	glDeleteBuffers(1, &vbo);
+	glDeleteVertexArrays(1, &vao);
+}
+
+bool AsteroidCatalogue :: Load(const std::string & filename) {
+
+	std::ifstream file(filename.c_str());
+	if (!file) {
+		std::cerr << "AsteroidCatalogue::Load: Unable to open " << filename << "\n";
+		return false;
+	}
+
+	std::vector<float> orbits;
+	std::string line;
+	int skipped = 0;
+	count = 0;
+	while (std::getline(file, line)) {
+		// Orbit lines only: the header ends in dashes and blank lines split the file
+		double day;
+		if (line.size() < 103 || line[0] == '-' || !packedEpoch(line.substr(20, 5), day))
+			continue;
+		double h = line.substr(8, 5).find_first_not_of(' ') == std::string::npos ? 20.0 : field(line, 8, 5);
+		double meanAnomaly = field(line, 26, 9) * DEGREES;
+		double perihelion = field(line, 37, 9) * DEGREES;
+		double node = field(line, 48, 9) * DEGREES;
+		double inclination = field(line, 59, 9) * DEGREES;
+		double e = field(line, 70, 9);
+		double motion = field(line, 80, 11) * DEGREES;
+		double a = field(line, 92, 11);
+		if (a <= 0.0 || e < 0.0 || e >= 1.0 || motion <= 0.0) {
+			skipped++;
+			continue;
+		}
+
+		if (count == 0)
+			epoch = day;
+		meanAnomaly = std::fmod(meanAnomaly + motion * (epoch - day), TWO_PI);
+
+		double cw = std::cos(perihelion), sw = std::sin(perihelion);
+		double cn = std::cos(node), sn = std::sin(node);
+		double ci = std::cos(inclination), si = std::sin(inclination);
+		glm::dvec3 p(cw * cn - sw * sn * ci, cw * sn + sw * cn * ci, sw * si);
+		glm::dvec3 q(-sw * cn - cw * sn * ci, -sw * sn + cw * cn * ci, cw * si);
+		p *= a;
+		q *= a * std::sqrt(1.0 - e * e);
+
+		float orbit[10] = {(float) p.x, (float) p.y, (float) p.z, (float) e,
+			(float) q.x, (float) q.y, (float) q.z, (float) h, (float) meanAnomaly, (float) motion};
+		orbits.insert(orbits.end(), orbit, orbit + 10);
+		count++;
+	}
+	if (skipped > 0)
+		std::cerr << "AsteroidCatalogue::Load: Skipped " << skipped << " orbits that are not elliptic in " << filename << "\n";
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, orbits.size() * sizeof(float), orbits.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return true;
+}
+
+void AsteroidCatalogue :: Draw() const {
+
+	if (count == 0)
+		return;
+	glEnable(GL_PROGRAM_POINT_SIZE);
+	glBindVertexArray(vao);
+	glDrawArrays(GL_POINTS, 0, count);
+	glBindVertexArray(0);
+	glDisable(GL_PROGRAM_POINT_SIZE);
+}
@@ -0,0 +1,45 @@
+#ifndef ASTEROID_CATALOGUE_H
+#define ASTEROID_CATALOGUE_H
+
+#include <string>
+
+#include <glad/glad.h>
+
+/**
+* Minor planet orbits (MPC's MPCORB.DAT and NEA.txt format) uploaded once
+* and moved entirely on the GPU: the vertex shader solves Kepler's equation
+* for every asteroid (see shaders/asteroid.vert), so a frame costs the CPU
+* a few uniforms whatever the count.
+*
+* Per asteroid, three attributes:
+*   0  a P and the eccentricity
+*   1  b Q and the absolute magnitude H
+*   2  the mean anomaly at Epoch() and the mean motion, rad/day
+* where P and Q are the J2000 ecliptic unit vectors towards perihelion and
+* 90 degrees on, and b the semi-minor axis, AU. Mean anomalies are carried
+* to a common epoch at load time, so the shader needs only the days since.
+*/
+
+class AsteroidCatalogue {
+
+public:
+	/** Methods */
+	AsteroidCatalogue();
+	~AsteroidCatalogue();
+
+	// Uploads every elliptic orbit of the file, false if it cannot be read
+	bool Load(const std::string & filename);
+
+	int Count() const { return count; }
+	double Epoch() const { return epoch; } // Julian day, TT
+
+	void Draw() const; // GL_POINTS, one per asteroid
+
+private:
+	/** GL Data */
+	GLuint vao, vbo;
+	int count;
+	double epoch;
+};
+
+#endif
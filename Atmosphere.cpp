@@ -0,0 +1,601 @@
+#include <Atmosphere.h>
+#include <ShaderProgram.h>
+#include <ThreadPool.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+static const float PI = 3.14159265358979f;
+static const char ATMOSPHERE_MAGIC[4] = {'A', 'T', 'M', '1'};
+
+AtmosphereParameters AtmosphereParameters :: Earth() {
+
+	// Bruneton's reference values, without ozone
+	AtmosphereParameters p;
+	p.bottomRadius = 6360.0f;
+	p.topRadius = 6420.0f;
+	p.rayleighScattering = glm::vec3(5.802e-3f, 13.558e-3f, 33.1e-3f);
+	p.rayleighScaleHeight = 8.0f;
+	p.mieScattering = 3.996e-3f;
+	p.mieExtinction = 4.44e-3f;
+	p.mieScaleHeight = 1.2f;
+	p.miePhaseG = 0.8f;
+	p.sunAngularRadius = 0.004675f;
+	p.muSMin = -0.2f; // the sun 102 degrees from zenith
+	return p;
+}
+
+/**
+* The model, as in Bruneton's functions.glsl; object.frag and
+* atmosphere.frag repeat the lookups. r is the distance to the planet
+* centre, mu the cosine of the view zenith angle, mu_s of the sun zenith
+* angle and nu of the angle between view and sun.
+*/
+
+static float clampCosine(float mu) {
+	return std::max(-1.0f, std::min(mu, 1.0f));
+}
+
+static float safeSqrt(float a) {
+	return std::sqrt(std::max(a, 0.0f));
+}
+
+static float clampRadius(const AtmosphereParameters & p, float r) {
+	return std::max(p.bottomRadius, std::min(r, p.topRadius));
+}
+
+static float distanceToTop(const AtmosphereParameters & p, float r, float mu) {
+	return std::max(0.0f, -r * mu + safeSqrt(r * r * (mu * mu - 1.0f) + p.topRadius * p.topRadius));
+}
+
+static float distanceToBottom(const AtmosphereParameters & p, float r, float mu) {
+	return std::max(0.0f, -r * mu - safeSqrt(r * r * (mu * mu - 1.0f) + p.bottomRadius * p.bottomRadius));
+}
+
+static bool rayIntersectsGround(const AtmosphereParameters & p, float r, float mu) {
+	return mu < 0.0f && r * r * (mu * mu - 1.0f) + p.bottomRadius * p.bottomRadius >= 0.0f;
+}
+
+// Texel centres at 0 and 1 of the unit range, so the ends are sampled exactly
+static float coordFromUnit(float x, int size) {
+	return 0.5f / size + x * (1.0f - 1.0f / size);
+}
+
+static float unitFromCoord(float u, int size) {
+	return (u - 0.5f / size) / (1.0f - 1.0f / size);
+}
+
+/** Transmittance */
+
+static glm::vec2 transmittanceUv(const AtmosphereParameters & p, float r, float mu) {
+	float H = std::sqrt(p.topRadius * p.topRadius - p.bottomRadius * p.bottomRadius);
+	float rho = safeSqrt(r * r - p.bottomRadius * p.bottomRadius);
+	float d = distanceToTop(p, r, mu);
+	float dMin = p.topRadius - r;
+	float dMax = rho + H;
+	return glm::vec2(
+		coordFromUnit((d - dMin) / (dMax - dMin), Atmosphere::TRANSMITTANCE_WIDTH),
+		coordFromUnit(rho / H, Atmosphere::TRANSMITTANCE_HEIGHT));
+}
+
+static void transmittanceRMu(const AtmosphereParameters & p, glm::vec2 uv, float & r, float & mu) {
+	float xMu = unitFromCoord(uv.x, Atmosphere::TRANSMITTANCE_WIDTH);
+	float xR = unitFromCoord(uv.y, Atmosphere::TRANSMITTANCE_HEIGHT);
+	float H = std::sqrt(p.topRadius * p.topRadius - p.bottomRadius * p.bottomRadius);
+	float rho = H * xR;
+	r = std::sqrt(rho * rho + p.bottomRadius * p.bottomRadius);
+	float dMin = p.topRadius - r;
+	float dMax = rho + H;
+	float d = dMin + xMu * (dMax - dMin);
+	mu = d == 0.0f ? 1.0f : clampCosine((H * H - rho * rho - d * d) / (2.0f * r * d));
+}
+
+static float opticalLength(const AtmosphereParameters & p, float r, float mu, float scaleHeight) {
+	const int SAMPLES = 500;
+	float dx = distanceToTop(p, r, mu) / SAMPLES;
+	float result = 0.0f;
+	for (int i=0; i<=SAMPLES; i++) {
+		float d = i * dx;
+		float ri = std::sqrt(d * d + 2.0f * r * mu * d + r * r);
+		float weight = i == 0 || i == SAMPLES ? 0.5f : 1.0f;
+		result += std::exp(-(ri - p.bottomRadius) / scaleHeight) * weight * dx;
+	}
+	return result;
+}
+
+// Bilinear with clamped edges, as GL_LINEAR and GL_CLAMP_TO_EDGE sample it
+static glm::vec3 sample2D(const std::vector<float> & table, int width, int height, glm::vec2 uv) {
+	float x = uv.x * width - 0.5f, y = uv.y * height - 0.5f;
+	int x0 = (int) std::floor(x), y0 = (int) std::floor(y);
+	float fx = x - x0, fy = y - y0;
+	int xa = std::max(0, std::min(x0, width - 1)), xb = std::max(0, std::min(x0 + 1, width - 1));
+	int ya = std::max(0, std::min(y0, height - 1)), yb = std::max(0, std::min(y0 + 1, height - 1));
+	const float * t = table.data();
+	glm::vec3 a(t[3 * (ya * width + xa)], t[3 * (ya * width + xa) + 1], t[3 * (ya * width + xa) + 2]);
+	glm::vec3 b(t[3 * (ya * width + xb)], t[3 * (ya * width + xb) + 1], t[3 * (ya * width + xb) + 2]);
+	glm::vec3 c(t[3 * (yb * width + xa)], t[3 * (yb * width + xa) + 1], t[3 * (yb * width + xa) + 2]);
+	glm::vec3 d(t[3 * (yb * width + xb)], t[3 * (yb * width + xb) + 1], t[3 * (yb * width + xb) + 2]);
+	return glm::mix(glm::mix(a, b, fx), glm::mix(c, d, fx), fy);
+}
+
+static glm::vec3 transmittanceToTop(const AtmosphereParameters & p, const std::vector<float> & table, float r, float mu) {
+	return sample2D(table, Atmosphere::TRANSMITTANCE_WIDTH, Atmosphere::TRANSMITTANCE_HEIGHT, transmittanceUv(p, r, mu));
+}
+
+static glm::vec3 transmittanceToSun(const AtmosphereParameters & p, const std::vector<float> & table, float r, float muS) {
+	// The fraction of the sun's disc above the horizon
+	float sinH = p.bottomRadius / r;
+	float cosH = -safeSqrt(1.0f - sinH * sinH);
+	float edge = sinH * p.sunAngularRadius;
+	float x = glm::clamp((muS - cosH + edge) / (2.0f * edge), 0.0f, 1.0f);
+	return transmittanceToTop(p, table, r, muS) * (x * x * (3.0f - 2.0f * x));
+}
+
+/** Scattering */
+
+static glm::vec4 scatteringUvwz(const AtmosphereParameters & p, float r, float mu, float muS, float nu, bool ground) {
+
+	float H = std::sqrt(p.topRadius * p.topRadius - p.bottomRadius * p.bottomRadius);
+	float rho = safeSqrt(r * r - p.bottomRadius * p.bottomRadius);
+	float uR = coordFromUnit(rho / H, Atmosphere::SCATTERING_R);
+
+	// Rays to the ground map to [0, 0.5], rays to the sky to [0.5, 1]
+	float rMu = r * mu;
+	float discriminant = rMu * rMu - r * r + p.bottomRadius * p.bottomRadius;
+	float uMu;
+	if (ground) {
+		float d = -rMu - safeSqrt(discriminant);
+		float dMin = r - p.bottomRadius;
+		float dMax = rho;
+		uMu = 0.5f - 0.5f * coordFromUnit(dMax == dMin ? 0.0f : (d - dMin) / (dMax - dMin), Atmosphere::SCATTERING_MU / 2);
+	} else {
+		float d = -rMu + safeSqrt(discriminant + H * H);
+		float dMin = p.topRadius - r;
+		float dMax = rho + H;
+		uMu = 0.5f + 0.5f * coordFromUnit((d - dMin) / (dMax - dMin), Atmosphere::SCATTERING_MU / 2);
+	}
+
+	float d = distanceToTop(p, p.bottomRadius, muS);
+	float dMin = p.topRadius - p.bottomRadius;
+	float dMax = H;
+	float a = (d - dMin) / (dMax - dMin);
+	float A = (distanceToTop(p, p.bottomRadius, p.muSMin) - dMin) / (dMax - dMin);
+	float uMuS = coordFromUnit(std::max(1.0f - a / A, 0.0f) / (1.0f + a), Atmosphere::SCATTERING_MU_S);
+
+	return glm::vec4((nu + 1.0f) * 0.5f, uMuS, uMu, uR);
+}
+
+static void scatteringRMuMuSNu(const AtmosphereParameters & p, glm::vec4 uvwz,
+	float & r, float & mu, float & muS, float & nu, bool & ground) {
+
+	float H = std::sqrt(p.topRadius * p.topRadius - p.bottomRadius * p.bottomRadius);
+	float rho = H * unitFromCoord(uvwz.w, Atmosphere::SCATTERING_R);
+	r = std::sqrt(rho * rho + p.bottomRadius * p.bottomRadius);
+
+	if (uvwz.z < 0.5f) {
+		float dMin = r - p.bottomRadius;
+		float dMax = rho;
+		float d = dMin + (dMax - dMin) * unitFromCoord(1.0f - 2.0f * uvwz.z, Atmosphere::SCATTERING_MU / 2);
+		mu = d == 0.0f ? -1.0f : clampCosine(-(rho * rho + d * d) / (2.0f * r * d));
+		ground = true;
+	} else {
+		float dMin = p.topRadius - r;
+		float dMax = rho + H;
+		float d = dMin + (dMax - dMin) * unitFromCoord(2.0f * uvwz.z - 1.0f, Atmosphere::SCATTERING_MU / 2);
+		mu = d == 0.0f ? 1.0f : clampCosine((H * H - rho * rho - d * d) / (2.0f * r * d));
+		ground = false;
+	}
+
+	float xMuS = unitFromCoord(uvwz.y, Atmosphere::SCATTERING_MU_S);
+	float dMin = p.topRadius - p.bottomRadius;
+	float dMax = H;
+	float A = (distanceToTop(p, p.bottomRadius, p.muSMin) - dMin) / (dMax - dMin);
+	float a = (A - xMuS * A) / (1.0f + xMuS * A);
+	float d = dMin + std::min(a, A) * (dMax - dMin);
+	muS = d == 0.0f ? 1.0f : clampCosine((H * H - d * d) / (2.0f * p.bottomRadius * d));
+
+	nu = clampCosine(uvwz.x * 2.0f - 1.0f);
+}
+
+// Rayleigh and Mie single scattering, without phase functions, for a unit sun
+static glm::vec4 singleScattering(const AtmosphereParameters & p, const std::vector<float> & table,
+	float r, float mu, float muS, float nu, bool ground) {
+
+	const int SAMPLES = 50;
+	float length = ground ? distanceToBottom(p, r, mu) : distanceToTop(p, r, mu);
+	float dx = length / SAMPLES;
+	glm::vec3 toCamera = ground ? glm::vec3(0.0f) : transmittanceToTop(p, table, r, mu);
+	glm::vec3 toCameraGround = ground ? transmittanceToTop(p, table, r, -mu) : glm::vec3(0.0f);
+
+	glm::vec3 rayleigh(0.0f), mie(0.0f);
+	for (int i=0; i<=SAMPLES; i++) {
+		float d = i * dx;
+		float rd = clampRadius(p, std::sqrt(d * d + 2.0f * r * mu * d + r * r));
+		float muD = clampCosine((r * mu + d) / rd);
+		float muSD = clampCosine((r * muS + d * nu) / rd);
+
+		// camera to sample, as a ratio of transmittances to the top (or from the ground)
+		glm::vec3 view = ground
+			? glm::min(transmittanceToTop(p, table, rd, -muD) / glm::max(toCameraGround, glm::vec3(1e-20f)), glm::vec3(1.0f))
+			: glm::min(toCamera / glm::max(transmittanceToTop(p, table, rd, muD), glm::vec3(1e-20f)), glm::vec3(1.0f));
+		glm::vec3 light = view * transmittanceToSun(p, table, rd, muSD);
+
+		float weight = i == 0 || i == SAMPLES ? 0.5f : 1.0f;
+		rayleigh += light * std::exp(-(rd - p.bottomRadius) / p.rayleighScaleHeight) * weight;
+		mie += light * std::exp(-(rd - p.bottomRadius) / p.mieScaleHeight) * weight;
+	}
+	rayleigh *= dx * p.rayleighScattering;
+	mie *= dx * p.mieScattering;
+	return glm::vec4(rayleigh, mie.r);
+}
+
+static glm::vec4 sampleScattering(const AtmosphereParameters & p, const std::vector<float> & table,
+	float r, float mu, float muS, float nu) {
+
+	// Trilinear in (mu_s, mu, r), then linear across the nu slices, as atmosphere.frag does;
+	// rays that reach the ground read the lower half of the mu range
+	bool ground = rayIntersectsGround(p, r, mu);
+	const int W = Atmosphere::SCATTERING_NU * Atmosphere::SCATTERING_MU_S;
+	const int H = Atmosphere::SCATTERING_MU, D = Atmosphere::SCATTERING_R;
+	glm::vec4 uvwz = scatteringUvwz(p, r, mu, muS, nu, ground);
+	float texX = uvwz.x * (Atmosphere::SCATTERING_NU - 1);
+	float sliceX = std::floor(texX);
+	float lerp = texX - sliceX;
+
+	glm::vec4 result(0.0f);
+	for (int s=0; s<2; s++) {
+		float u = (sliceX + s + uvwz.y) / Atmosphere::SCATTERING_NU;
+		float x = u * W - 0.5f, y = uvwz.z * H - 0.5f, z = uvwz.w * D - 0.5f;
+		int x0 = (int) std::floor(x), y0 = (int) std::floor(y), z0 = (int) std::floor(z);
+		float f[3] = {x - x0, y - y0, z - z0};
+		glm::vec4 value(0.0f);
+		for (int c=0; c<8; c++) {
+			int xi = std::max(0, std::min(x0 + (c & 1), W - 1));
+			int yi = std::max(0, std::min(y0 + ((c >> 1) & 1), H - 1));
+			int zi = std::max(0, std::min(z0 + ((c >> 2) & 1), D - 1));
+			float w = ((c & 1) ? f[0] : 1.0f - f[0]) * ((c & 2) ? f[1] : 1.0f - f[1]) * ((c & 4) ? f[2] : 1.0f - f[2]);
+			const float * t = &table[4 * (((size_t) zi * H + yi) * W + xi)];
+			value += w * glm::vec4(t[0], t[1], t[2], t[3]);
+		}
+		result += value * (s == 0 ? 1.0f - lerp : lerp);
+	}
+	return result;
+}
+
+static float rayleighPhase(float nu) {
+	return 3.0f / (16.0f * PI) * (1.0f + nu * nu);
+}
+
+static float miePhase(float g, float nu) {
+	float k = 3.0f / (8.0f * PI) * (1.0f - g * g) / (2.0f + g * g);
+	return k * (1.0f + nu * nu) / std::pow(1.0f + g * g - 2.0f * g * nu, 1.5f);
+}
+
+/** Atmosphere */
+
+Atmosphere :: Atmosphere(const AtmosphereParameters & parameters, const std::string & cacheFile, unsigned int threads)
+	: parameters(parameters), precomputeSeconds(0.0),
+	center(0.0f), kmPerUnit(1.0f), sunDirection(0.0f, 1.0f, 0.0f), width(0), height(0),
+	fbo(0), vao(0)
+{
+	tables[0] = tables[1] = tables[2] = 0;
+	targets[0] = targets[1] = 0;
+
+	if (cacheFile.empty() || !readCache(cacheFile)) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		ThreadPool pool(threads);
+		precompute(pool);
+		precomputeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "Atmosphere::Atmosphere: tables computed in " << precomputeSeconds << " s\n";
+		if (!cacheFile.empty())
+			writeCache(cacheFile);
+	}
+
+	setup();
+}
+
+Atmosphere :: ~Atmosphere() {
+	glDeleteTextures(3, tables);
+	glDeleteTextures(2, targets);
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteVertexArrays(1, &vao);
+}
+
+void Atmosphere :: precompute(ThreadPool & pool) {
+
+	const AtmosphereParameters & p = parameters;
+
+	// Transmittance to the top of the atmosphere, everything else reads it
+	transmittance.assign(3 * TRANSMITTANCE_WIDTH * TRANSMITTANCE_HEIGHT, 0.0f);
+	pool.ParallelFor(0, TRANSMITTANCE_HEIGHT, [&](int begin, int end) {
+		for (int y=begin; y<end; y++)
+			for (int x=0; x<TRANSMITTANCE_WIDTH; x++) {
+				float r, mu;
+				transmittanceRMu(p, glm::vec2((x + 0.5f) / TRANSMITTANCE_WIDTH, (y + 0.5f) / TRANSMITTANCE_HEIGHT), r, mu);
+				glm::vec3 t = glm::exp(-(p.rayleighScattering * opticalLength(p, r, mu, p.rayleighScaleHeight)
+					+ glm::vec3(p.mieExtinction * opticalLength(p, r, mu, p.mieScaleHeight))));
+				float * texel = &transmittance[3 * (y * TRANSMITTANCE_WIDTH + x)];
+				texel[0] = t.r; texel[1] = t.g; texel[2] = t.b;
+			}
+	});
+
+	// Single scattering, one r slice of the 3D texture per task
+	const int W = SCATTERING_NU * SCATTERING_MU_S;
+	scattering.assign(4 * (size_t) W * SCATTERING_MU * SCATTERING_R, 0.0f);
+	pool.ParallelFor(0, SCATTERING_R, [&](int begin, int end) {
+		for (int z=begin; z<end; z++)
+			for (int y=0; y<SCATTERING_MU; y++)
+				for (int x=0; x<W; x++) {
+					int sliceNu = x / SCATTERING_MU_S, texelMuS = x % SCATTERING_MU_S;
+					glm::vec4 uvwz(
+						sliceNu / (SCATTERING_NU - 1.0f),
+						(texelMuS + 0.5f) / SCATTERING_MU_S,
+						(y + 0.5f) / SCATTERING_MU,
+						(z + 0.5f) / SCATTERING_R);
+					float r, mu, muS, nu;
+					bool ground;
+					scatteringRMuMuSNu(p, uvwz, r, mu, muS, nu, ground);
+					// nu is bounded by mu and mu_s
+					float spread = std::sqrt((1.0f - mu * mu) * (1.0f - muS * muS));
+					nu = std::max(mu * muS - spread, std::min(nu, mu * muS + spread));
+
+					glm::vec4 s = singleScattering(p, transmittance, r, mu, muS, nu, ground);
+					float * texel = &scattering[4 * (((size_t) z * SCATTERING_MU + y) * W + x)];
+					texel[0] = s.r; texel[1] = s.g; texel[2] = s.b; texel[3] = s.a;
+				}
+	});
+
+	// Sky irradiance on a horizontal surface, the hemisphere integral of the scattering above
+	irradiance.assign(3 * IRRADIANCE_WIDTH * IRRADIANCE_HEIGHT, 0.0f);
+	pool.ParallelFor(0, IRRADIANCE_HEIGHT, [&](int begin, int end) {
+		const int SAMPLES = 32;
+		const float dPhi = PI / SAMPLES, dTheta = PI / SAMPLES;
+		for (int y=begin; y<end; y++)
+			for (int x=0; x<IRRADIANCE_WIDTH; x++) {
+				float xMuS = unitFromCoord((x + 0.5f) / IRRADIANCE_WIDTH, IRRADIANCE_WIDTH);
+				float xR = unitFromCoord((y + 0.5f) / IRRADIANCE_HEIGHT, IRRADIANCE_HEIGHT);
+				float r = p.bottomRadius + xR * (p.topRadius - p.bottomRadius);
+				float muS = clampCosine(2.0f * xMuS - 1.0f);
+				glm::vec3 sun(safeSqrt(1.0f - muS * muS), 0.0f, muS);
+
+				glm::vec3 result(0.0f);
+				for (int j=0; j<SAMPLES / 2; j++) {
+					float theta = (j + 0.5f) * dTheta;
+					for (int i=0; i<2 * SAMPLES; i++) {
+						float phi = (i + 0.5f) * dPhi;
+						glm::vec3 omega(std::cos(phi) * std::sin(theta), std::sin(phi) * std::sin(theta), std::cos(theta));
+						float nu = glm::dot(omega, sun);
+						glm::vec4 s = sampleScattering(p, scattering, r, omega.z, muS, nu);
+						glm::vec3 mie = s.r > 0.0f
+							? glm::vec3(s) * (s.a / s.r) * (p.rayleighScattering.r / p.mieScattering) * (glm::vec3(p.mieScattering) / p.rayleighScattering)
+							: glm::vec3(0.0f);
+						glm::vec3 radiance = glm::vec3(s) * rayleighPhase(nu) + mie * miePhase(p.miePhaseG, nu);
+						result += radiance * omega.z * std::sin(theta) * dTheta * dPhi;
+					}
+				}
+				float * texel = &irradiance[3 * (y * IRRADIANCE_WIDTH + x)];
+				texel[0] = result.r; texel[1] = result.g; texel[2] = result.b;
+			}
+	});
+}
+
+bool Atmosphere :: readCache(const std::string & filename) {
+
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	char magic[4];
+	uint32_t sizes[8];
+	AtmosphereParameters cached;
+	file.read(magic, sizeof(magic));
+	file.read((char*)sizes, sizeof(sizes));
+	file.read((char*)&cached, sizeof(cached));
+
+	// Stale when the layout or any parameter changed
+	const uint32_t expected[8] = {TRANSMITTANCE_WIDTH, TRANSMITTANCE_HEIGHT, SCATTERING_R, SCATTERING_MU,
+		SCATTERING_MU_S, SCATTERING_NU, IRRADIANCE_WIDTH, IRRADIANCE_HEIGHT};
+	if (!file || std::memcmp(magic, ATMOSPHERE_MAGIC, sizeof(magic)) != 0
+		|| std::memcmp(sizes, expected, sizeof(sizes)) != 0
+		|| std::memcmp(&cached, &parameters, sizeof(cached)) != 0)
+		return false;
+
+	transmittance.resize(3 * TRANSMITTANCE_WIDTH * TRANSMITTANCE_HEIGHT);
+	scattering.resize(4 * (size_t) SCATTERING_NU * SCATTERING_MU_S * SCATTERING_MU * SCATTERING_R);
+	irradiance.resize(3 * IRRADIANCE_WIDTH * IRRADIANCE_HEIGHT);
+	for (std::vector<float> * table : {&transmittance, &scattering, &irradiance})
+		file.read((char*)table->data(), table->size() * sizeof(float));
+
+	if (!file) {
+		std::cerr << "Atmosphere::readCache: Truncated cache: " << filename << "\n";
+		return false;
+	}
+	return true;
+}
+
+void Atmosphere :: writeCache(const std::string & filename) const {
+
+	std::ofstream file(filename, std::ios::out | std::ios::binary);
+	if (!file.is_open()) {
+		std::cerr << "Atmosphere::writeCache: Unable to open: " << filename << "\n";
+		return;
+	}
+
+	const uint32_t sizes[8] = {TRANSMITTANCE_WIDTH, TRANSMITTANCE_HEIGHT, SCATTERING_R, SCATTERING_MU,
+		SCATTERING_MU_S, SCATTERING_NU, IRRADIANCE_WIDTH, IRRADIANCE_HEIGHT};
+	file.write(ATMOSPHERE_MAGIC, sizeof(ATMOSPHERE_MAGIC));
+	file.write((const char*)sizes, sizeof(sizes));
+	file.write((const char*)&parameters, sizeof(parameters));
+	for (const std::vector<float> * table : {&transmittance, &scattering, &irradiance})
+		file.write((const char*)table->data(), table->size() * sizeof(float));
+}
+
+void Atmosphere :: setup() {
+
+	glGenTextures(3, tables);
+
+	glBindTexture(GL_TEXTURE_2D, tables[0]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, TRANSMITTANCE_WIDTH, TRANSMITTANCE_HEIGHT, 0, GL_RGB, GL_FLOAT, transmittance.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glBindTexture(GL_TEXTURE_3D, tables[1]);
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, SCATTERING_NU * SCATTERING_MU_S, SCATTERING_MU, SCATTERING_R,
+		0, GL_RGBA, GL_FLOAT, scattering.data());
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	glBindTexture(GL_TEXTURE_2D, tables[2]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, IRRADIANCE_WIDTH, IRRADIANCE_HEIGHT, 0, GL_RGB, GL_FLOAT, irradiance.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// The passes draw one triangle from gl_VertexID, core profile still wants a vertex array
+	glGenVertexArrays(1, &vao);
+	glGenFramebuffers(1, &fbo);
+	glGenTextures(2, targets);
+}
+
+void Atmosphere :: Resize(int width, int height) {
+
+	if (width == this->width && height == this->height)
+		return;
+	this->width = width;
+	this->height = height;
+
+	int halfWidth = std::max(1, (width + 1) / 2), halfHeight = std::max(1, (height + 1) / 2);
+	for (GLuint target : targets) {
+		glBindTexture(GL_TEXTURE_2D, target);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, halfWidth, halfHeight, 0, GL_RGBA, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GLint previous;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, targets[0], 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, targets[1], 0);
+	const GLenum buffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+	glDrawBuffers(2, buffers);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cerr << "Atmosphere::Resize: Incomplete framebuffer\n";
+	glBindFramebuffer(GL_FRAMEBUFFER, previous);
+}
+
+void Atmosphere :: SetPlanet(const glm::vec3 & center, float radius, const glm::vec3 & sunDirection) {
+	this->center = center;
+	this->kmPerUnit = parameters.bottomRadius / radius;
+	this->sunDirection = glm::normalize(sunDirection);
+}
+
+void Atmosphere :: setPlanetUniforms(Shader & shader) const {
+
+	shader.setUniform("uAtmosphere.center", center);
+	shader.setUniform("uAtmosphere.kmPerUnit", kmPerUnit);
+	shader.setUniform("uAtmosphere.sunDirection", sunDirection);
+	shader.setUniform("uAtmosphere.bottomRadius", parameters.bottomRadius);
+	shader.setUniform("uAtmosphere.topRadius", parameters.topRadius);
+	shader.setUniform("uAtmosphere.rayleighScattering", parameters.rayleighScattering);
+	shader.setUniform("uAtmosphere.mieScattering", parameters.mieScattering);
+	shader.setUniform("uAtmosphere.miePhaseG", parameters.miePhaseG);
+	shader.setUniform("uAtmosphere.sunAngularRadius", parameters.sunAngularRadius);
+	shader.setUniform("uAtmosphere.muSMin", parameters.muSMin);
+	shader.setUniform("uTransmittance", (int) UNIT_TRANSMITTANCE);
+	shader.setUniform("uScattering", (int) UNIT_SCATTERING);
+	shader.setUniform("uIrradiance", (int) UNIT_IRRADIANCE);
+
+	glActiveTexture(GL_TEXTURE0 + UNIT_TRANSMITTANCE);
+	glBindTexture(GL_TEXTURE_2D, tables[0]);
+	glActiveTexture(GL_TEXTURE0 + UNIT_SCATTERING);
+	glBindTexture(GL_TEXTURE_3D, tables[1]);
+	glActiveTexture(GL_TEXTURE0 + UNIT_IRRADIANCE);
+	glBindTexture(GL_TEXTURE_2D, tables[2]);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void Atmosphere :: SetUniforms(Shader & shader) const {
+	setPlanetUniforms(shader);
+}
+
+void Atmosphere :: Draw(Shader & scatterShader, Shader & compositeShader,
+	const glm::mat4 & view, const glm::mat4 & projection, const glm::vec3 & cameraPosition,
+	float exposure, float gamma) {
+
+	glm::mat4 viewProjection = projection * view;
+	glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+	glm::vec3 camera = (cameraPosition - center) * kmPerUnit;
+	int halfWidth = std::max(1, (width + 1) / 2), halfHeight = std::max(1, (height + 1) / 2);
+
+	GLint previous, viewport[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glBindVertexArray(vao);
+
+	// Half resolution: in-scatter and transmittance along every view ray
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, halfWidth, halfHeight);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	scatterShader.use();
+	setPlanetUniforms(scatterShader);
+	scatterShader.setUniform("uInverseViewProjection", inverseViewProjection);
+	scatterShader.setUniform("uCamera", camera);
+	scatterShader.setUniform("uTargetSize", glm::vec2((float) halfWidth, (float) halfHeight));
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	// Full resolution: upsample over the scene, colour * transmittance + in-scatter.
+	// Fragments take the depth where their ray enters the atmosphere, so bodies in
+	// front of it stay untouched
+	glBindFramebuffer(GL_FRAMEBUFFER, previous);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_FALSE);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_SRC1_COLOR);
+	compositeShader.use();
+	compositeShader.setUniform("uAtmosphere.center", center);
+	compositeShader.setUniform("uAtmosphere.kmPerUnit", kmPerUnit);
+	compositeShader.setUniform("uAtmosphere.bottomRadius", parameters.bottomRadius);
+	compositeShader.setUniform("uAtmosphere.topRadius", parameters.topRadius);
+	compositeShader.setUniform("uInverseViewProjection", inverseViewProjection);
+	compositeShader.setUniform("uViewProjection", viewProjection);
+	compositeShader.setUniform("uCamera", camera);
+	compositeShader.setUniform("uTargetSize", glm::vec2((float) viewport[2], (float) viewport[3]));
+	compositeShader.setUniform("uHalfInscatter", (int) UNIT_HALF_INSCATTER);
+	compositeShader.setUniform("uHalfTransmittance", (int) UNIT_HALF_TRANSMITTANCE);
+	compositeShader.setUniform("uExposure", exposure);
+	compositeShader.setUniform("uGamma", gamma);
+	glActiveTexture(GL_TEXTURE0 + UNIT_HALF_INSCATTER);
+	glBindTexture(GL_TEXTURE_2D, targets[0]);
+	glActiveTexture(GL_TEXTURE0 + UNIT_HALF_TRANSMITTANCE);
+	glBindTexture(GL_TEXTURE_2D, targets[1]);
+	glActiveTexture(GL_TEXTURE0);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_TRUE);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,121 @@
+#ifndef ATMOSPHERE_H
+#define ATMOSPHERE_H
+
+#include <vector>
+#include <string>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <ShaderProgram.h>
+#include <ThreadPool.h>
+
+/**
+* Precomputed atmospheric scattering after Bruneton and Neyret, with the
+* texture parametrisation of Bruneton's 2017 reference implementation.
+* Three lookup tables are computed once on the CPU, spread over a thread
+* pool, and cached to disk:
+*
+*   transmittance  T(r, mu)                 2D, 256 x 64
+*   scattering     S(r, mu, mu_s, nu)       4D packed in 3D, (8 * 32) x 128 x 32,
+*                                           Rayleigh rgb and Mie red in alpha
+*   irradiance     E(r, mu_s)               2D, 64 x 16, sky light on the ground
+*
+* Single scattering only; the sun's own irradiance is computed from the
+* transmittance table where it is needed. Distances are in km about the
+* planet centre; the scene maps the planet's bottom radius onto the globe.
+*
+* Draw() renders the sky and aerial perspective at half resolution into
+* two targets (in-scattered light, transmittance), then upsamples them
+* bilaterally over the frame with dual-source blending:
+* colour = scene * transmittance + in-scatter. Each pixel costs a few
+* table fetches and no ray march.
+*/
+
+struct AtmosphereParameters {
+	float bottomRadius;      // km
+	float topRadius;
+	glm::vec3 rayleighScattering; // per km at sea level
+	float rayleighScaleHeight;    // km
+	float mieScattering;
+	float mieExtinction;
+	float mieScaleHeight;
+	float miePhaseG;
+	float sunAngularRadius;  // radians
+	float muSMin;            // lowest sun cosine tabulated
+
+	static AtmosphereParameters Earth();
+};
+
+class Atmosphere {
+
+public:
+	/** Table sizes */
+	static const int TRANSMITTANCE_WIDTH  = 256; // mu
+	static const int TRANSMITTANCE_HEIGHT = 64;  // r
+	static const int SCATTERING_R    = 32;
+	static const int SCATTERING_MU   = 128;
+	static const int SCATTERING_MU_S = 32;
+	static const int SCATTERING_NU   = 8;
+	static const int IRRADIANCE_WIDTH  = 64; // mu_s
+	static const int IRRADIANCE_HEIGHT = 16; // r
+
+	// Clear of materials (1-3), clusters (11-13), shadows (14) and skybox (15)
+	static const GLuint UNIT_HALF_INSCATTER     = 4;
+	static const GLuint UNIT_HALF_TRANSMITTANCE = 5;
+	static const GLuint UNIT_TRANSMITTANCE = 8;
+	static const GLuint UNIT_SCATTERING    = 9;
+	static const GLuint UNIT_IRRADIANCE    = 10;
+
+	/** Methods */
+	// Loads the tables from cacheFile when it holds these parameters, otherwise
+	// computes and writes them there (no cache if empty)
+	Atmosphere(const AtmosphereParameters & parameters = AtmosphereParameters::Earth(),
+		const std::string & cacheFile = "", unsigned int threads = 0);
+	~Atmosphere();
+
+	// Framebuffer size in pixels, the half resolution targets follow it
+	void Resize(int width, int height);
+
+	// The planet as the scene places it: world centre and the world radius
+	// that bottomRadius maps to; sunDirection points towards the sun
+	void SetPlanet(const glm::vec3 & center, float radius, const glm::vec3 & sunDirection);
+
+	// Tables and planet for shading the ground in object.frag
+	void SetUniforms(Shader & shader) const;
+
+	// Over the current framebuffer, after the scene and before translucent layers
+	void Draw(Shader & scatterShader, Shader & compositeShader,
+		const glm::mat4 & view, const glm::mat4 & projection, const glm::vec3 & cameraPosition,
+		float exposure, float gamma);
+
+	double PrecomputeSeconds() const { return precomputeSeconds; } // 0 when loaded from cache
+
+private:
+	AtmosphereParameters parameters;
+
+	/** Table Data, RGB(A) float */
+	std::vector<float> transmittance;
+	std::vector<float> scattering;
+	std::vector<float> irradiance;
+	double precomputeSeconds;
+
+	/** Scene */
+	glm::vec3 center;
+	float kmPerUnit;
+	glm::vec3 sunDirection;
+	int width, height;
+
+	/** GL Data */
+	GLuint tables[3];   // transmittance, scattering, irradiance
+	GLuint fbo, targets[2], vao;
+
+	/** Methods */
+	void precompute(ThreadPool & pool);
+	bool readCache(const std::string & filename);
+	void writeCache(const std::string & filename) const;
+	void setup();
+	void setPlanetUniforms(Shader & shader) const;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include <CloudLayer.h>
+#include <ShaderProgram.h>
+#include <Culling.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <algorithm>
+
+CloudLayer :: CloudLayer(CloudResolution resolution)
+	: resolution(resolution), width(0), height(0), lowWidth(0), lowHeight(0),
+	fbo(0), vao(0), previousFbo(0)
+{
+	glGenTextures(2, targets);
+	glGenFramebuffers(1, &fbo);
+	// The composite draws one triangle from gl_VertexID, core profile still wants a vertex array
+	glGenVertexArrays(1, &vao);
+}
+
+CloudLayer :: ~CloudLayer() {
+	glDeleteTextures(2, targets);
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteVertexArrays(1, &vao);
+}
+
+void CloudLayer :: Resize(int width, int height) {
+
+	if (width == this->width && height == this->height)
+		return;
+	this->width = width;
+	this->height = height;
+	allocate();
+}
+
+void CloudLayer :: SetResolution(CloudResolution resolution) {
+
+	if (resolution == this->resolution)
+		return;
+	this->resolution = resolution;
+	allocate();
+}
+
+glm::ivec2 CloudLayer :: TargetSize() const {
+	return resolution == CLOUDS_FULL ? glm::ivec2(width, height) : glm::ivec2(lowWidth, lowHeight);
+}
+
+void CloudLayer :: allocate() {
+
+	// Nothing to hold at full resolution, the shell goes straight to the frame
+	if (resolution == CLOUDS_FULL || width <= 0 || height <= 0)
+		return;
+
+	int scale = (int) resolution;
+	lowWidth = std::max(1, (width + scale - 1) / scale);
+	lowHeight = std::max(1, (height + scale - 1) / scale);
+
+	const GLint formats[2] = {GL_RGBA16F, GL_R32F};
+	const GLenum layouts[2] = {GL_RGBA, GL_RED};
+	for (int i=0; i<2; i++) {
+		glBindTexture(GL_TEXTURE_2D, targets[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, formats[i], lowWidth, lowHeight, 0, layouts[i], GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GLint previous;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, targets[0], 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, targets[1], 0);
+	const GLenum buffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+	glDrawBuffers(2, buffers);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cerr << "CloudLayer::allocate: Incomplete framebuffer\n";
+	glBindFramebuffer(GL_FRAMEBUFFER, previous);
+}
+
+void CloudLayer :: Begin() {
+
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+	// Zero coverage and distance where the shell is not drawn. The shell is
+	// convex and culled to its front faces, so it covers a texel at most once:
+	// no depth test and no blending; bodies in front are handled by Composite()
+	GLfloat clearColor[4];
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, lowWidth, lowHeight);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+}
+
+void CloudLayer :: End() {
+
+	glEnable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+}
+
+void CloudLayer :: Composite(Shader & compositeShader, const glm::mat4 & view, const glm::mat4 & projection,
+	const glm::vec3 & cameraPosition, const Bounds & shell) {
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glm::mat4 viewProjection = projection * view;
+
+	// Premultiplied over the scene, depth tested at the shell but not written
+	glDepthMask(GL_FALSE);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	compositeShader.use();
+	compositeShader.setUniform("uInverseViewProjection", glm::inverse(viewProjection));
+	compositeShader.setUniform("uViewProjection", viewProjection);
+	compositeShader.setUniform("uCameraPos", cameraPosition);
+	compositeShader.setUniform("uShell", glm::vec4(shell.center, shell.radius));
+	compositeShader.setUniform("uTargetSize", glm::vec2((float) viewport[2], (float) viewport[3]));
+	compositeShader.setUniform("uLowColor", (int) UNIT_LOW_COLOR);
+	compositeShader.setUniform("uLowDistance", (int) UNIT_LOW_DISTANCE);
+	glActiveTexture(GL_TEXTURE0 + UNIT_LOW_COLOR);
+	glBindTexture(GL_TEXTURE_2D, targets[0]);
+	glActiveTexture(GL_TEXTURE0 + UNIT_LOW_DISTANCE);
+	glBindTexture(GL_TEXTURE_2D, targets[1]);
+	glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(vao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_TRUE);
+}
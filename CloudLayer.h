@@ -0,0 +1,68 @@
+#ifndef CLOUD_LAYER_H
+#define CLOUD_LAYER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <ShaderProgram.h>
+#include <Culling.h>
+
+/**
+* Offscreen target of the cloud shell. The shell is the Earth's translucent
+* mesh, drawn with its own shader (shaders/cloud.frag) that writes
+* premultiplied colour and the distance from the camera.
+*
+* At full resolution the shell is drawn straight over the frame. At half or
+* quarter resolution it is drawn between Begin() and End() into a smaller
+* target, then Composite() upsamples it with a fullscreen pass: every pixel
+* intersects the shell sphere analytically, takes that depth (so bodies in
+* front keep the clouds off them) and weights the four nearest low
+* resolution texels by how well their distance matches its own.
+*/
+
+enum CloudResolution {
+	CLOUDS_FULL    = 1,
+	CLOUDS_HALF    = 2,
+	CLOUDS_QUARTER = 4
+};
+
+class CloudLayer {
+
+public:
+	// Clear of materials (1-3) and the atmosphere's targets (4, 5) and tables (8-10)
+	static const GLuint UNIT_LOW_COLOR    = 6;
+	static const GLuint UNIT_LOW_DISTANCE = 7;
+
+	/** Methods */
+	CloudLayer(CloudResolution resolution = CLOUDS_HALF);
+	~CloudLayer();
+
+	// Framebuffer size in pixels, the low resolution target follows it
+	void Resize(int width, int height);
+	void SetResolution(CloudResolution resolution);
+	CloudResolution Resolution() const { return resolution; }
+	// Pixels the shell is drawn into: the framebuffer at full resolution, else the target
+	glm::ivec2 TargetSize() const;
+
+	// Low resolution only: binds and clears the target, the shell is drawn in between
+	void Begin();
+	void End();
+
+	// Over the current framebuffer; shell is the cloud sphere in world space
+	void Composite(Shader & compositeShader, const glm::mat4 & view, const glm::mat4 & projection,
+		const glm::vec3 & cameraPosition, const Bounds & shell);
+
+private:
+	CloudResolution resolution;
+	int width, height;       // framebuffer
+	int lowWidth, lowHeight; // target
+
+	/** GL Data */
+	GLuint fbo, targets[2], vao; // premultiplied colour, distance
+	GLint previousFbo, previousViewport[4];
+
+	/** Methods */
+	void allocate();
+};
+
+#endif
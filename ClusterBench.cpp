@@ -0,0 +1,106 @@
+/**
+* Light clustering benchmark: assigns random point lights to froxels with
+* LightClusters on one thread and on every hardware thread, then samples
+* random points in the view frustum and checks that every light whose
+* range reaches a point is in the list of the froxel object.frag would
+* read there. The assignment is the CPU half of Build() and needs no GL
+* context.
+*
+* Usage:
+*   ./ClusterBench.exe [lights] [samples]
+*
+*   4000 lights and 200000 samples by default.
+*/
+
+#include <LightClusters.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+static const float FOV_Y = glm::radians(45.0f);
+static const float ASPECT = 16.0f / 9.0f;
+static const float NEAR_PLANE = 0.1f;
+static const float FAR_PLANE = 100.0f;
+static const int REPEATS = 20;
+
+static double timeAssign(LightClusters & clusters, const std::vector<ClusterLight> & lights, const glm::mat4 & view) {
+	clusters.Assign(lights, view, FOV_Y, ASPECT, NEAR_PLANE, FAR_PLANE); // warm up, builds the grid
+	auto start = std::chrono::steady_clock::now();
+	for (int r=0; r<REPEATS; r++)
+		clusters.Assign(lights, view, FOV_Y, ASPECT, NEAR_PLANE, FAR_PLANE);
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / REPEATS;
+}
+
+int main(int argc, char ** argv) {
+
+	int count = argc > 1 ? std::atoi(argv[1]) : 4000;
+	int samples = argc > 2 ? std::atoi(argv[2]) : 200000;
+	if (count <= 0 || samples <= 0) {
+		std::cerr << "ClusterBench: Usage: ClusterBench.exe [lights] [samples]\n";
+		return 1;
+	}
+
+	// Lights in a box in front of the camera, plus one across the near plane
+	glm::vec3 eye(0.0f, 0.0f, 30.0f);
+	glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f), range(0.3f, 3.3f);
+	std::vector<ClusterLight> lights;
+	for (int l=0; l<count; l++)
+		lights.push_back(ClusterLight::Point(glm::vec3(15.0f * unit(random), 9.0f * unit(random), 25.0f * unit(random)),
+			glm::vec3(1.0f, 0.7f, 0.4f), range(random)));
+	lights.push_back(ClusterLight::Point(eye + glm::vec3(0.0f, 0.0f, -0.5f), glm::vec3(1.0f), 2.0f));
+
+	LightClusters single(1);
+	double one = timeAssign(single, lights, view);
+	LightClusters clusters;
+	double all = timeAssign(clusters, lights, view);
+
+	const LightClusters::Stats & stats = clusters.LastStats();
+	std::cout << "ClusterBench: " << stats.lights << " lights in view, " << stats.references << " references, "
+		<< stats.maxCluster << " most in a froxel, " << stats.dropped << " dropped\n"
+		<< "  1 thread\t" << one << " ms/assign\n"
+		<< "  all threads\t" << all << " ms/assign\n";
+
+	// Points at random screen positions and exponentially distributed depths
+	float tanY = std::tan(FOV_Y * 0.5f);
+	glm::mat4 world = glm::inverse(view);
+	std::vector<float> ranges(lights.size());
+	for (size_t l=0; l<lights.size(); l++)
+		ranges[l] = std::min(lights[l].Range(), FAR_PLANE);
+
+	long long checks = 0, misses = 0;
+	for (int s=0; s<samples; s++) {
+		float depth = NEAR_PLANE * std::pow(FAR_PLANE / NEAR_PLANE, 0.5f * (unit(random) + 1.0f));
+		glm::vec3 viewPosition(unit(random) * depth * tanY * ASPECT, unit(random) * depth * tanY, -depth);
+		glm::vec3 p = glm::vec3(world * glm::vec4(viewPosition, 1.0f));
+
+		int froxel = clusters.Froxel(viewPosition);
+		if (froxel < 0)
+			continue;
+		uint32_t n;
+		const uint32_t * first = clusters.FroxelLights(froxel, n);
+		if (n >= LightClusters::MAX_LIGHTS_PER_CLUSTER)
+			continue; // a full froxel drops lights by design
+		for (size_t l=0; l<lights.size(); l++) {
+			if (glm::length(lights[l].position - p) >= ranges[l])
+				continue;
+			checks++;
+			if (std::find(first, first + n, (uint32_t) l) == first + n)
+				misses++;
+		}
+	}
+	std::cout << "  " << checks << " lights in range of " << samples << " samples, " << misses << " missing\n";
+
+	if (misses > 0)
+		std::cerr << "ClusterBench: " << misses << " in-range lights missing from their froxel\n";
+	return misses == 0 ? 0 : 1;
+}
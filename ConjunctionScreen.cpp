@@ -0,0 +1,290 @@
+#include <ConjunctionScreen.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+// Bound on relative acceleration in Earth orbit: twice the gravity at the surface.
+// Relative speed is bounded per window, by twice the fastest satellite
+static const double RELATIVE_ACCELERATION = 0.02;  // km/s^2
+
+// Entries handed to one task
+static const int ENTRY_GRAIN = 256;
+
+static const double SECONDS_PER_DAY = 86400.0;
+
+// Cell coordinates offset to unsigned, 21 bits per axis and z the lowest:
+// a cell and its z neighbours are consecutive keys
+static const int CELL_BITS = 21;
+static const long long CELL_OFFSET = 1ll << (CELL_BITS - 1);
+
+// Straight line relative motion from the window's middle, closest within half a
+// window of it: whether b, at pb and a second later at qb, may come within limit of a
+static bool mayMeet(glm::vec3 pa, glm::vec3 va, const float * pb, const float * qb, float half, float limit) {
+	glm::vec3 d = glm::vec3(pb[0], pb[1], pb[2]) - pa;
+	glm::vec3 v = glm::vec3(qb[0], qb[1], qb[2]) - pa - d - va;
+	float speed2 = glm::dot(v, v);
+	float tau = speed2 > 0.0f ? glm::clamp(-glm::dot(d, v) / speed2, -half, half) : 0.0f;
+	return glm::length(d + v * tau) < limit;
+}
+
+static uint64_t cellKey(long long x, long long y, long long z) {
+	return ((uint64_t) (x + CELL_OFFSET) << (2 * CELL_BITS)) | ((uint64_t) (y + CELL_OFFSET) << CELL_BITS)
+		| (uint64_t) (z + CELL_OFFSET);
+}
+
+ConjunctionScreen :: ConjunctionScreen(double alertDistance, double window, double memory)
+	: alertDistance(alertDistance), window(window), memory(memory), next(-1), stats(Stats())
+{
+}
+
+void ConjunctionScreen :: Advance(const SatelliteCatalogue & catalogue, double day, ThreadPool * pool) {
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	stats = Stats();
+
+	// Windows are centred on multiples of their length; start at the current one,
+	// and again if time went backwards
+	double length = window / SECONDS_PER_DAY;
+	long long current = (long long) std::floor(day / length + 0.5);
+	if (next < 0 || next > current + 1)
+		next = current;
+	if (current - next >= MAX_WINDOWS) {
+		stats.skipped = (unsigned int) (current - next - MAX_WINDOWS + 1);
+		next = current - MAX_WINDOWS + 1;
+	}
+	for (; next <= current; next++) {
+		Screen(catalogue, next * length, pool, recent);
+		stats.windows++;
+	}
+
+	// Forget the old, and what lies ahead of time run backwards
+	double horizon = memory / SECONDS_PER_DAY;
+	recent.erase(std::remove_if(recent.begin(), recent.end(), [day, horizon, length] (const Conjunction & c) {
+		return c.day < day - horizon || c.day > day + length;
+	}), recent.end());
+
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ConjunctionScreen :: Screen(const SatelliteCatalogue & catalogue, double day, ThreadPool * pool,
+	std::vector<Conjunction> & found) {
+
+	int count = catalogue.Size();
+	propagate(catalogue, day, pool);
+
+	// No two satellites close faster than twice the fastest of them, head-on
+	// (an eccentric orbit at perigee against a low one closes at some 18 km/s)
+	float fastest2 = 0.0f;
+	for (int i=0; i<count; i++)
+		if (positions[4 * i + 3] != 0.0f && ahead[4 * i + 3] != 0.0f) {
+			glm::vec3 v = glm::vec3(ahead[4 * i], ahead[4 * i + 1], ahead[4 * i + 2])
+				- glm::vec3(positions[4 * i], positions[4 * i + 1], positions[4 * i + 2]);
+			fastest2 = std::max(fastest2, glm::dot(v, v));
+		}
+
+	// Cells as wide as two satellites can close in half a window
+	double half = 0.5 * window;
+	double slack = 0.5 * RELATIVE_ACCELERATION * half * half;
+	double reach = alertDistance + 2.0 * std::sqrt((double) fastest2) * half + slack;
+	double inverseCell = 1.0 / reach;
+
+	entries.clear();
+	for (int i=0; i<count; i++) {
+		const float * p = &positions[4 * i];
+		if (p[3] == 0.0f || ahead[4 * i + 3] == 0.0f)
+			continue;
+		HashEntry entry = {cellKey((long long) std::floor(p[0] * inverseCell), (long long) std::floor(p[1] * inverseCell),
+			(long long) std::floor(p[2] * inverseCell)), i};
+		entries.push_back(entry);
+	}
+	std::sort(entries.begin(), entries.end());
+
+	// Pair tests, each pair once from its lower index. Neighbours are nine runs
+	// of three consecutive cells; their keys are the cell's plus a constant, so
+	// in key order every run only moves forward
+	uint64_t offsets[9];
+	for (int dx=-1, r=0; dx<=1; dx++)
+	for (int dy=-1; dy<=1; dy++, r++)
+		offsets[r] = cellKey(dx, dy, -1) - cellKey(0, 0, 0); // wraps, and back when added
+	std::mutex merge;
+	std::vector<std::pair<int, int> > candidates;
+	unsigned int pairTests = 0;
+	auto test = [&] (int first, int last) {
+		std::vector<std::pair<int, int> > local;
+		unsigned int tests = 0;
+		// A task takes the cells that start in its range, whole
+		while (first > 0 && first < last && entries[first].cell == entries[first - 1].cell)
+			first++;
+		if (first >= last)
+			return;
+		int runs[9][2]; // entry ranges
+		for (int r=0; r<9; r++) {
+			HashEntry low = {entries[first].cell + offsets[r], 0};
+			runs[r][0] = runs[r][1] = (int) (std::lower_bound(entries.begin(), entries.end(), low) - entries.begin());
+		}
+		int size = (int) entries.size();
+		for (int e=first; e<last; ) {
+			uint64_t cell = entries[e].cell;
+			int cellEnd = e;
+			while (cellEnd < size && entries[cellEnd].cell == cell)
+				cellEnd++;
+
+			for (int r=0; r<9; r++) {
+				uint64_t low = cell + offsets[r], high = low + 2;
+				while (runs[r][0] < size && entries[runs[r][0]].cell < low)
+					runs[r][0]++;
+				runs[r][1] = std::max(runs[r][1], runs[r][0]);
+				while (runs[r][1] < size && entries[runs[r][1]].cell <= high)
+					runs[r][1]++;
+			}
+
+			for (; e<cellEnd; e++) {
+				int a = entries[e].satellite;
+				glm::vec3 pa(positions[4 * a], positions[4 * a + 1], positions[4 * a + 2]);
+				glm::vec3 va = glm::vec3(ahead[4 * a], ahead[4 * a + 1], ahead[4 * a + 2]) - pa;
+				for (int r=0; r<9; r++)
+				for (int o=runs[r][0]; o<runs[r][1]; o++) {
+					int b = entries[o].satellite;
+					if (b <= a)
+						continue;
+					tests++;
+					if (mayMeet(pa, va, &positions[4 * b], &ahead[4 * b], (float) half, (float) (alertDistance + slack)))
+						local.push_back(std::make_pair(a, b));
+				}
+			}
+		}
+		std::lock_guard<std::mutex> lock(merge);
+		candidates.insert(candidates.end(), local.begin(), local.end());
+		pairTests += tests;
+	};
+	if (pool)
+		pool->ParallelFor(0, (int) entries.size(), test, ENTRY_GRAIN);
+	else
+		test(0, (int) entries.size());
+	stats.pairTests += pairTests;
+	refineAll(catalogue, day, pool, candidates, found);
+}
+
+void ConjunctionScreen :: ScreenDirect(const SatelliteCatalogue & catalogue, double day, ThreadPool * pool,
+	std::vector<Conjunction> & found) {
+
+	int count = catalogue.Size();
+	propagate(catalogue, day, pool);
+	double half = 0.5 * window;
+	double slack = 0.5 * RELATIVE_ACCELERATION * half * half;
+
+	// Every pair, each from its lower index
+	std::mutex merge;
+	std::vector<std::pair<int, int> > candidates;
+	auto test = [&] (int first, int last) {
+		std::vector<std::pair<int, int> > local;
+		for (int a=first; a<last; a++) {
+			if (positions[4 * a + 3] == 0.0f || ahead[4 * a + 3] == 0.0f)
+				continue;
+			glm::vec3 pa(positions[4 * a], positions[4 * a + 1], positions[4 * a + 2]);
+			glm::vec3 va = glm::vec3(ahead[4 * a], ahead[4 * a + 1], ahead[4 * a + 2]) - pa;
+			for (int b=a+1; b<count; b++)
+				if (positions[4 * b + 3] != 0.0f && ahead[4 * b + 3] != 0.0f
+					&& mayMeet(pa, va, &positions[4 * b], &ahead[4 * b], (float) half, (float) (alertDistance + slack)))
+					local.push_back(std::make_pair(a, b));
+		}
+		std::lock_guard<std::mutex> lock(merge);
+		candidates.insert(candidates.end(), local.begin(), local.end());
+	};
+	if (pool)
+		pool->ParallelFor(0, count, test, 16);
+	else
+		test(0, count);
+	refineAll(catalogue, day, pool, candidates, found);
+}
+
+void ConjunctionScreen :: propagate(const SatelliteCatalogue & catalogue, double day, ThreadPool * pool) {
+	positions.resize(4 * catalogue.Size());
+	ahead.resize(4 * catalogue.Size());
+	catalogue.Propagate(day, positions.data(), pool);
+	catalogue.Propagate(day + 1.0 / SECONDS_PER_DAY, ahead.data(), pool);
+}
+
+void ConjunctionScreen :: refineAll(const SatelliteCatalogue & catalogue, double day, ThreadPool * pool,
+	const std::vector<std::pair<int, int> > & candidates, std::vector<Conjunction> & found) {
+
+	stats.candidates += (unsigned int) candidates.size();
+
+	// Refinement, a few dozen scalar propagations per candidate
+	std::mutex merge;
+	auto refineRange = [&] (int first, int last) {
+		for (int c=first; c<last; c++) {
+			Conjunction conjunction;
+			if (refine(catalogue, candidates[c].first, candidates[c].second, day, conjunction)) {
+				std::lock_guard<std::mutex> lock(merge);
+				found.push_back(conjunction);
+			}
+		}
+	};
+	if (pool)
+		pool->ParallelFor(0, (int) candidates.size(), refineRange, 4);
+	else
+		refineRange(0, (int) candidates.size());
+}
+
+bool ConjunctionScreen :: refine(const SatelliteCatalogue & catalogue, int first, int second, double day,
+	Conjunction & conjunction) const {
+
+	// Relative position at t seconds from day, and the range rate times the range
+	auto relative = [&] (double t, glm::dvec3 & r, glm::dvec3 & v) {
+		float a0[4], b0[4], a1[4], b1[4];
+		catalogue.PropagateSatellite(first, day + (t - 0.5) / SECONDS_PER_DAY, a0);
+		catalogue.PropagateSatellite(second, day + (t - 0.5) / SECONDS_PER_DAY, b0);
+		catalogue.PropagateSatellite(first, day + (t + 0.5) / SECONDS_PER_DAY, a1);
+		catalogue.PropagateSatellite(second, day + (t + 0.5) / SECONDS_PER_DAY, b1);
+		glm::dvec3 r0(b0[0] - a0[0], b0[1] - a0[1], b0[2] - a0[2]);
+		glm::dvec3 r1(b1[0] - a1[0], b1[1] - a1[1], b1[2] - a1[2]);
+		r = 0.5 * (r0 + r1);
+		v = r1 - r0;
+		return glm::dot(r, v);
+	};
+
+	// Closest inside the window only: approaching at its start, receding at its end.
+	// An approach across the boundary belongs to the neighbouring window
+	double half = 0.5 * window;
+	glm::dvec3 r, v;
+	double t0 = -half, t1 = half;
+	double g0 = relative(t0, r, v), g1 = relative(t1, r, v);
+	if (g0 >= 0.0 || g1 <= 0.0)
+		return false;
+
+	double t = 0.0;
+	int side = 0;
+	for (int i=0; i<40 && t1 - t0 > 1e-3; i++) {
+		t = (t0 * g1 - t1 * g0) / (g1 - g0);
+		double g = relative(t, r, v);
+		if (g < 0.0) {
+			t0 = t;
+			g0 = g;
+			if (side == -1)
+				g1 *= 0.5; // Illinois: halve the end that keeps being kept
+			side = -1;
+		} else {
+			t1 = t;
+			g1 = g;
+			if (side == 1)
+				g0 *= 0.5;
+			side = 1;
+		}
+	}
+	relative(t, r, v);
+
+	double distance = glm::length(r);
+	if (distance >= alertDistance)
+		return false;
+	conjunction.first = first;
+	conjunction.second = second;
+	conjunction.day = day + t / SECONDS_PER_DAY;
+	conjunction.distance = distance;
+	return true;
+}
@@ -0,0 +1,92 @@
+#ifndef CONJUNCTION_SCREEN_H
+#define CONJUNCTION_SCREEN_H
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include <SatelliteCatalogue.h>
+#include <ThreadPool.h>
+
+/**
+* Close approaches between the satellites of a catalogue. Simulated time is
+* cut into windows of a fixed length; each window is screened once:
+*
+*   1. the whole catalogue is propagated to the window's middle, and a
+*      second later for velocities
+*   2. satellites are binned into a sorted spatial hash whose cells are as
+*      wide as two satellites can close in half a window, so every pair that
+*      can meet is in neighbouring cells
+*   3. neighbours are tested in parallel: closest approach of straight line
+*      relative motion over the window, with slack for the curvature
+*   4. survivors are refined with SGP4 itself, the time of closest approach
+*      being the root of the range rate (Illinois false position)
+*
+* The pair tests grow with the number of neighbours rather than the square
+* of the catalogue. Conjunctions are remembered for a while of simulated
+* time so they can be shown.
+*/
+
+struct Conjunction {
+	int first, second; // catalogue indices, first < second
+	double day;        // time of closest approach, Julian
+	double distance;   // km
+};
+
+class ConjunctionScreen {
+
+public:
+	struct Stats {
+		unsigned int windows;    // screened this Advance()
+		unsigned int skipped;    // fallen behind by more than MAX_WINDOWS
+		unsigned int pairTests;  // neighbours tested
+		unsigned int candidates; // refined with SGP4
+		double milliseconds;
+	};
+
+	static const int MAX_WINDOWS = 4; // per Advance()
+
+	/** Methods */
+	// Conjunctions are approaches under alertDistance (km); window and memory in seconds
+	ConjunctionScreen(double alertDistance = 5.0, double window = 30.0, double memory = 3600.0);
+
+	// Screens every window from the last one reached up to day
+	void Advance(const SatelliteCatalogue & catalogue, double day, ThreadPool * pool = NULL);
+	// One window centred on day, appends what it finds
+	void Screen(const SatelliteCatalogue & catalogue, double day, ThreadPool * pool,
+		std::vector<Conjunction> & found);
+	// The same window with every pair tested and no hash, for reference
+	void ScreenDirect(const SatelliteCatalogue & catalogue, double day, ThreadPool * pool,
+		std::vector<Conjunction> & found);
+
+	// Found within memory of the last Advance()
+	const std::vector<Conjunction> & Recent() const { return recent; }
+	const Stats & LastStats() const { return stats; }
+
+private:
+	struct HashEntry {
+		uint64_t cell;
+		int satellite;
+		bool operator<(const HashEntry & other) const { return cell < other.cell; }
+	};
+
+	double alertDistance, window, memory;
+	long long next; // index of the next window, window * index being its middle
+	Stats stats;
+
+	/** Screen Data */
+	std::vector<float> positions, ahead; // the window's middle and a second later
+	std::vector<HashEntry> entries;
+	std::vector<Conjunction> recent;
+
+	/** Methods */
+	void propagate(const SatelliteCatalogue & catalogue, double day, ThreadPool * pool);
+	void refineAll(const SatelliteCatalogue & catalogue, double day, ThreadPool * pool,
+		const std::vector<std::pair<int, int> > & candidates, std::vector<Conjunction> & found);
+	bool refine(const SatelliteCatalogue & catalogue, int first, int second, double day,
+		Conjunction & conjunction) const;
+};
+
+#endif
@@ -0,0 +1,218 @@
+#include <Culling.h>
+#include <Mesh.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CULL_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CULL_WIDTH 4
+#else
+#define CULL_WIDTH 1
+#endif
+
+/** Bounds */
+
+Bounds Bounds :: FromVertices(const std::vector<Vertex> & vertices) {
+
+	Bounds bounds = {glm::vec3(0.0f), glm::vec3(0.0f), 0.0f};
+	if (vertices.empty())
+		return bounds;
+
+	glm::vec3 lo(vertices[0].position), hi(vertices[0].position);
+	for (const Vertex & vertex : vertices) {
+		lo = glm::min(lo, vertex.position);
+		hi = glm::max(hi, vertex.position);
+	}
+	bounds.center = (lo + hi) * 0.5f;
+	bounds.extent = (hi - lo) * 0.5f;
+
+	// Sphere about the box centre, tighter than the box's corner for round meshes
+	float radius2 = 0.0f;
+	for (const Vertex & vertex : vertices) {
+		glm::vec3 d = vertex.position - bounds.center;
+		radius2 = std::max(radius2, glm::dot(d, d));
+	}
+	bounds.radius = std::sqrt(radius2);
+	return bounds;
+}
+
+Bounds Bounds :: Infinite() {
+	Bounds bounds = {glm::vec3(0.0f), glm::vec3(FLT_MAX), FLT_MAX};
+	return bounds;
+}
+
+Bounds Bounds :: Merge(const Bounds & other) const {
+
+	glm::vec3 lo = glm::min(center - extent, other.center - other.extent);
+	glm::vec3 hi = glm::max(center + extent, other.center + other.extent);
+
+	Bounds bounds;
+	bounds.center = (lo + hi) * 0.5f;
+	bounds.extent = (hi - lo) * 0.5f;
+	bounds.radius = std::max(
+		glm::length(center - bounds.center) + radius,
+		glm::length(other.center - bounds.center) + other.radius);
+	bounds.radius = std::min(bounds.radius, glm::length(bounds.extent));
+	return bounds;
+}
+
+Bounds Bounds :: Transform(const glm::mat4 & model) const {
+
+	// Arvo: the new half size is the old one through |M|
+	glm::mat3 linear(model);
+	glm::mat3 absolute(glm::abs(linear[0]), glm::abs(linear[1]), glm::abs(linear[2]));
+	float scale = std::max(glm::length(linear[0]), std::max(glm::length(linear[1]), glm::length(linear[2])));
+
+	Bounds bounds;
+	bounds.center = glm::vec3(model * glm::vec4(center, 1.0f));
+	bounds.extent = absolute * extent;
+	bounds.radius = radius * scale;
+	return bounds;
+}
+
+/** Frustum */
+
+Frustum :: Frustum() {
+	for (glm::vec4 & plane : planes)
+		plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Frustum :: Frustum(const glm::mat4 & viewProjection) {
+
+	// Gribb & Hartmann, rows of the clip matrix (glm is column major)
+	glm::mat4 m = glm::transpose(viewProjection);
+	planes[0] = m[3] + m[0]; // left
+	planes[1] = m[3] - m[0]; // right
+	planes[2] = m[3] + m[1]; // bottom
+	planes[3] = m[3] - m[1]; // top
+	planes[4] = m[3] + m[2]; // near
+	planes[5] = m[3] - m[2]; // far
+
+	for (glm::vec4 & plane : planes)
+		plane /= glm::length(glm::vec3(plane));
+}
+
+/** FrustumCuller */
+
+FrustumCuller :: FrustumCuller()
+	: count(0)
+{
+	stats.tested = stats.visible = stats.culled = 0;
+}
+
+void FrustumCuller :: Clear() {
+	centerX.clear(); centerY.clear(); centerZ.clear();
+	extentX.clear(); extentY.clear(); extentZ.clear();
+	radius.clear();
+	count = 0;
+}
+
+unsigned int FrustumCuller :: Add(const Bounds & bounds) {
+
+	centerX.push_back(bounds.center.x);
+	centerY.push_back(bounds.center.y);
+	centerZ.push_back(bounds.center.z);
+	extentX.push_back(bounds.extent.x);
+	extentY.push_back(bounds.extent.y);
+	extentZ.push_back(bounds.extent.z);
+	radius.push_back(bounds.radius);
+	return count++;
+}
+
+/**
+* Per plane n: the signed centre distance d = n.c + w, the box's projected
+* radius e.|n|, and the sphere's radius r. Outside when d < -min(r, e.|n|),
+* i.e. the tighter of the two volumes is behind the plane.
+*/
+static bool cullScalar(const glm::vec4 planes[6],
+	float cx, float cy, float cz, float ex, float ey, float ez, float r) {
+
+	for (int p=0; p<6; p++) {
+		const glm::vec4 & n = planes[p];
+		float d  = n.x * cx + n.y * cy + n.z * cz + n.w;
+		float rb = std::fabs(n.x) * ex + std::fabs(n.y) * ey + std::fabs(n.z) * ez;
+		if (d + std::min(r, rb) < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+unsigned int FrustumCuller :: Cull(const Frustum & frustum) {
+
+	// Pad with zero-sized bounds so every batch is full; their results are ignored
+	size_t padded = (count + CULL_WIDTH - 1) / CULL_WIDTH * CULL_WIDTH;
+	for (std::vector<float> * column : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius})
+		column->resize(padded, 0.0f);
+	visible.resize(padded);
+
+	const glm::vec4 * planes = frustum.planes;
+	size_t i = 0;
+
+#if CULL_WIDTH == 8
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	for (; i<padded; i+=8) {
+		__m256 cx = _mm256_loadu_ps(&centerX[i]), cy = _mm256_loadu_ps(&centerY[i]), cz = _mm256_loadu_ps(&centerZ[i]);
+		__m256 ex = _mm256_loadu_ps(&extentX[i]), ey = _mm256_loadu_ps(&extentY[i]), ez = _mm256_loadu_ps(&extentZ[i]);
+		__m256 r  = _mm256_loadu_ps(&radius[i]);
+		__m256 outside = _mm256_setzero_ps();
+		for (int p=0; p<6; p++) {
+			__m256 nx = _mm256_set1_ps(planes[p].x), ny = _mm256_set1_ps(planes[p].y), nz = _mm256_set1_ps(planes[p].z);
+			__m256 d = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(nx, cx), _mm256_mul_ps(ny, cy)),
+				_mm256_add_ps(_mm256_mul_ps(nz, cz), _mm256_set1_ps(planes[p].w)));
+			__m256 rb = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, nx), ex), _mm256_mul_ps(_mm256_andnot_ps(signMask, ny), ey)),
+				_mm256_mul_ps(_mm256_andnot_ps(signMask, nz), ez));
+			__m256 reach = _mm256_add_ps(d, _mm256_min_ps(r, rb));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(reach, _mm256_setzero_ps(), _CMP_LT_OQ));
+		}
+		int mask = _mm256_movemask_ps(outside);
+		for (int lane=0; lane<8; lane++)
+			visible[i + lane] = !((mask >> lane) & 1);
+	}
+#elif CULL_WIDTH == 4
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	for (; i<padded; i+=4) {
+		__m128 cx = _mm_loadu_ps(&centerX[i]), cy = _mm_loadu_ps(&centerY[i]), cz = _mm_loadu_ps(&centerZ[i]);
+		__m128 ex = _mm_loadu_ps(&extentX[i]), ey = _mm_loadu_ps(&extentY[i]), ez = _mm_loadu_ps(&extentZ[i]);
+		__m128 r  = _mm_loadu_ps(&radius[i]);
+		__m128 outside = _mm_setzero_ps();
+		for (int p=0; p<6; p++) {
+			__m128 nx = _mm_set1_ps(planes[p].x), ny = _mm_set1_ps(planes[p].y), nz = _mm_set1_ps(planes[p].z);
+			__m128 d = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)),
+				_mm_add_ps(_mm_mul_ps(nz, cz), _mm_set1_ps(planes[p].w)));
+			__m128 rb = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, nx), ex), _mm_mul_ps(_mm_andnot_ps(signMask, ny), ey)),
+				_mm_mul_ps(_mm_andnot_ps(signMask, nz), ez));
+			__m128 reach = _mm_add_ps(d, _mm_min_ps(r, rb));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(reach, _mm_setzero_ps()));
+		}
+		int mask = _mm_movemask_ps(outside);
+		for (int lane=0; lane<4; lane++)
+			visible[i + lane] = !((mask >> lane) & 1);
+	}
+#endif
+
+	for (; i<padded; i++)
+		visible[i] = cullScalar(planes, centerX[i], centerY[i], centerZ[i],
+			extentX[i], extentY[i], extentZ[i], radius[i]);
+
+	stats.tested = count;
+	stats.visible = 0;
+	for (unsigned int j=0; j<count; j++)
+		stats.visible += visible[j];
+	stats.culled = count - stats.visible;
+
+	for (std::vector<float> * column : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius})
+		column->resize(count);
+	return stats.visible;
+}
@@ -0,0 +1,68 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <vector>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+struct Vertex;
+
+/**
+* Bounding volumes and frustum culling. Every mesh keeps an AABB and a
+* bounding sphere about the same centre, computed once at load time; a
+* packet is culled when either volume lies fully outside one of the six
+* frustum planes. FrustumCuller stores world-space bounds as structure of
+* arrays and tests 4 (SSE2) or 8 (AVX with -mavx) of them per plane at once.
+*/
+
+struct Bounds {
+	glm::vec3 center; // box centre, also the sphere centre
+	glm::vec3 extent; // box half size
+	float radius;
+
+	static Bounds FromVertices(const std::vector<Vertex> & vertices);
+	static Bounds Infinite(); // never culled
+
+	Bounds Merge(const Bounds & other) const;
+	Bounds Transform(const glm::mat4 & model) const; // still axis aligned, conservative
+};
+
+struct Frustum {
+	glm::vec4 planes[6]; // normalised, inside where dot(xyz, p) + w >= 0
+
+	Frustum();
+	explicit Frustum(const glm::mat4 & viewProjection);
+};
+
+class FrustumCuller {
+
+public:
+	struct Stats {
+		unsigned int tested;
+		unsigned int visible;
+		unsigned int culled;
+	};
+
+	/** Methods */
+	FrustumCuller();
+
+	void Clear();
+	unsigned int Add(const Bounds & bounds); // world space, returns the index
+	unsigned int Cull(const Frustum & frustum); // returns the visible count
+
+	bool Visible(unsigned int index) const { return visible[index] != 0; }
+	unsigned int Size() const { return count; }
+	const Stats & LastStats() const { return stats; }
+
+private:
+	/** Bounds Data, padded to the widest SIMD batch */
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+	std::vector<float> radius;
+	std::vector<unsigned char> visible;
+	unsigned int count;
+	Stats stats;
+};
+
+#endif
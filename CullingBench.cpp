@@ -0,0 +1,103 @@
+/**
+* Frustum culling benchmark: culls random boxes against a camera frustum
+* with FrustumCuller, whose path (AVX with SIMD=-mavx2, SSE2, or scalar)
+* is fixed at build time, and with a scalar reference test, and checks
+* that both keep the same boxes.
+*
+* Usage:
+*   ./CullingBench.exe [bounds] [repeats]
+*
+*   100000 bounds and 100 timed passes by default.
+*/
+
+#include <Culling.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__AVX__)
+static const char * PATH = "AVX";
+#elif defined(__SSE2__) || defined(_M_X64)
+static const char * PATH = "SSE2";
+#else
+static const char * PATH = "scalar";
+#endif
+
+// Outside when the tighter of box and sphere is behind a plane, as Culling.cpp
+static bool visibleReference(const Frustum & frustum, const Bounds & bounds) {
+	for (const glm::vec4 & n : frustum.planes) {
+		float d = glm::dot(glm::vec3(n), bounds.center) + n.w;
+		float rb = glm::dot(glm::abs(glm::vec3(n)), bounds.extent);
+		if (d + std::min(bounds.radius, rb) < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, char ** argv) {
+
+	int count = argc > 1 ? std::atoi(argv[1]) : 100000;
+	int repeats = argc > 2 ? std::atoi(argv[2]) : 100;
+	if (count <= 0 || repeats <= 0) {
+		std::cerr << "CullingBench: Usage: CullingBench.exe [bounds] [repeats]\n";
+		return 1;
+	}
+
+	// Boxes scattered around the camera's target, some in view, most not
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-60.0f, 60.0f), size(0.1f, 3.0f);
+	std::vector<Bounds> bounds(count);
+	for (Bounds & b : bounds) {
+		b.center = glm::vec3(position(random), position(random), position(random));
+		b.extent = glm::vec3(size(random), size(random), size(random));
+		b.radius = glm::length(b.extent) * 0.9f; // a sphere tighter than the box's corners
+	}
+	Frustum frustum(glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f)
+		* glm::lookAt(glm::vec3(0.0f, 0.0f, 30.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+	FrustumCuller culler;
+	for (const Bounds & b : bounds)
+		culler.Add(b);
+	culler.Cull(frustum); // warm up
+	auto start = std::chrono::steady_clock::now();
+	for (int r=0; r<repeats; r++)
+		culler.Cull(frustum);
+	double culled = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+	std::vector<unsigned char> reference(count);
+	start = std::chrono::steady_clock::now();
+	for (int r=0; r<repeats; r++)
+		for (int i=0; i<count; i++)
+			reference[i] = visibleReference(frustum, bounds[i]);
+	double scalar = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+	int mismatches = 0;
+	for (int i=0; i<count; i++)
+		if (culler.Visible(i) != (reference[i] != 0))
+			mismatches++;
+
+	// Infinite bounds are never culled
+	FrustumCuller infinite;
+	infinite.Add(Bounds::Infinite());
+	infinite.Cull(frustum);
+
+	const FrustumCuller::Stats & stats = culler.LastStats();
+	std::cout << "CullingBench: " << count << " bounds, " << stats.visible << " visible, " << stats.culled << " culled\n"
+		<< "  " << PATH << "\t" << culled << " ms/pass\n"
+		<< "  reference\t" << scalar << " ms/pass\n";
+
+	bool agree = mismatches == 0 && infinite.Visible(0);
+	if (mismatches > 0)
+		std::cerr << "CullingBench: " << mismatches << " bounds differ from the reference test\n";
+	if (!infinite.Visible(0))
+		std::cerr << "CullingBench: Infinite bounds were culled\n";
+	return agree ? 0 : 1;
+}
@@ -2,6 +2,13 @@
 #include <sstream>
 #include <string>
 #include <memory>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
 
 /** Basic GLFW header */
 //#include <GL/glew.h>	// Important - this header must come before glfw3 header
@@ -12,6 +19,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/constants.hpp>
 
 /** GLFW Texture header */
 #include <stb_image/stb_image.h> // Support several formats of image file
@@ -27,6 +35,23 @@
 #include <Primitives.h>
 #include <Skybox.h>
 #include <ParallelShadow.h>
+#include <TextureStreamer.h>
+#include <RenderQueue.h>
+#include <GpuTimer.h>
+#include <LightClusters.h>
+#include <Atmosphere.h>
+#include <CloudLayer.h>
+#include <TripleBuffer.h>
+#include <SimulationThread.h>
+#include <Ephemeris.h>
+#include <SatelliteCatalogue.h>
+#include <ConjunctionScreen.h>
+#include <NBodyField.h>
+#include <AsteroidCatalogue.h>
+#include <TrailRenderer.h>
+#include <FlowParticles.h>
+#include <PointCloud.h>
+#include <ThreadPool.h>
 
 // Global Variables
 const char* APP_TITLE = "Earth Sim";
@@ -42,15 +67,106 @@ bool enableTorch = true;
 bool enableNormal = true;
 float adjustGamma = 2.2f;
 float adjustParallax = 0.01f;
+bool enableQuadtreeParallax = true;
+ShadowMode shadowMode = SHADOW_MODE_MAP;
+bool enableDepthPrepass = true;
+bool enableAtmosphere = true;
+const float atmosphereExposure = 10.0f;
+CloudResolution cloudResolution = CLOUDS_HALF;
+const float sunAngularRadius = glm::radians(0.266f);
+double timeWarp = 3600.0; // simulated seconds per second
+bool enableSatellites = true;
+NBodyScenario nbodyScenario = NBODY_OFF;
+const int nbodyParticles = 100000;
+bool enableAsteroids = true;
+const float asteroidLimit = 16.0f; // magnitude, at a 45 degree field of view
+bool enableTrails = true;
+const int trailSatellites = 64; // spread through the catalogue
+FlowMode flowMode = FLOW_OFF;
+const int flowParticles = 65536;
+const float flowSpeedup = 10800.0f; // seconds of wind per second, streamlines rather than the clock
+
+// The scene is the J2000 ecliptic with y up: scene (x, y, z) = ecliptic (x, z, -y)
+static const glm::dmat3 eclipticToScene(1.0, 0.0, 0.0, 0.0, 0.0, -1.0, 0.0, 1.0, 0.0);
+// The Earth stays put and the Moon keeps its distance of 20, in its true direction
+static const glm::vec3 earthPos(0.0f, 0.0f, -1.0f);
+static const double moonScale = 20.0 / 384400.0;
+
+// Shown on the title bar
+struct FrameStats {
+	RenderQueue::Stats queue;
+	LightClusters::Stats lights;
+	double shadowMs;  // GPU time of the shadow pass
+	ParallelShadow::CacheStats shadowCache; // tiles tested and kept since start
+	double prepassMs; // GPU time of the depth pre-pass, 0 when off
+	double sceneMs;   // GPU time of the main pass and skybox
+	double atmosphereMs;
+	double cloudMs;
+	double simulationMs; // CPU time of the simulation step, overlapped with rendering
+	double julianDay;    // simulated epoch
+	int satellites;
+	double propagationMs; // CPU time of the satellites, on every hardware thread
+	int conjunctions;
+	double screeningMs;   // CPU time of the conjunction screen, overlapped with rendering
+	NBodyField::Stats field;
+	int asteroids;
+	int trails;
+	int flowParticles;
+};
 
 // Function prototypes
 void processInput(GLFWwindow* window);
 void mouseCallback(GLFWwindow* window, double xpos, double ypos);
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 void glfw_onFramebufferSize(GLFWwindow* window, int width, int height);
-void showFPS(GLFWwindow* window);
+void showFPS(GLFWwindow* window, const FrameStats & stats);
 bool initOpenGL();
-void renderScene(Shader & shader);
+void run();
+
+// Scene objects, transforms are computed once per frame and shared by every pass
+struct SceneObject {
+	Model * model;
+	glm::mat4 transform;
+	glm::mat3 normalMatrix;
+	unsigned int flags; // DrawFlags, ignored by depth-only passes
+};
+void updateScene(std::vector<SceneObject> & objects, glm::mat4 & temeToWorld, glm::mat4 & earthFixedToWorld,
+	const Ephemeris & ephemeris, double day, unsigned int earthFlags);
+unsigned int earthFlags(); // DrawFlags of the Earth, from the toggles
+
+// Sampled on the main thread (GLFW input), everything the simulation needs from it
+struct FrameInput {
+	Camera camera;
+	unsigned int earthFlags; // DrawFlags
+	double timeWarp;
+	bool satellites;
+};
+
+// One simulated frame; the simulation thread builds it, the render loop only reads it
+struct FrameState {
+	Camera camera;
+	glm::mat4 view, projection, viewProjection;
+	std::vector<SceneObject> objects;
+	std::vector<Bounds> bounds; // world, one per object
+	std::vector<ClusterLight> lights;
+	double julianDay;
+	glm::vec3 lightDirection; // from the Sun
+	glm::vec3 earthHeliocentric; // AU, J2000 ecliptic
+	glm::mat4 temeToWorld;    // satellite positions (km) to the scene
+	glm::mat4 earthFixedToWorld; // the same turned with the Earth, for ground tracks
+	std::vector<Conjunction> conjunctions; // recent close approaches
+	double screeningMs;
+	double simulationMs;
+};
+void submitScene(RenderQueue & queue, Shader & shader, unsigned int pass,
+	const std::vector<SceneObject> & objects, MeshSelection selection);
+
+// Render passes, the first field of every sort key
+enum RenderPass {
+	PASS_SHADOW,
+	PASS_DEPTH,
+	PASS_MAIN
+};
 
 //-----------------------------------------------------------------------------
 // Models
@@ -68,20 +184,150 @@ int main() {
 		return -1;
 	}
 
+	// Everything GL and the simulation threads go before the context does:
+	// run() joins the threads and frees its objects on return, then the models
+	run();
+	pObjEarth.reset();
+	pObjMoon.reset();
+
+	glfwTerminate();
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Loads the scene and runs the render loop until the window closes
+//-----------------------------------------------------------------------------
+void run() {
+
 	// Shader loader
-	Shader objectShader, skyboxShader, shadowShader;
+	Shader objectShader, skyboxShader, shadowShader, atmosphereShader, atmosphereCompositeShader;
+	Shader cloudShader, cloudCompositeShader, satelliteShader, particleShader, asteroidShader, trailShader;
+	Shader flowShader, flowUpdateShader;
 	objectShader.loadShaders("shaders/object.vert",  "shaders/object.frag");
 	skyboxShader.loadShaders("shaders/skybox.vert", "shaders/skybox.frag");
 	shadowShader.loadShaders("shaders/shadow.vert", "shaders/shadow.frag");
+	atmosphereShader.loadShaders("shaders/fullscreen.vert", "shaders/atmosphere.frag");
+	atmosphereCompositeShader.loadShaders("shaders/fullscreen.vert", "shaders/atmosphere_composite.frag");
+	cloudShader.loadShaders("shaders/object.vert", "shaders/cloud.frag");
+	cloudCompositeShader.loadShaders("shaders/fullscreen.vert", "shaders/cloud_composite.frag");
+	satelliteShader.loadShaders("shaders/satellite.vert", "shaders/satellite.frag");
+	particleShader.loadShaders("shaders/particle.vert", "shaders/particle.frag");
+	asteroidShader.loadShaders("shaders/asteroid.vert", "shaders/asteroid.frag");
+	trailShader.loadShaders("shaders/trail.vert", "shaders/trail.frag");
+	flowShader.loadShaders("shaders/flow.vert", "shaders/flow.frag");
+	const char * flowState[] = {"State"};
+	flowUpdateShader.loadFeedbackShader("shaders/flow_update.vert", flowState, 1);
+	Material::BindSamplers(objectShader); // material units are fixed, see Material.h
+	Material::BindSamplers(cloudShader);
+
+
+
+	// Model loader, textures stream in behind placeholders
+	TextureStreamer textureStreamer;
+	pObjEarth = std::make_shared<Model> ("Resources/earth/earth.obj", false, &textureStreamer);
+	pObjMoon  = std::make_shared<Model> ("Resources/planet/planet.obj", false, &textureStreamer);
+	// The cloud shell is the Earth's translucent mesh, drawn on its own (see CloudLayer.h)
+	Bounds cloudShell = pObjEarth->SelectionBounds(MESHES_TRANSLUCENT);
+
+	// Shadow, one 1024^2 tile per body; a tile is re-rendered only when its
+	// caster or the light moves half a texel
+	ParallelShadow shadowMap(1024, 2, SHADOW_DEPTH24);
+	shadowMap.SetCaching(0.5f, 0);
+
+	// Draw submission, culled and sorted per pass
+	RenderQueue renderQueue;
+	FrameStats frameStats = FrameStats();
+	GpuTimer shadowTimer, prepassTimer, sceneTimer, atmosphereTimer, cloudTimer;
+
+	// Point and spot lights, assigned to view froxels every frame
+	LightClusters lightClusters;
+
+	// Atmosphere tables, computed on first run and cached next to the models
+	AtmosphereParameters atmosphereParameters = AtmosphereParameters::Earth();
+	atmosphereParameters.sunAngularRadius = sunAngularRadius;
+	Atmosphere atmosphere(atmosphereParameters, "Resources/atmosphere.lut");
+
+	// Clouds, at a fraction of the frame's resolution unless set to full
+	CloudLayer cloudLayer(cloudResolution);
+
+	// Sun, Moon and Earth rotation, fitted on first run and cached next to the models
+	Ephemeris ephemeris(2433282.5, 2469807.5, "Resources/ephemeris.cheb"); // 1950 to 2050
+
+	// Satellites, when there is a catalogue: propagated on every hardware
+	// thread straight into the point buffer
+	SatelliteCatalogue satellites;
+	satellites.Load("Resources/satellites.tle");
+	ThreadPool propagationPool;
+	PointCloud satelliteCloud;
+	// Close approaches, screened on the simulation thread and drawn larger
+	ConjunctionScreen conjunctionScreen;
+	PointCloud conjunctionCloud;
+
+	// Trails, a row of samples appended to a ring on the GPU each time one is due:
+	// hourly for the Moon (21 days), every simulated minute for the orbits of a
+	// sample of the satellites and the ground tracks under them (4 hours)
+	const int trailed = std::min(trailSatellites, satellites.Size());
+	TrailRenderer moonTrail(1, 512);
+	TrailRenderer satelliteTrails(std::max(1, 2 * trailed), 256, trailed);
+	long long moonSample = 0, satelliteSample = 0; // the last appended, counted from day 0
+	std::vector<float> trailRow;
+	// Appends the rows due by day, at most a ring's worth; a first call, a jump
+	// past the ring or time running back refills it from scratch
+	auto sampleTrail = [&trailRow] (TrailRenderer & trail, long long & last, double day, double perDay, auto sample) {
+		long long now = (long long) std::floor(day * perDay);
+		if (trail.Filled() == 0 || now < last || now - last > trail.Length()) {
+			trail.Clear();
+			last = now - trail.Length();
+		}
+		trailRow.resize(4 * trail.Trails());
+		for (last++; last<=now; last++) {
+			sample(last / perDay, trailRow.data());
+			trail.Append(trailRow.data());
+		}
+		last = now;
+	};
 
-
-
-	// Model loader
-	pObjEarth = std::make_shared<Model> ("Resources/earth/earth.obj");
-	pObjMoon  = std::make_shared<Model> ("Resources/planet/planet.obj");
-
-	// Shadow
-	ParallelShadow shadowMap;
+	// Wind streaks and aurora, advected and respawned on the GPU by transform
+	// feedback; a wind field image replaces the built-in one when there is one
+	FlowParticles flow(flowParticles);
+	flow.LoadField("Resources/wind.png", 40.0f);
+	FlowMode lastFlowMode = FLOW_OFF;
+	double lastFlowSeconds = glfwGetTime();
+	// Geomagnetic north (IGRF dipole, 80.7 N 72.7 W) as the z axis of the aurora's frame
+	glm::vec3 magneticPole(glm::cos(glm::radians(80.7f)) * glm::cos(glm::radians(-72.7f)),
+		glm::cos(glm::radians(80.7f)) * glm::sin(glm::radians(-72.7f)), glm::sin(glm::radians(80.7f)));
+	glm::vec3 magneticEast = glm::normalize(glm::cross(glm::vec3(0.0f, 0.0f, 1.0f), magneticPole));
+	glm::mat3 magneticToFixed(magneticEast, glm::cross(magneticPole, magneticEast), magneticPole);
+
+	// Asteroids, when there is a catalogue: orbits uploaded once, moved by the GPU
+	AsteroidCatalogue asteroids;
+	asteroids.Load("Resources/MPCORB.DAT");
+
+	// N-body debris and rings, stepped on their own thread at most once a frame
+	// and as fast as they go; they keep their own time. Scenario changes are
+	// picked up by the next step
+	struct FieldFrame {
+		NBodyScenario scenario;
+		std::vector<float> positions; // see NBodyField::Positions()
+		NBodyField::Stats stats;
+	};
+	NBodyField field;
+	TripleBuffer<FieldFrame> fieldFrames;
+	std::atomic<int> fieldScenario(NBODY_OFF);
+	PointCloud fieldCloud;
+	SimulationThread fieldThread([&] () {
+		NBodyScenario scenario = (NBodyScenario) fieldScenario.load();
+		if (scenario != field.Scenario())
+			field.Reset(scenario, nbodyParticles);
+		field.Step(&propagationPool);
+		FieldFrame & out = fieldFrames.Back();
+		out.scenario = field.Scenario();
+		out.positions.resize(4 * field.Size());
+		field.Positions(out.positions.data());
+		out.stats = field.LastStats();
+		fieldFrames.Publish();
+	});
 
 
 
@@ -107,7 +353,7 @@ int main() {
 		"Resources/skyboxes/universe/image_2.png", // front
 		"Resources/skyboxes/universe/image_0.png", // back
 	};
-	skybox.LoadTexture(faces);
+	skybox.LoadTexture(faces, Skybox::FaceSizeFor(gWindowHeight, camera.fov));
 
 
 
@@ -118,25 +364,38 @@ int main() {
 		glm::vec3( 0.0f,  0.0f, -3.0f),
 		glm::vec3( 0.0f,  0.0f,  3.0f)
 	};
-	glm::vec3 directionalLightDirection(-1.0f, 0.0f, 0.0f);
+
+	// City lights, fixed points on the Earth's surface in model space
+	const int cityLightCount = 1024;
+	std::vector<glm::vec3> cityLightPos;
+	std::mt19937 random(2024);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	for (int i=0; i<cityLightCount; i++) {
+		float z = uniform(random), phi = glm::pi<float>() * uniform(random);
+		float r = glm::sqrt(1.0f - z * z);
+		glm::vec3 direction(r * glm::cos(phi), r * glm::sin(phi), z);
+		cityLightPos.push_back(pObjEarth->bounds.center + direction * pObjEarth->bounds.radius * 1.01f);
+	}
 
 	// Object shader config
 	objectShader.use();
 	// Light config
 	// Directional light
-	objectShader.setUniform("uDirectionalLight.direction", directionalLightDirection);
 	objectShader.setUniform("uDirectionalLight.ambient", 0.0f, 0.0f, 0.0f);
 	objectShader.setUniform("uDirectionalLight.diffuse", 1.0f, 1.0f, 1.0f);
 	objectShader.setUniform("uDirectionalLight.specular", 0.0f, 0.0f, 0.0f);
-	// Spot light
-	objectShader.setUniform("uSpotLight.innerCutOff", glm::cos(glm::radians(12.5f)));
-	objectShader.setUniform("uSpotLight.outerCutOff", glm::cos(glm::radians(17.5f)));
+	// Spot light, on the clouds too
 	objectShader.setUniform("uSpotLight.ambient", 0.0f, 0.0f, 0.0f);
-	objectShader.setUniform("uSpotLight.diffuse", 1.0f, 1.0f, 1.0f);
 	objectShader.setUniform("uSpotLight.specular", 1.0f, 1.0f, 1.0f);
-	objectShader.setUniform("uSpotLight.constant", 1.0f);
-	objectShader.setUniform("uSpotLight.linear", 0.09f);
-	objectShader.setUniform("uSpotLight.quadratic", 0.032f);
+	for (Shader * shader : {&objectShader, &cloudShader}) {
+		shader->use();
+		shader->setUniform("uSpotLight.innerCutOff", glm::cos(glm::radians(12.5f)));
+		shader->setUniform("uSpotLight.outerCutOff", glm::cos(glm::radians(17.5f)));
+		shader->setUniform("uSpotLight.diffuse", 1.0f, 1.0f, 1.0f);
+		shader->setUniform("uSpotLight.constant", 1.0f);
+		shader->setUniform("uSpotLight.linear", 0.09f);
+		shader->setUniform("uSpotLight.quadratic", 0.032f);
+	}
 
 
 
@@ -145,44 +404,133 @@ int main() {
 
 
 
+	// Simulation, one frame ahead of rendering on its own thread. The step only
+	// reads its input, the ephemeris and the models' load-time data, and writes
+	// its snapshot. Simulated time starts now and runs timeWarp times faster
+	TripleBuffer<FrameInput> frameInputs;
+	TripleBuffer<FrameState> frameStates;
+	double julianDay = Ephemeris::DayFromUnixTime(
+		std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count());
+	double lastSeconds = glfwGetTime();
+	auto simulate = [&] () {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		frameInputs.Update();
+		const FrameInput & input = frameInputs.Front();
+		FrameState & state = frameStates.Back();
+		double seconds = glfwGetTime();
+		julianDay += (seconds - lastSeconds) * input.timeWarp / 86400.0;
+		lastSeconds = seconds;
+		state.julianDay = julianDay;
+		state.camera = input.camera;
+		state.view = state.camera.getViewMatrix();
+		state.projection = glm::perspective(glm::radians(state.camera.fov), aspect, 0.1f, 100.0f);
+		state.viewProjection = state.projection * state.view;
+		// Object transforms and sunlight
+		updateScene(state.objects, state.temeToWorld, state.earthFixedToWorld, ephemeris, julianDay, input.earthFlags);
+		glm::dvec3 sun = ephemeris.SunGeocentric(julianDay);
+		state.lightDirection = -glm::normalize(glm::vec3(sun.x, sun.z, -sun.y)); // scene axes, see updateScene()
+		state.earthHeliocentric = glm::vec3(-sun / Ephemeris::AU);
+		// world bounds, for shadows, occluders and the atmosphere
+		state.bounds.clear();
+		for (const SceneObject & object : state.objects)
+			state.bounds.push_back(object.model->bounds.Transform(object.transform));
+		// Earth-bound lights follow its spin, the rest are fixed in world space
+		state.lights.clear();
+		for (const glm::vec3 & position : pointLightPos)
+			state.lights.push_back(ClusterLight::Point(position, glm::vec3(0.6f), 3.0f));
+		for (const glm::vec3 & position : cityLightPos)
+			state.lights.push_back(ClusterLight::Point(
+				glm::vec3(state.objects[0].transform * glm::vec4(position, 1.0f)),
+				glm::vec3(1.0f, 0.75f, 0.4f), 0.08f * state.bounds[0].radius));
+		// Conjunctions, screened window by window as simulated time passes them
+		state.screeningMs = 0.0;
+		if (input.satellites && satellites.Size() > 0) {
+			conjunctionScreen.Advance(satellites, julianDay, &propagationPool);
+			state.screeningMs = conjunctionScreen.LastStats().milliseconds;
+		}
+		state.conjunctions = conjunctionScreen.Recent();
+		state.simulationMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		frameStates.Publish();
+	};
+	// The first frame is simulated here, so there is always one to draw
+	frameInputs.Back().camera = camera;
+	frameInputs.Back().earthFlags = earthFlags();
+	frameInputs.Back().timeWarp = timeWarp;
+	frameInputs.Back().satellites = enableSatellites;
+	frameInputs.Publish();
+	simulate();
+	SimulationThread simulation(simulate);
+
+
+
 	// Rendering loop
 	while (!glfwWindowShouldClose(gWindow)) {
 
 		// Display FPS on title
-		showFPS(gWindow);
+		showFPS(gWindow, frameStats);
 
 		// Key input
 		processInput(gWindow);
 
+		// Texture uploads, bounded per frame
+		textureStreamer.Update();
+
+
+
+		// Hand this input to the simulation, take the frame it finished meanwhile
+		// (the last one again if it has not) and start on the next
+		frameInputs.Back().camera = camera;
+		frameInputs.Back().earthFlags = earthFlags();
+		frameInputs.Back().timeWarp = timeWarp;
+		frameInputs.Back().satellites = enableSatellites;
+		frameInputs.Publish();
+		frameStates.Update();
+		simulation.Kick();
+		fieldScenario = nbodyScenario;
+		fieldThread.Kick();
+		const FrameState & frame = frameStates.Front();
+		const std::vector<SceneObject> & sceneObjects = frame.objects;
+		const std::vector<Bounds> & shadowBounds = frame.bounds;
+
 
 
-		// Create transformations
-		glm::mat4 view = camera.getViewMatrix();
-		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), aspect, 0.1f, 100.0f);
-		//glm::mat4 projection = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 100.0f);
+		// Transformations, the same for every pass
+		glm::mat4 view = frame.view;
+		glm::mat4 projection = frame.projection;
 
 
 
 		/** Shadow */
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-		// get light transformation
-		glm::mat4 lightProjection, lightView;
-		float near_plane = 1.0f, far_plane = 100.0f;
-		lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, near_plane, far_plane);
-		lightView = glm::lookAt(glm::vec3(50.0f, 0.0f, 0.0f), glm::vec3(0.0f), glm::vec3(0.0, 1.0, 0.0));
-		// render scene from light's point of view
-		shadowShader.use();
-		shadowShader.setUniform("uView", lightView);
-		shadowShader.setUniform("uProjection", lightProjection);
-		// get shadow map
-		glViewport(0, 0, shadowMap.width, shadowMap.height);
-		shadowMap.Bind();
-		glClear(GL_DEPTH_BUFFER_BIT);
-		glCullFace(GL_FRONT);
-		renderScene(shadowShader);
-		glCullFace(GL_BACK);
-		shadowMap.Unbind();
+		shadowTimer.Begin();
+		if (shadowMode == SHADOW_MODE_MAP) {
+			// fit a tile around every body and the receivers behind it
+			shadowMap.Fit(frame.lightDirection, shadowBounds, shadowBounds);
+			// render each body from light's point of view, unless its cached tile still holds
+			shadowMap.Bind();
+			glCullFace(GL_FRONT);
+			for (int i=0; i<shadowMap.Tiles(); i++) {
+				ShadowCaster caster = {sceneObjects[i].transform, sceneObjects[i].model->bounds, true}; // bodies are spheres
+				if (!shadowMap.NeedsUpdate(i, caster))
+					continue;
+				const ShadowTile & tile = shadowMap.Tile(i);
+				shadowMap.BindTile(i);
+				glClear(GL_DEPTH_BUFFER_BIT);
+				renderQueue.Begin(shadowBounds[i].center - frame.lightDirection * shadowBounds[i].radius,
+					2.0f * shadowBounds[i].radius, tile.lightSpace);
+				sceneObjects[i].model->SubmitDepth(renderQueue, PASS_SHADOW, shadowShader, sceneObjects[i].transform);
+				renderQueue.Flush();
+			}
+			glCullFace(GL_BACK);
+			shadowMap.Unbind();
+		}
+		shadowTimer.End();
+
+
+
+		/** Lights */
+		lightClusters.Build(frame.lights, view, glm::radians(frame.camera.fov), aspect, 0.1f, 100.0f);
 
 
 
@@ -193,25 +541,289 @@ int main() {
 		glViewport(0, 0, gWindowWidth, gWindowHeight);
 		#endif
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		// Skybox
-		glm::mat4 staticView = glm::mat4(glm::mat3(view)); // remove translation composition
-		skybox.Draw(skyboxShader, staticView, projection);
+		// Depth pre-pass, positions only, so the main pass shades each pixel once
+		prepassTimer.Begin();
+		if (enableDepthPrepass) {
+			renderQueue.Begin(frame.camera.position, 100.0f, frame.viewProjection);
+			for (const SceneObject & object : sceneObjects)
+				object.model->SubmitPrepass(renderQueue, PASS_DEPTH, shadowShader, object.transform);
+			renderQueue.Flush();
+		}
+		prepassTimer.End();
 		// Object shader
 		objectShader.use();
 		objectShader.setUniform("uView", view);
-		objectShader.setUniform("uProjection", projection);
-		objectShader.setUniform("uCameraPos", camera.position);
+		objectShader.setUniform("uDirectionalLight.direction", frame.lightDirection);
+		objectShader.setUniform("uCameraPos", frame.camera.position);
 		// Spot light
 		objectShader.setUniform("uEnableTorch", enableTorch);
-		objectShader.setUniform("uSpotLight.position",  camera.position);
-		objectShader.setUniform("uSpotLight.direction", camera.front);
+		objectShader.setUniform("uSpotLight.position",  frame.camera.position);
+		objectShader.setUniform("uSpotLight.direction", frame.camera.front);
 		// Shadow map
-		objectShader.setUniform("uLightSpaceMatrix", lightProjection * lightView);
-		objectShader.setUniform("uShadowMap", (int) shadowMap.active_texture_unit);
+		objectShader.setUniform("uShadowMode", (int) shadowMode);
+		if (shadowMode == SHADOW_MODE_SPHERES)
+			SetSphereOccluders(objectShader, shadowBounds, sunAngularRadius);
+		else
+			shadowMap.SetUniforms(objectShader);
 		glActiveTexture(GL_TEXTURE0 + shadowMap.active_texture_unit);
 		glBindTexture(GL_TEXTURE_2D, shadowMap.TID());
-		// Draw scene
-		renderScene(objectShader);
+		// Atmosphere, the globe is its ground
+		int framebufferWidth, framebufferHeight;
+		glfwGetFramebufferSize(gWindow, &framebufferWidth, &framebufferHeight);
+		atmosphere.Resize(framebufferWidth, framebufferHeight);
+		atmosphere.SetPlanet(shadowBounds[0].center, shadowBounds[0].radius, -frame.lightDirection);
+		atmosphere.SetUniforms(objectShader);
+		// Clustered lights
+		#ifdef __APPLE__
+		lightClusters.Bind(objectShader, 2 * gWindowWidth, 2 * gWindowHeight);
+		#else
+		lightClusters.Bind(objectShader, gWindowWidth, gWindowHeight);
+		#endif
+		// Frame constants
+		objectShader.setUniform("uGamma", adjustGamma);
+		objectShader.setUniform("uHeightScale", adjustParallax);
+		objectShader.setUniform("uQuadtreeParallax", enableQuadtreeParallax);
+		// Draw scene: opaque, only the pre-pass survivors if there was one
+		sceneTimer.Begin();
+		renderQueue.Begin(frame.camera.position, 100.0f, frame.viewProjection);
+		submitScene(renderQueue, objectShader, PASS_MAIN, sceneObjects, MESHES_OPAQUE);
+		if (enableDepthPrepass) {
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+		}
+		renderQueue.Flush();
+		frameStats.queue = renderQueue.LastStats();
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+		// Skybox, behind everything opaque so early-Z rejects the covered part
+		glm::mat4 staticView = glm::mat4(glm::mat3(view)); // remove translation composition
+		skybox.Draw(skyboxShader, staticView, projection);
+		// Asteroids on the same sky, brightest largest, the faint fading out. Zooming
+		// in reaches fainter, as a telescope would
+		frameStats.asteroids = 0;
+		if (enableAsteroids && asteroids.Count() > 0) {
+			asteroidShader.use();
+			asteroidShader.setUniform("uSkyViewProjection", projection * staticView * glm::mat4(glm::mat3(eclipticToScene)));
+			asteroidShader.setUniform("uEarth", frame.earthHeliocentric);
+			asteroidShader.setUniform("uDays", (float) (frame.julianDay - asteroids.Epoch()));
+			asteroidShader.setUniform("uLimit", asteroidLimit + 5.0f * std::log10(45.0f / frame.camera.fov));
+			asteroidShader.setUniform("uPointSize", 1.5f);
+			glDepthFunc(GL_LEQUAL);
+			glDepthMask(GL_FALSE);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+			asteroids.Draw();
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			glDepthMask(GL_TRUE);
+			glDepthFunc(GL_LESS);
+			frameStats.asteroids = asteroids.Count();
+		}
+		sceneTimer.End();
+		// Atmosphere over both, half resolution then upsampled
+		atmosphereTimer.Begin();
+		if (enableAtmosphere)
+			atmosphere.Draw(atmosphereShader, atmosphereCompositeShader,
+				view, projection, frame.camera.position, atmosphereExposure, adjustGamma);
+		atmosphereTimer.End();
+
+
+
+		/** Clouds */
+		// Last, blended over the sky
+		cloudTimer.Begin();
+		cloudLayer.SetResolution(cloudResolution);
+		cloudLayer.Resize(framebufferWidth, framebufferHeight);
+		cloudShader.use();
+		cloudShader.setUniform("uCameraPos", frame.camera.position);
+		cloudShader.setUniform("uView", view);
+		cloudShader.setUniform("uSunDirection", -frame.lightDirection);
+		cloudShader.setUniform("uSunColor", 1.0f, 1.0f, 1.0f);
+		cloudShader.setUniform("uTime", (float) glfwGetTime());
+		cloudShader.setUniform("uGamma", adjustGamma);
+		atmosphere.SetUniforms(cloudShader);
+		// the same shadows and local lights as the ground beneath
+		cloudShader.setUniform("uEnableTorch", enableTorch);
+		cloudShader.setUniform("uSpotLight.position",  frame.camera.position);
+		cloudShader.setUniform("uSpotLight.direction", frame.camera.front);
+		cloudShader.setUniform("uShadowMode", (int) shadowMode);
+		if (shadowMode == SHADOW_MODE_SPHERES)
+			SetSphereOccluders(cloudShader, shadowBounds, sunAngularRadius);
+		else
+			shadowMap.SetUniforms(cloudShader);
+		glm::ivec2 cloudTarget = cloudLayer.TargetSize();
+		lightClusters.Bind(cloudShader, cloudTarget.x, cloudTarget.y);
+		renderQueue.Begin(frame.camera.position, 100.0f, frame.viewProjection);
+		submitScene(renderQueue, cloudShader, PASS_MAIN, sceneObjects, MESHES_TRANSLUCENT);
+		if (cloudResolution == CLOUDS_FULL) {
+			// straight over the frame, premultiplied
+			glDepthMask(GL_FALSE);
+			glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+			renderQueue.Flush();
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			glDepthMask(GL_TRUE);
+		} else {
+			cloudLayer.Begin();
+			renderQueue.Flush();
+			cloudLayer.End();
+			cloudLayer.Composite(cloudCompositeShader, view, projection, frame.camera.position,
+				cloudShell.Transform(sceneObjects[0].transform));
+		}
+		cloudTimer.End();
+
+
+
+		/** Trails */
+		// Sampled here at their own pace, whatever the frame rate, so none is lost
+		// between frames; blended, under the bodies in front
+		sampleTrail(moonTrail, moonSample, frame.julianDay, 24.0, [&] (double day, float * row) {
+			glm::dvec3 moon = ephemeris.MoonGeocentric(day);
+			row[0] = (float) moon.x; row[1] = (float) moon.y; row[2] = (float) moon.z; row[3] = 1.0f;
+		});
+		if (trailed > 0)
+			sampleTrail(satelliteTrails, satelliteSample, frame.julianDay, 1440.0, [&] (double day, float * row) {
+				double sidereal = SatelliteCatalogue::SiderealAngle(day);
+				float c = (float) std::cos(sidereal), s = (float) std::sin(sidereal);
+				for (int i=0; i<trailed; i++) {
+					float * orbit = row + 4 * i, * track = row + 4 * (trailed + i);
+					satellites.PropagateSatellite((int) ((long long) i * satellites.Size() / trailed), day, orbit);
+					// Straight below, just off the ground, in the Earth-fixed frame
+					glm::vec3 below(c * orbit[0] + s * orbit[1], -s * orbit[0] + c * orbit[1], orbit[2]);
+					float height = glm::length(below);
+					below *= height > 0.0f ? 1.003f * (float) SatelliteCatalogue::EARTH_RADIUS / height : 0.0f;
+					track[0] = below.x; track[1] = below.y; track[2] = below.z; track[3] = orbit[3];
+				}
+			});
+		frameStats.trails = 0;
+		if (enableTrails) {
+			trailShader.use();
+			trailShader.setUniform("uViewProjection", frame.viewProjection);
+			glDepthMask(GL_FALSE);
+			trailShader.setUniform("uTrailToWorld", glm::translate(glm::mat4(1.0f), earthPos)
+				* glm::mat4(glm::mat3(eclipticToScene)) * glm::scale(glm::mat4(1.0f), glm::vec3((float) moonScale)));
+			trailShader.setUniform("uColor", glm::vec4(0.8f, 0.8f, 0.85f, 0.6f));
+			moonTrail.Draw(trailShader);
+			frameStats.trails = moonTrail.Trails();
+			if (enableSatellites && trailed > 0) {
+				trailShader.setUniform("uTrailToWorld", frame.temeToWorld);
+				trailShader.setUniform("uTrackToWorld", frame.earthFixedToWorld);
+				trailShader.setUniform("uColor", glm::vec4(0.3f, 0.9f, 1.0f, 0.5f));
+				trailShader.setUniform("uTrackColor", glm::vec4(1.0f, 0.85f, 0.3f, 0.5f));
+				satelliteTrails.Draw(trailShader);
+				frameStats.trails += satelliteTrails.Trails();
+			}
+			glDepthMask(GL_TRUE);
+		}
+
+
+
+		/** Satellites */
+		// Over everything, hidden only by the bodies
+		frameStats.satellites = 0;
+		frameStats.propagationMs = 0.0;
+		if (enableSatellites && satellites.Size() > 0) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			float * positions = satelliteCloud.Map(satellites.Size());
+			if (positions) {
+				satellites.Propagate(frame.julianDay, positions, &propagationPool);
+				satelliteCloud.Unmap();
+			}
+			frameStats.propagationMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			frameStats.satellites = satelliteCloud.Count();
+			satelliteShader.use();
+			satelliteShader.setUniform("uViewProjection", frame.viewProjection);
+			satelliteShader.setUniform("uTemeToWorld", frame.temeToWorld);
+			satelliteShader.setUniform("uPointSize", 3.0f);
+			satelliteShader.setUniform("uHighlight", glm::vec4(0.0f));
+			glDepthMask(GL_FALSE);
+			satelliteCloud.Draw();
+
+			// Both satellites of every recent conjunction, where they are now
+			float * flagged = frame.conjunctions.empty() ? NULL : conjunctionCloud.Map(2 * (int) frame.conjunctions.size());
+			if (flagged) {
+				for (size_t i=0; i<frame.conjunctions.size(); i++) {
+					satellites.PropagateSatellite(frame.conjunctions[i].first, frame.julianDay, flagged + 8 * i);
+					satellites.PropagateSatellite(frame.conjunctions[i].second, frame.julianDay, flagged + 8 * i + 4);
+				}
+				conjunctionCloud.Unmap();
+				satelliteShader.setUniform("uPointSize", 9.0f);
+				satelliteShader.setUniform("uHighlight", glm::vec4(1.0f, 0.2f, 0.8f, 1.0f));
+				conjunctionCloud.Draw();
+			}
+			glDepthMask(GL_TRUE);
+		}
+		frameStats.conjunctions = enableSatellites ? (int) frame.conjunctions.size() : 0;
+		frameStats.screeningMs = frame.screeningMs;
+
+
+
+		/** N-body field */
+		// Uploaded when a new step is in, drawn additively
+		if (fieldFrames.Update() && !fieldFrames.Front().positions.empty()) {
+			const std::vector<float> & positions = fieldFrames.Front().positions;
+			float * mapped = fieldCloud.Map((int) positions.size() / 4);
+			if (mapped) {
+				std::memcpy(mapped, positions.data(), positions.size() * sizeof(float));
+				fieldCloud.Unmap();
+			}
+		}
+		frameStats.field = fieldFrames.Front().stats;
+		if (!fieldFrames.Front().positions.empty() && fieldCloud.Count() > 0) {
+			particleShader.use();
+			particleShader.setUniform("uViewProjection", frame.viewProjection);
+			particleShader.setUniform("uFieldToWorld", frame.temeToWorld
+				* glm::scale(glm::mat4(1.0f), glm::vec3((float) SatelliteCatalogue::EARTH_RADIUS)));
+			particleShader.setUniform("uPointSize", 2.0f);
+			particleShader.setUniform("uColor", fieldFrames.Front().scenario == NBODY_RING ?
+				glm::vec4(1.0f, 0.8f, 0.55f, 0.35f) : glm::vec4(0.85f, 0.9f, 1.0f, 0.5f));
+			glDepthMask(GL_FALSE);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+			fieldCloud.Draw();
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			glDepthMask(GL_TRUE);
+		}
+
+
+
+		/** Flow */
+		// Stepped and drawn by the GPU alone, additively, just over the globe
+		double flowSeconds = glfwGetTime();
+		float flowStep = (float) glm::min(flowSeconds - lastFlowSeconds, 0.1);
+		lastFlowSeconds = flowSeconds;
+		if (flowMode != lastFlowMode) {
+			flow.Reset();
+			lastFlowMode = flowMode;
+		}
+		frameStats.flowParticles = 0;
+		if (flowMode != FLOW_OFF) {
+			flowUpdateShader.use();
+			flowUpdateShader.setUniform("uMode", (int) flowMode);
+			flowUpdateShader.setUniform("uSpeedup", flowSpeedup);
+			flow.Update(flowUpdateShader, flowStep);
+
+			flowShader.use();
+			flowShader.setUniform("uViewProjection", frame.viewProjection);
+			flowShader.setUniform("uEarthFixedToWorld", frame.earthFixedToWorld);
+			flowShader.setUniform("uMagneticToFixed", magneticToFixed);
+			flowShader.setUniform("uMode", (int) flowMode);
+			flowShader.setUniform("uSpeedup", flowSpeedup);
+			flowShader.setUniform("uStreak", 0.3f);
+			flowShader.setUniform("uColor", flowMode == FLOW_AURORA ?
+				glm::vec4(1.0f, 1.0f, 1.0f, 0.5f) : glm::vec4(0.85f, 0.95f, 1.0f, 0.6f));
+			glDepthMask(GL_FALSE);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+			flow.Draw(flowShader);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			glDepthMask(GL_TRUE);
+			frameStats.flowParticles = flow.Size();
+		}
+		frameStats.lights = lightClusters.LastStats();
+		frameStats.shadowMs = shadowTimer.Milliseconds();
+		frameStats.shadowCache = shadowMap.CacheTotals();
+		frameStats.prepassMs = enableDepthPrepass ? prepassTimer.Milliseconds() : 0.0;
+		frameStats.atmosphereMs = enableAtmosphere ? atmosphereTimer.Milliseconds() : 0.0;
+		frameStats.cloudMs = cloudTimer.Milliseconds();
+		frameStats.simulationMs = frame.simulationMs;
+		frameStats.julianDay = frame.julianDay;
+		frameStats.sceneMs = sceneTimer.Milliseconds();
 
 
 
@@ -219,62 +831,54 @@ int main() {
 		glfwPollEvents();
 		glfwSwapBuffers(gWindow);
 	}
-	
-	glfwTerminate();
-
-	return 0;
 }
 
-void renderScene(Shader & shader) {
-
-	// Set geological configurations
-	float currentTime = (float)glfwGetTime();
-	float angularVelocity = glm::radians(10.0f);
-	// earth
-	glm::vec3 spinAxis(
-		glm::sin(glm::radians(23.5f)) * glm::cos(currentTime * angularVelocity / 30.0f),
-		glm::cos(glm::radians(23.5f)),
-		glm::sin(glm::radians(23.5f)) * glm::sin(currentTime * angularVelocity / 30.0f));
-	glm::vec3 deviateAxis(
-		glm::sin(currentTime * angularVelocity / 30.0f),
-		0.0f,
-		-glm::cos(currentTime * angularVelocity / 30.0f));
-	// moon
-	float moonTrjRadius = 20.0f;
-	glm::vec3 moonPos(
-		moonTrjRadius * glm::cos(currentTime * angularVelocity / 1.0f),
-		0.0f,
-		moonTrjRadius * glm::sin(currentTime * angularVelocity / 1.0f));
-	
-	// Draw scene
+void updateScene(std::vector<SceneObject> & objects, glm::mat4 & temeToWorld, glm::mat4 & earthFixedToWorld,
+	const Ephemeris & ephemeris, double day, unsigned int earthFlags) {
+
+	// The models are y up like the scene, so their body frame (z the pole) is model (x, -z, y)
+	static const glm::dmat3 modelToBody(1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, -1.0, 0.0);
+
+	glm::mat3 earthRotation(eclipticToScene * Ephemeris::EarthOrientation(day) * modelToBody);
+	glm::mat3 moonRotation(eclipticToScene * Ephemeris::MoonOrientation(day) * modelToBody);
+	glm::vec3 moonPos = earthPos + glm::vec3(eclipticToScene * ephemeris.MoonGeocentric(day) * moonScale);
+
+	objects.clear();
 	glm::mat4 modelMatrix;
 
-	modelMatrix = glm::mat4(1.0f);
-	modelMatrix = glm::translate(modelMatrix, glm::vec3(0.0f, 0.0f, -1.0f));
+	modelMatrix = glm::translate(glm::mat4(1.0f), earthPos) * glm::mat4(earthRotation);
 	modelMatrix = glm::scale(modelMatrix, glm::vec3(0.02f, 0.02f, 0.02f));
-	modelMatrix = glm::rotate(modelMatrix, currentTime * angularVelocity, spinAxis);
-	modelMatrix = glm::rotate(modelMatrix, glm::radians(23.5f), deviateAxis);
-
-	shader.use();
-	shader.setUniform("uModel", modelMatrix);
-	shader.setUniform("uTime", currentTime);
-	shader.setUniform("uGamma", adjustGamma);
-	shader.setUniform("uHeightScale", adjustParallax);
-	if (enableNormal)
-		shader.setUniform("uEnableNormal", true);
-	shader.setUniform("uEnableEmission", true);
-	pObjEarth.get()->Draw(shader);
-
-	modelMatrix = glm::mat4(1.0f);
-	modelMatrix = glm::translate(modelMatrix, moonPos);
+
+	SceneObject earth = {pObjEarth.get(), modelMatrix, glm::transpose(glm::inverse(glm::mat3(modelMatrix))), earthFlags};
+	objects.push_back(earth);
+
+	// Satellites: TEME turned by sidereal time is the Earth-fixed body frame,
+	// and an Earth radius is the globe's
+	static const Bounds globe = pObjEarth->SelectionBounds(MESHES_OPAQUE);
+	double sidereal = SatelliteCatalogue::SiderealAngle(day);
+	glm::dmat3 temeToBody(std::cos(sidereal), -std::sin(sidereal), 0.0, std::sin(sidereal), std::cos(sidereal), 0.0, 0.0, 0.0, 1.0);
+	earthFixedToWorld = modelMatrix * glm::translate(glm::mat4(1.0f), globe.center)
+		* glm::scale(glm::mat4(1.0f), glm::vec3(globe.radius / (float) SatelliteCatalogue::EARTH_RADIUS))
+		* glm::mat4(glm::mat3(glm::transpose(modelToBody)));
+	temeToWorld = earthFixedToWorld * glm::mat4(glm::mat3(temeToBody));
+
+	modelMatrix = glm::translate(glm::mat4(1.0f), moonPos) * glm::mat4(moonRotation);
 	modelMatrix = glm::scale(modelMatrix, glm::vec3(0.5f, 0.5f, 0.5f));
-	modelMatrix = glm::rotate(modelMatrix, currentTime * angularVelocity, glm::vec3(0.0f, 1.0f, 0.0f));
 
-	shader.use();
-	shader.setUniform("uModel", modelMatrix);
-	shader.setUniform("uEnableNormal", false);
-	shader.setUniform("uEnableEmission", false);
-	pObjMoon.get()->Draw(shader);
+	SceneObject moon = {pObjMoon.get(), modelMatrix, glm::transpose(glm::inverse(glm::mat3(modelMatrix))), 0};
+	objects.push_back(moon);
+}
+
+unsigned int earthFlags() {
+	return (enableNormal ? (unsigned int) DRAW_NORMAL : 0u) | DRAW_EMISSION | (enableAtmosphere ? (unsigned int) DRAW_ATMOSPHERE : 0u);
+}
+
+void submitScene(RenderQueue & queue, Shader & shader, unsigned int pass,
+	const std::vector<SceneObject> & objects, MeshSelection selection) {
+
+	// Draw order is up to the queue
+	for (const SceneObject & object : objects)
+		object.model->Submit(queue, pass, shader, object.transform, object.normalMatrix, object.flags, selection);
 }
 
 //-----------------------------------------------------------------------------
@@ -387,6 +991,26 @@ void processInput(GLFWwindow* window) {
 		enableTorch = !enableTorch;
 	if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS)
 		enableNormal = !enableNormal;
+	if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS)
+		shadowMode = shadowMode == SHADOW_MODE_MAP ? SHADOW_MODE_SPHERES : SHADOW_MODE_MAP;
+	if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS)
+		enableDepthPrepass = !enableDepthPrepass;
+	if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
+		enableQuadtreeParallax = !enableQuadtreeParallax;
+	if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS)
+		enableAtmosphere = !enableAtmosphere;
+	if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS)
+		enableSatellites = !enableSatellites;
+	if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS)
+		enableAsteroids = !enableAsteroids;
+	if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS)
+		enableTrails = !enableTrails;
+	if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS) // off, wind, aurora
+		flowMode = flowMode == FLOW_AURORA ? FLOW_OFF : (FlowMode) (flowMode + 1);
+	if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS) // off, debris, ring
+		nbodyScenario = nbodyScenario == NBODY_RING ? NBODY_OFF : (NBodyScenario) (nbodyScenario + 1);
+	if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS) // full, half, quarter
+		cloudResolution = cloudResolution == CLOUDS_QUARTER ? CLOUDS_FULL : (CloudResolution) (cloudResolution * 2);
 
 	if (glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS)
 		adjustGamma = adjustGamma >= 4.0f ? 4.0f : adjustGamma + 0.01f;
@@ -396,6 +1020,10 @@ void processInput(GLFWwindow* window) {
 		adjustParallax = adjustParallax >= 1.0f ? 1.0f : adjustParallax + 0.0005f;
 	if (glfwGetKey(window, GLFW_KEY_COMMA) == GLFW_PRESS)
 		adjustParallax = adjustParallax <= 0.0f ? 0.0f : adjustParallax - 0.0005f;
+	if (glfwGetKey(window, GLFW_KEY_RIGHT_BRACKET) == GLFW_PRESS) // up to a year per second
+		timeWarp = timeWarp >= 3.0e7 ? 3.0e7 : timeWarp * 1.05;
+	if (glfwGetKey(window, GLFW_KEY_LEFT_BRACKET) == GLFW_PRESS)  // down to real time
+		timeWarp = timeWarp <= 1.0 ? 1.0 : timeWarp / 1.05;
 }
 
 //-----------------------------------------------------------------------------
@@ -440,10 +1068,11 @@ void glfw_onFramebufferSize(GLFWwindow* window, int width, int height)
 // Code computes the average frames per second, and also the average time it takes
 // to render one frame.  These stats are appended to the window caption bar.
 //-----------------------------------------------------------------------------
-void showFPS(GLFWwindow* window)
+void showFPS(GLFWwindow* window, const FrameStats & stats)
 {
 	static double previousSeconds = 0.0;
 	static int frameCount = 0;
+	static ParallelShadow::CacheStats previousCache = ParallelShadow::CacheStats();
 	double elapsedSeconds;
 	double currentSeconds = glfwGetTime(); // returns number of seconds since GLFW started, as double float
 
@@ -456,13 +1085,35 @@ void showFPS(GLFWwindow* window)
 		double fps = (double)frameCount / elapsedSeconds;
 		double msPerFrame = 1000.0 / fps;
 
+		// Shadow tiles kept over the same window
+		unsigned long long tests = stats.shadowCache.tests - previousCache.tests;
+		unsigned long long hits = stats.shadowCache.hits - previousCache.hits;
+		previousCache = stats.shadowCache;
+
 		// The C++ way of setting the window title
 		std::ostringstream outs;
 		outs.precision(3);	// decimal places
 		outs << std::fixed
 			<< APP_TITLE << "    "
+			<< Ephemeris::Date(stats.julianDay) << " UTC x" << (int) timeWarp << "    "
 			<< "FPS: " << fps << "    "
-			<< "Frame Time: " << msPerFrame << " (ms)";
+			<< "Frame Time: " << msPerFrame << " (ms)    "
+			<< "Simulation: " << stats.simulationMs << " (CPU ms)    "
+			<< "Draws: " << stats.queue.draws << "    "
+			<< "Culled: " << stats.queue.culled << "    "
+			<< "Lights: " << stats.lights.lights << "    "
+			<< (shadowMode == SHADOW_MODE_MAP ? "Shadow map: " : "Shadow spheres: ")
+			<< stats.shadowMs << " (" << (tests > 0 ? 100 * hits / tests : 0) << "% cached) + "
+			<< (enableDepthPrepass ? "Pre-pass: " : "No pre-pass: ") << stats.prepassMs << " + "
+			<< "Scene: " << stats.sceneMs << " + "
+			<< "Atmosphere: " << stats.atmosphereMs << " + "
+			<< "Clouds 1/" << (int) cloudResolution << ": " << stats.cloudMs << " (GPU ms)    "
+			<< "Satellites: " << stats.satellites << " in " << stats.propagationMs << " (CPU ms)    "
+			<< "Conjunctions: " << stats.conjunctions << " in " << stats.screeningMs << " (CPU ms)    "
+			<< "Asteroids: " << stats.asteroids << "    "
+			<< "Trails: " << stats.trails << "    "
+			<< (flowMode == FLOW_AURORA ? "Aurora: " : "Wind: ") << stats.flowParticles << "    "
+			<< "N-body: " << stats.field.particles << " in " << stats.field.stepMs << " (CPU ms/step)";
 		glfwSetWindowTitle(window, outs.str().c_str());
 
 		// Reset for next average.
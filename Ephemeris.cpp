@@ -0,0 +1,412 @@
+#include <Ephemeris.h>
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const double Ephemeris::J2000 = 2451545.0;
+const double Ephemeris::AU = 149597870.7;
+const double Ephemeris::EARTH_MOON_MASS_RATIO = 81.30057;
+
+static const double PI = 3.14159265358979323846;
+static const double DEG = PI / 180.0;
+static const char EPHEMERIS_MAGIC[4] = {'E', 'P', 'H', '1'};
+
+//-----------------------------------------------------------------------------
+// Planets: J2000 ecliptic elements and rates per Julian century,
+// a (au), e, I, L, long. perihelion, long. node (degrees)
+//-----------------------------------------------------------------------------
+static const double PLANET_ELEMENTS[8][2][6] = {
+	{{ 0.38709927, 0.20563593,  7.00497902,  252.25032350,  77.45779628,  48.33076593},
+	 { 0.00000037, 0.00001906, -0.00594749, 149472.67411175, 0.16047689, -0.12534081}}, // Mercury
+	{{ 0.72333566, 0.00677672,  3.39467605,  181.97909950, 131.60246718,  76.67984255},
+	 { 0.00000390,-0.00004107, -0.00078890,  58517.81538729, 0.00268329, -0.27769418}}, // Venus
+	{{ 1.00000261, 0.01671123, -0.00001531,  100.46457166, 102.93768193,   0.0       },
+	 { 0.00000562,-0.00004392, -0.01294668,  35999.37244981, 0.32327364,   0.0       }}, // Earth-Moon
+	{{ 1.52371034, 0.09339410,  1.84969142,   -4.55343205, -23.94362959,  49.55953891},
+	 { 0.00001847, 0.00007882, -0.00813131,  19140.30268499, 0.44441088, -0.29257343}}, // Mars
+	{{ 5.20288700, 0.04838624,  1.30439695,   34.39644051,  14.72847983, 100.47390909},
+	 {-0.00011607,-0.00013253, -0.00183714,   3034.74612775, 0.21252668,  0.20469106}}, // Jupiter
+	{{ 9.53667594, 0.05386179,  2.48599187,   49.95424423,  92.59887831, 113.66242448},
+	 {-0.00125060,-0.00050991,  0.00193609,   1222.49362201,-0.41897216, -0.28867794}}, // Saturn
+	{{19.18916464, 0.04725744,  0.77263783,  313.23810451, 170.95427630,  74.01692503},
+	 {-0.00196176,-0.00004397, -0.00242939,    428.48202785, 0.40805281,  0.04240589}}, // Uranus
+	{{30.06992276, 0.00859048,  1.77004347,  -55.12002969,  44.96476227, 131.78422574},
+	 { 0.00026291, 0.00005105,  0.00035372,    218.45945325,-0.32241464, -0.01262724}}  // Neptune
+};
+
+//-----------------------------------------------------------------------------
+// Moon: periodic terms of longitude (1e-6 deg) and distance (1e-3 km), then
+// latitude (1e-6 deg), multiples of D, M, M', F
+//-----------------------------------------------------------------------------
+struct LunarTerm { signed char d, m, mp, f; int a, b; };
+
+static const LunarTerm LUNAR_LR[] = {
+	{0, 0, 1, 0, 6288774,-20905355}, {2, 0,-1, 0, 1274027,-3699111}, {2, 0, 0, 0, 658314,-2955968},
+	{0, 0, 2, 0,  213618,  -569925}, {0, 1, 0, 0, -185116,   48888}, {0, 0, 0, 2,-114332,   -3149},
+	{2, 0,-2, 0,   58793,   246158}, {2,-1,-1, 0,   57066, -152138}, {2, 0, 1, 0,  53322, -170733},
+	{2,-1, 0, 0,   45758,  -204586}, {0, 1,-1, 0,  -40923, -129620}, {1, 0, 0, 0, -34720,  108743},
+	{0, 1, 1, 0,  -30383,   104755}, {2, 0, 0,-2,   15327,   10321}, {0, 0, 1, 2, -12528,       0},
+	{0, 0, 1,-2,   10980,    79661}, {4, 0,-1, 0,   10675,  -34782}, {0, 0, 3, 0,  10034,  -23210},
+	{4, 0,-2, 0,    8548,   -21636}, {2, 1,-1, 0,   -7888,   24208}, {2, 1, 0, 0,  -6766,   30824},
+	{1, 0,-1, 0,   -5163,    -8379}, {1, 1, 0, 0,    4987,  -16675}, {2,-1, 1, 0,   4036,  -12831},
+	{2, 0, 2, 0,    3994,   -10445}, {4, 0, 0, 0,    3861,  -11650}, {2, 0,-3, 0,   3665,   14403},
+	{0, 1,-2, 0,   -2689,    -7003}, {2, 0,-1, 2,   -2602,       0}, {2,-1,-2, 0,   2390,   10056},
+	{1, 0, 1, 0,   -2348,     6322}, {2,-2, 0, 0,    2236,   -9884}, {0, 1, 2, 0,  -2120,    5751},
+	{0, 2, 0, 0,   -2069,        0}, {2,-2,-1, 0,    2048,   -4950}, {2, 0, 1,-2,  -1773,    4130},
+	{2, 0, 0, 2,   -1595,        0}, {4,-1,-1, 0,    1215,   -3958}, {0, 0, 2, 2,  -1110,       0},
+	{3, 0,-1, 0,    -892,     3258}, {2, 1, 1, 0,    -810,    2616}, {4,-1,-2, 0,    759,   -1897},
+	{0, 2,-1, 0,    -713,    -2117}, {2, 2,-1, 0,    -700,    2354}, {2, 1,-2, 0,    691,       0},
+	{2,-1, 0,-2,     596,        0}, {4, 0, 1, 0,     549,   -1423}, {0, 0, 4, 0,    537,   -1117},
+	{4,-1, 0, 0,     520,    -1571}, {1, 0,-2, 0,    -487,   -1739}, {2, 1, 0,-2,   -399,       0},
+	{0, 0, 2,-2,    -381,    -4421}, {1, 1, 1, 0,     351,       0}, {3, 0,-2, 0,   -340,       0},
+	{4, 0,-3, 0,     330,        0}, {2,-1, 2, 0,     327,       0}, {0, 2, 1, 0,   -323,    1165},
+	{1, 1,-1, 0,     299,        0}, {2, 0, 3, 0,     294,       0}, {2, 0,-1,-2,      0,    8752}
+};
+
+static const LunarTerm LUNAR_B[] = {
+	{0, 0, 0, 1, 5128122, 0}, {0, 0, 1, 1, 280602, 0}, {0, 0, 1,-1, 277693, 0}, {2, 0, 0,-1, 173237, 0},
+	{2, 0,-1, 1,   55413, 0}, {2, 0,-1,-1,  46271, 0}, {2, 0, 0, 1,  32573, 0}, {0, 0, 2, 1,  17198, 0},
+	{2, 0, 1,-1,    9266, 0}, {0, 0, 2,-1,   8822, 0}, {2,-1, 0,-1,   8216, 0}, {2, 0,-2,-1,   4324, 0},
+	{2, 0, 1, 1,    4200, 0}, {2, 1, 0,-1,  -3359, 0}, {2,-1,-1, 1,   2463, 0}, {2,-1, 0, 1,   2211, 0},
+	{2,-1,-1,-1,    2065, 0}, {0, 1,-1,-1,  -1870, 0}, {4, 0,-1,-1,   1828, 0}, {0, 1, 0, 1,  -1794, 0},
+	{0, 0, 0, 3,   -1749, 0}, {0, 1,-1, 1,  -1565, 0}, {1, 0, 0, 1,  -1491, 0}, {0, 1, 1, 1,  -1475, 0},
+	{0, 1, 1,-1,   -1410, 0}, {0, 1, 0,-1,  -1344, 0}, {1, 0, 0,-1,  -1335, 0}, {0, 0, 3, 1,   1107, 0},
+	{4, 0, 0,-1,    1021, 0}, {4, 0,-1, 1,    833, 0}, {0, 0, 1,-3,    777, 0}, {4, 0,-2, 1,    671, 0},
+	{2, 0, 0,-3,     607, 0}, {2, 0, 2,-1,    596, 0}, {2,-1, 1,-1,    491, 0}, {2, 0,-2, 1,   -451, 0},
+	{0, 0, 3,-1,     439, 0}, {2, 0, 2, 1,    422, 0}, {2, 0,-3,-1,    421, 0}, {2, 1,-1, 1,   -366, 0},
+	{2, 1, 0, 1,    -351, 0}, {4, 0, 0, 1,    331, 0}, {2,-1, 1, 1,    315, 0}, {2,-2, 0,-1,    302, 0},
+	{0, 0, 1, 3,    -283, 0}, {2, 1, 1,-1,   -229, 0}, {1, 1, 0,-1,    223, 0}, {1, 1, 0, 1,    223, 0},
+	{0, 1,-2,-1,    -220, 0}, {2, 1,-1,-1,   -220, 0}, {1, 0, 1, 1,   -185, 0}, {2,-1,-2,-1,    181, 0},
+	{0, 1, 2, 1,    -177, 0}, {4, 0,-2,-1,    176, 0}, {4,-1,-1,-1,    166, 0}, {1, 0, 1,-1,   -164, 0},
+	{4, 0, 1,-1,     132, 0}, {1, 0,-1,-1,   -119, 0}, {4,-1, 0,-1,    115, 0}, {2,-2, 0, 1,    107, 0}
+};
+
+//-----------------------------------------------------------------------------
+// Chebyshev windows: the faster a body moves, the shorter its windows
+//-----------------------------------------------------------------------------
+struct FitWindow { double days; int degree; };
+
+static const FitWindow FIT_WINDOWS[BODY_COUNT] = {
+	{ 16.0, 10}, // Mercury
+	{ 32.0, 10}, // Venus
+	{ 32.0, 10}, // Earth-Moon
+	{ 64.0, 10}, // Mars
+	{256.0, 10}, // Jupiter
+	{256.0, 10}, // Saturn
+	{512.0, 10}, // Uranus
+	{512.0, 10}, // Neptune
+	{  8.0, 13}  // Moon
+};
+
+struct EphemerisHeader {
+	char magic[4];
+	uint32_t bodies;
+	double firstDay, lastDay;
+	FitWindow windows[BODY_COUNT];
+};
+
+static double wrapDegrees(double degrees) {
+	degrees = std::fmod(degrees, 360.0);
+	return degrees < 0.0 ? degrees + 360.0 : degrees;
+}
+
+static int windowCount(const FitWindow & window, double firstDay, double lastDay) {
+	return std::max(1, (int) std::ceil((lastDay - firstDay) / window.days));
+}
+
+static glm::dvec3 planetPosition(int planet, double day) {
+
+	double T = (day - Ephemeris::J2000) / 36525.0;
+	double element[6];
+	for (int i=0; i<6; i++)
+		element[i] = PLANET_ELEMENTS[planet][0][i] + PLANET_ELEMENTS[planet][1][i] * T;
+	double a = element[0], e = element[1];
+	double I = element[2] * DEG, node = element[5] * DEG;
+	double perihelion = element[4] * DEG - node; // argument of perihelion
+	double M = wrapDegrees(element[3] - element[4]) * DEG;
+
+	// Kepler's equation, Newton from E = M; converges in a handful of steps for e < 0.25
+	double E = M;
+	for (int i=0; i<8; i++) {
+		double step = (E - e * std::sin(E) - M) / (1.0 - e * std::cos(E));
+		E -= step;
+		if (std::abs(step) < 1e-14)
+			break;
+	}
+	double x = a * (std::cos(E) - e), y = a * std::sqrt(1.0 - e * e) * std::sin(E);
+
+	double cw = std::cos(perihelion), sw = std::sin(perihelion);
+	double cn = std::cos(node), sn = std::sin(node);
+	double ci = std::cos(I), si = std::sin(I);
+	return Ephemeris::AU * glm::dvec3(
+		(cw * cn - sw * sn * ci) * x + (-sw * cn - cw * sn * ci) * y,
+		(cw * sn + sw * cn * ci) * x + (-sw * sn + cw * cn * ci) * y,
+		(sw * si) * x + (cw * si) * y);
+}
+
+static glm::dvec3 moonPosition(double day) {
+
+	double T = (day - Ephemeris::J2000) / 36525.0;
+	double T2 = T * T, T3 = T2 * T, T4 = T3 * T;
+	double Lp = 218.3164477 + 481267.88123421 * T - 0.0015786 * T2 + T3 / 538841.0 - T4 / 65194000.0;
+	double D  = 297.8501921 + 445267.1114034 * T - 0.0018819 * T2 + T3 / 545868.0 - T4 / 113065000.0;
+	double M  = 357.5291092 + 35999.0502909 * T - 0.0001536 * T2 + T3 / 24490000.0;
+	double Mp = 134.9633964 + 477198.8675055 * T + 0.0087414 * T2 + T3 / 69699.0 - T4 / 14712000.0;
+	double F  = 93.2720950 + 483202.0175233 * T - 0.0036539 * T2 - T3 / 3526000.0 + T4 / 863310000.0;
+	double A1 = (119.75 + 131.849 * T) * DEG;
+	double A2 = (53.09 + 479264.290 * T) * DEG;
+	double A3 = (313.45 + 481266.484 * T) * DEG;
+	double E = 1.0 - 0.002516 * T - 0.0000074 * T2; // eccentricity of the Earth's orbit, scales M terms
+	double eccentricity[3] = {1.0, E, E * E};
+	Lp = wrapDegrees(Lp) * DEG; D = wrapDegrees(D) * DEG; M = wrapDegrees(M) * DEG;
+	Mp = wrapDegrees(Mp) * DEG; F = wrapDegrees(F) * DEG;
+
+	double sumL = 0.0, sumR = 0.0, sumB = 0.0;
+	for (const LunarTerm & term : LUNAR_LR) {
+		double argument = term.d * D + term.m * M + term.mp * Mp + term.f * F;
+		double scale = eccentricity[std::abs(term.m)];
+		sumL += term.a * scale * std::sin(argument);
+		sumR += term.b * scale * std::cos(argument);
+	}
+	for (const LunarTerm & term : LUNAR_B) {
+		double argument = term.d * D + term.m * M + term.mp * Mp + term.f * F;
+		sumB += term.a * eccentricity[std::abs(term.m)] * std::sin(argument);
+	}
+	// Venus, Jupiter and the Earth's flattening
+	sumL += 3958.0 * std::sin(A1) + 1962.0 * std::sin(Lp - F) + 318.0 * std::sin(A2);
+	sumB += -2235.0 * std::sin(Lp) + 382.0 * std::sin(A3) + 175.0 * std::sin(A1 - F)
+		+ 175.0 * std::sin(A1 + F) + 127.0 * std::sin(Lp - Mp) - 115.0 * std::sin(Lp + Mp);
+
+	// Ecliptic of date to J2000 through the general precession in longitude
+	double longitude = Lp + sumL * 1e-6 * DEG - 1.3969713 * T * DEG;
+	double latitude = sumB * 1e-6 * DEG;
+	double distance = 385000.56 + sumR * 1e-3;
+	return distance * glm::dvec3(
+		std::cos(latitude) * std::cos(longitude),
+		std::cos(latitude) * std::sin(longitude),
+		std::sin(latitude));
+}
+
+// IAU body frame: z along the pole (right ascension, declination), x at the prime meridian W
+static glm::dmat3 bodyOrientation(double alpha, double delta, double W) {
+
+	double a = (alpha + 90.0) * DEG, b = (90.0 - delta) * DEG, w = wrapDegrees(W) * DEG;
+	// glm is column major: columns below are the images of x, y, z
+	glm::dmat3 Rz1(std::cos(a), std::sin(a), 0.0, -std::sin(a), std::cos(a), 0.0, 0.0, 0.0, 1.0);
+	glm::dmat3 Rx(1.0, 0.0, 0.0, 0.0, std::cos(b), std::sin(b), 0.0, -std::sin(b), std::cos(b));
+	glm::dmat3 Rz2(std::cos(w), std::sin(w), 0.0, -std::sin(w), std::cos(w), 0.0, 0.0, 0.0, 1.0);
+
+	// Equatorial (ICRF) to J2000 ecliptic, about x by the obliquity
+	double e = 23.4392911 * DEG;
+	glm::dmat3 toEcliptic(1.0, 0.0, 0.0, 0.0, std::cos(e), -std::sin(e), 0.0, std::sin(e), std::cos(e));
+
+	return toEcliptic * Rz1 * Rx * Rz2;
+}
+
+//-----------------------------------------------------------------------------
+// Ephemeris
+//-----------------------------------------------------------------------------
+Ephemeris :: Ephemeris(double firstDay, double lastDay, const std::string & cacheFile)
+	: firstDay(firstDay), lastDay(lastDay), fitSeconds(0.0),
+	coefficients(NULL), coefficientCount(0), mapping(NULL), mappingSize(0)
+{
+	layout();
+
+	if (cacheFile.empty() || !mapCache(cacheFile)) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		fit();
+		fitSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "Ephemeris::Ephemeris: fitted in " << fitSeconds << " s\n";
+		if (!cacheFile.empty())
+			writeCache(cacheFile);
+	}
+}
+
+Ephemeris :: ~Ephemeris() {
+	if (mapping)
+		munmap(mapping, mappingSize);
+}
+
+void Ephemeris :: layout() {
+
+	size_t offset = 0;
+	for (int b=0; b<BODY_COUNT; b++) {
+		offsets[b] = offset;
+		offset += (size_t) windowCount(FIT_WINDOWS[b], firstDay, lastDay) * 3 * (FIT_WINDOWS[b].degree + 1);
+	}
+	coefficientCount = offset;
+}
+
+void Ephemeris :: fit() {
+
+	owned.assign(coefficientCount, 0.0);
+
+	for (int b=0; b<BODY_COUNT; b++) {
+		const FitWindow & window = FIT_WINDOWS[b];
+		int windows = windowCount(window, firstDay, lastDay);
+		int n = window.degree + 1;
+		std::vector<glm::dvec3> samples(n);
+
+		for (int w=0; w<windows; w++) {
+			// Sample at the Chebyshev nodes of the window
+			double middle = firstDay + (w + 0.5) * window.days, half = 0.5 * window.days;
+			for (int k=0; k<n; k++)
+				samples[k] = SeriesPosition((EphemerisBody) b, middle + half * std::cos(PI * (k + 0.5) / n));
+
+			double * c = &owned[offsets[b] + (size_t) w * 3 * n];
+			for (int j=0; j<n; j++) {
+				glm::dvec3 sum(0.0);
+				for (int k=0; k<n; k++)
+					sum += samples[k] * std::cos(PI * j * (k + 0.5) / n);
+				sum *= (j == 0 ? 1.0 : 2.0) / n;
+				c[0 * n + j] = sum.x;
+				c[1 * n + j] = sum.y;
+				c[2 * n + j] = sum.z;
+			}
+		}
+	}
+
+	coefficients = owned.data();
+}
+
+bool Ephemeris :: mapCache(const std::string & filename) {
+
+	int file = open(filename.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	size_t expected = sizeof(EphemerisHeader) + coefficientCount * sizeof(double);
+	if (fstat(file, &info) != 0 || (size_t) info.st_size != expected) {
+		close(file);
+		return false;
+	}
+	void * data = mmap(NULL, expected, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (data == MAP_FAILED)
+		return false;
+
+	// Same span and windows, or the offsets would be wrong
+	const EphemerisHeader * header = (const EphemerisHeader *) data;
+	bool valid = std::memcmp(header->magic, EPHEMERIS_MAGIC, 4) == 0
+		&& header->bodies == BODY_COUNT
+		&& header->firstDay == firstDay && header->lastDay == lastDay
+		&& std::memcmp(header->windows, FIT_WINDOWS, sizeof(FIT_WINDOWS)) == 0;
+	if (!valid) {
+		munmap(data, expected);
+		return false;
+	}
+
+	mapping = data;
+	mappingSize = expected;
+	coefficients = (const double *) ((const char *) data + sizeof(EphemerisHeader));
+	return true;
+}
+
+void Ephemeris :: writeCache(const std::string & filename) const {
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		std::cerr << "Ephemeris::writeCache: Unable to write " << filename << "\n";
+		return;
+	}
+
+	EphemerisHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, EPHEMERIS_MAGIC, 4);
+	header.bodies = BODY_COUNT;
+	header.firstDay = firstDay;
+	header.lastDay = lastDay;
+	std::memcpy(header.windows, FIT_WINDOWS, sizeof(FIT_WINDOWS));
+	file.write((const char *) &header, sizeof(header));
+	file.write((const char *) owned.data(), owned.size() * sizeof(double));
+}
+
+glm::dvec3 Ephemeris :: Position(EphemerisBody body, double day) const {
+
+	if (day < firstDay || day >= lastDay)
+		return SeriesPosition(body, day);
+
+	const FitWindow & window = FIT_WINDOWS[body];
+	int windows = windowCount(window, firstDay, lastDay);
+	int w = std::min((int) ((day - firstDay) / window.days), windows - 1);
+	double x = 2.0 * (day - firstDay - w * window.days) / window.days - 1.0;
+	int n = window.degree + 1;
+	const double * c = coefficients + offsets[body] + (size_t) w * 3 * n;
+
+	// Clenshaw, the three axes together
+	glm::dvec3 b1(0.0), b2(0.0);
+	for (int j=n-1; j>=1; j--) {
+		glm::dvec3 b0 = 2.0 * x * b1 - b2 + glm::dvec3(c[j], c[n + j], c[2 * n + j]);
+		b2 = b1;
+		b1 = b0;
+	}
+	return x * b1 - b2 + glm::dvec3(c[0], c[n], c[2 * n]);
+}
+
+glm::dvec3 Ephemeris :: SunGeocentric(double day) const {
+
+	// The Earth sits off the barycentre, opposite the Moon
+	glm::dvec3 earth = Position(BODY_EARTH_MOON, day) - MoonGeocentric(day) / (1.0 + EARTH_MOON_MASS_RATIO);
+	return -earth;
+}
+
+glm::dvec3 Ephemeris :: SeriesPosition(EphemerisBody body, double day) {
+	return body == BODY_MOON ? moonPosition(day) : planetPosition((int) body, day);
+}
+
+glm::dmat3 Ephemeris :: EarthOrientation(double day) {
+	double d = day - J2000, T = d / 36525.0;
+	return bodyOrientation(-0.641 * T, 90.0 - 0.557 * T, 190.147 + 360.9856235 * d);
+}
+
+glm::dmat3 Ephemeris :: MoonOrientation(double day) {
+	// Mean rotation, without the librations' periodic terms
+	double d = day - J2000, T = d / 36525.0;
+	return bodyOrientation(269.9949 + 0.0031 * T, 66.5392 + 0.0130 * T, 38.3213 + 13.17635815 * d);
+}
+
+double Ephemeris :: DayFromUnixTime(double seconds) {
+	return seconds / 86400.0 + 2440587.5;
+}
+
+std::string Ephemeris :: Date(double day) {
+
+	// Meeus, ch. 7
+	double shifted = day + 0.5;
+	double Z = std::floor(shifted), F = shifted - Z;
+	double A = Z;
+	if (Z >= 2299161.0) {
+		double alpha = std::floor((Z - 1867216.25) / 36524.25);
+		A = Z + 1.0 + alpha - std::floor(alpha / 4.0);
+	}
+	double B = A + 1524.0;
+	double C = std::floor((B - 122.1) / 365.25);
+	double D = std::floor(365.25 * C);
+	double E = std::floor((B - D) / 30.6001);
+	int dayOfMonth = (int) (B - D - std::floor(30.6001 * E));
+	int month = (int) (E < 14.0 ? E - 1.0 : E - 13.0);
+	int year = (int) (month > 2 ? C - 4716.0 : C - 4715.0);
+	int minutes = std::min((int) (F * 1440.0), 1439);
+
+	std::ostringstream outs;
+	outs << std::setfill('0') << std::setw(4) << year << "-" << std::setw(2) << month << "-"
+		<< std::setw(2) << dayOfMonth << " " << std::setw(2) << minutes / 60 << ":" << std::setw(2) << minutes % 60;
+	return outs.str();
+}
@@ -0,0 +1,90 @@
+#ifndef EPHEMERIS_H
+#define EPHEMERIS_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+/**
+* Positions of the Sun, Moon and planets and the orientation of the Earth
+* and Moon for any epoch. Times are Julian days (TT, UTC is close enough
+* here), positions km in the J2000 ecliptic frame.
+*
+* The analytic series are truncated to what the scene can show:
+*   planets  Keplerian elements with linear rates (Standish, JPL), heliocentric,
+*            arcminutes over 1800-2050
+*   Moon     the main terms of ELP-2000/82 (Meeus, ch. 47), geocentric,
+*            about 10" and 20 km
+*   rotation IAU WGCCRE pole and prime meridian models
+*
+* Evaluating the series costs a few hundred sines, so each body is fitted
+* with piecewise Chebyshev polynomials over fixed windows of its span. The
+* coefficients are written to a cache file and memory-mapped on later
+* runs; Position() then costs one window lookup and a Clenshaw recurrence
+* per axis. Outside the span it falls back to the series.
+*/
+
+enum EphemerisBody {
+	BODY_MERCURY,
+	BODY_VENUS,
+	BODY_EARTH_MOON, // barycentre
+	BODY_MARS,
+	BODY_JUPITER,
+	BODY_SATURN,
+	BODY_URANUS,
+	BODY_NEPTUNE,
+	BODY_MOON,       // geocentric, the rest heliocentric
+	BODY_COUNT
+};
+
+class Ephemeris {
+
+public:
+	static const double J2000;         // JD of 2000-01-01 12:00 TT
+	static const double AU;            // km
+	static const double EARTH_MOON_MASS_RATIO;
+
+	/** Methods */
+	// Chebyshev fits over [firstDay, lastDay], loaded from cacheFile when it
+	// holds the same span, otherwise fitted and written there (no cache if empty)
+	Ephemeris(double firstDay, double lastDay, const std::string & cacheFile = "");
+	~Ephemeris();
+
+	glm::dvec3 Position(EphemerisBody body, double day) const;
+	glm::dvec3 SunGeocentric(double day) const;
+	glm::dvec3 MoonGeocentric(double day) const { return Position(BODY_MOON, day); }
+
+	// Body-fixed (z the north pole, x the prime meridian) to J2000 ecliptic
+	static glm::dmat3 EarthOrientation(double day);
+	static glm::dmat3 MoonOrientation(double day);
+
+	// The analytic series, what the fits are made of
+	static glm::dvec3 SeriesPosition(EphemerisBody body, double day);
+
+	static double DayFromUnixTime(double seconds);
+	static std::string Date(double day); // "YYYY-MM-DD hh:mm"
+
+	double FitSeconds() const { return fitSeconds; } // 0 when loaded from cache
+
+private:
+	double firstDay, lastDay;
+	double fitSeconds;
+
+	/** Coefficients, mapped from the cache file or owned */
+	const double * coefficients;
+	size_t offsets[BODY_COUNT]; // first coefficient of each body
+	size_t coefficientCount;
+	std::vector<double> owned;
+	void * mapping;
+	size_t mappingSize;
+
+	/** Methods */
+	void fit();
+	bool mapCache(const std::string & filename);
+	void writeCache(const std::string & filename) const;
+	void layout();
+};
+
+#endif
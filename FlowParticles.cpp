@@ -0,0 +1,146 @@
+#include <FlowParticles.h>
+
+#include <stb_image/stb_image.h>
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+static const float PI = 3.14159265358979323846f;
+
+// Trade winds, westerlies and polar easterlies, with a few meanders
+static void builtInField(std::vector<float> & wind, int width, int height) {
+
+	wind.resize(2 * width * height);
+	for (int row=0; row<height; row++) {
+		float lat = PI * (0.5f - (row + 0.5f) / height);
+		float band = std::abs(lat) * 180.0f / PI;
+		float zonal = band < 30.0f ? -7.0f * std::sin(band * PI / 30.0f)
+			: (band < 60.0f ? 12.0f * std::sin((band - 30.0f) * PI / 30.0f) : -5.0f * std::sin((band - 60.0f) * PI / 30.0f));
+		for (int column=0; column<width; column++) {
+			float lon = 2.0f * PI * ((column + 0.5f) / width - 0.5f);
+			float * w = &wind[2 * (row * width + column)];
+			w[0] = zonal + 4.0f * std::sin(3.0f * lon + 2.0f * lat) * std::cos(lat);
+			w[1] = 5.0f * std::sin(4.0f * lon - 3.0f * lat) * std::cos(lat);
+		}
+	}
+}
+
+FlowParticles :: FlowParticles(int particles) : particles(particles), current(0), steps(0), field(0), quad(0) {
+
+	// Wind, repeating in longitude
+	std::vector<float> wind;
+	builtInField(wind, 360, 180);
+	glGenTextures(1, &field);
+	glBindTexture(GL_TEXTURE_2D, field);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, 360, 180, 0, GL_RG, GL_FLOAT, wind.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// One quad, as a strip, for every instance
+	const float corners[] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+	glGenBuffers(1, &quad);
+	glBindBuffer(GL_ARRAY_BUFFER, quad);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+	glGenBuffers(2, state);
+	glGenVertexArrays(2, updateVao);
+	glGenVertexArrays(2, drawVao);
+	for (int i=0; i<2; i++) {
+		glBindBuffer(GL_ARRAY_BUFFER, state[i]);
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) particles * 4 * sizeof(float), NULL, GL_DYNAMIC_COPY);
+
+		glBindVertexArray(updateVao[i]);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *) 0);
+
+		glBindVertexArray(drawVao[i]);
+		glBindBuffer(GL_ARRAY_BUFFER, quad);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void *) 0);
+		glBindBuffer(GL_ARRAY_BUFFER, state[i]);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *) 0);
+		glVertexAttribDivisor(1, 1);
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	Reset();
+}
+
+FlowParticles :: ~FlowParticles() {
+	glDeleteVertexArrays(2, drawVao);
+	glDeleteVertexArrays(2, updateVao);
+	glDeleteBuffers(2, state);
+	glDeleteBuffers(1, &quad);
+	glDeleteTextures(1, &field);
+}
+
+bool FlowParticles :: LoadField(const std::string & filename, float range) {
+
+	int width, height, components;
+	unsigned char * data = stbi_load(filename.c_str(), &width, &height, &components, 3);
+	if (!data) {
+		std::cerr << "FlowParticles::LoadField: Unable to open " << filename << "\n";
+		return false;
+	}
+	std::vector<float> wind(2 * width * height);
+	for (int i=0; i<width*height; i++) {
+		wind[2 * i] = (data[3 * i] / 127.5f - 1.0f) * range;
+		wind[2 * i + 1] = (data[3 * i + 1] / 127.5f - 1.0f) * range;
+	}
+	stbi_image_free(data);
+
+	glBindTexture(GL_TEXTURE_2D, field);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, width, height, 0, GL_RG, GL_FLOAT, wind.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return true;
+}
+
+void FlowParticles :: Reset() {
+
+	// A negative age respawns the particle part way through a random lifetime,
+	// so they do not all expire together
+	std::vector<float> respawn(4 * particles, -1.0f);
+	glBindBuffer(GL_ARRAY_BUFFER, state[current]);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, respawn.size() * sizeof(float), respawn.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void FlowParticles :: bindField(Shader & shader) const {
+	glActiveTexture(GL_TEXTURE0 + UNIT_FIELD);
+	glBindTexture(GL_TEXTURE_2D, field);
+	glActiveTexture(GL_TEXTURE0);
+	shader.setUniform("uField", (int) UNIT_FIELD);
+}
+
+void FlowParticles :: Update(Shader & shader, float seconds) {
+
+	bindField(shader);
+	shader.setUniform("uStep", seconds);
+	shader.setUniform("uSeed", (int) steps++);
+
+	// Nothing is rasterized, the new state is all that comes out
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(updateVao[current]);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, state[1 - current]);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, particles);
+	glEndTransformFeedback();
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindVertexArray(0);
+	glDisable(GL_RASTERIZER_DISCARD);
+	current = 1 - current;
+}
+
+void FlowParticles :: Draw(Shader & shader) const {
+
+	bindField(shader);
+	glBindVertexArray(drawVao[current]);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, particles);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,71 @@
+#ifndef FLOW_PARTICLES_H
+#define FLOW_PARTICLES_H
+
+#include <string>
+
+#include <glad/glad.h>
+
+#include <ShaderProgram.h>
+
+enum FlowMode {
+	FLOW_OFF,
+	FLOW_WIND,  // streaks carried by the wind field
+	FLOW_AURORA // curtains drifting around the auroral ovals
+};
+
+/**
+* Particles that live entirely on the GPU. Update() advects every particle
+* with one transform feedback pass of shaders/flow_update.vert, from one
+* state buffer into the other, and the two swap; Draw() expands each into
+* a quad by instancing (shaders/flow.vert). A frame costs the CPU a few
+* uniforms and two draw calls whatever the count.
+*
+* Per particle, one vec4: longitude and latitude (rad), age and lifetime
+* (display seconds). Geographic for the wind, geomagnetic for the aurora.
+* A particle older than its lifetime respawns, at random, in the same pass.
+*
+* The wind is an equirectangular RG32F texture, m/s east and north, row 0
+* at the north pole and column 0 at -180 degrees. A built-in field of
+* zonal bands stands in until LoadField() replaces it.
+*/
+
+class FlowParticles {
+
+public:
+	// The wind field, past the fixed units (see TrailRenderer.h)
+	static const GLuint UNIT_FIELD = 17;
+
+	/** Methods */
+	FlowParticles(int particles);
+	~FlowParticles();
+
+	// An image's red and green as wind east and north, 0 to 255 over
+	// -range to range m/s; false, keeping the field, if it cannot be read
+	bool LoadField(const std::string & filename, float range);
+
+	// Every particle respawns on the next Update(), in the mode's region
+	void Reset();
+
+	// Advects by seconds of display time; the caller sets the mode and the
+	// speed-up (see shaders/flow_update.vert)
+	void Update(Shader & shader, float seconds);
+	// Instanced quads from the newest state; the caller sets the transforms
+	void Draw(Shader & shader) const;
+
+	int Size() const { return particles; }
+
+private:
+	void bindField(Shader & shader) const;
+
+	int particles;
+	int current; // state buffer holding the newest state
+	unsigned int steps;
+
+	/** GL Data */
+	GLuint field;
+	GLuint quad;
+	GLuint state[2];
+	GLuint updateVao[2], drawVao[2]; // reading state[i]
+};
+
+#endif
@@ -0,0 +1,48 @@
+#include <GpuTimer.h>
+
+#include <glad/glad.h>
+
+GpuTimer :: GpuTimer()
+	: current(0), average(0.0)
+{
+	glGenQueries(QUERIES, queries);
+	for (int i=0; i<QUERIES; i++)
+		pending[i] = false;
+}
+
+GpuTimer :: ~GpuTimer() {
+	glDeleteQueries(QUERIES, queries);
+}
+
+void GpuTimer :: Begin() {
+	collect();
+	glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+}
+
+void GpuTimer :: End() {
+	glEndQuery(GL_TIME_ELAPSED);
+	pending[current] = true;
+	current = (current + 1) % QUERIES;
+}
+
+void GpuTimer :: collect() {
+
+	// Oldest first; a query still in flight is reused only once it is done
+	for (int i=1; i<=QUERIES; i++) {
+		int index = (current + i) % QUERIES;
+		if (!pending[index])
+			continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available && index != current)
+			continue;
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &elapsed); // blocks only for a full ring
+		pending[index] = false;
+
+		double ms = elapsed * 1e-6;
+		average = average == 0.0 ? ms : average * 0.9 + ms * 0.1;
+	}
+}
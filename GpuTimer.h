@@ -0,0 +1,38 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+/**
+* GPU time of a span of commands, from GL_TIME_ELAPSED queries. Results
+* are read a few frames late from a small ring of queries so the CPU never
+* waits on the GPU, and smoothed into a running average. Only one timer
+* may be between Begin() and End() at a time.
+*/
+
+class GpuTimer {
+
+public:
+	/** Methods */
+	GpuTimer();
+	~GpuTimer();
+
+	void Begin();
+	void End();
+
+	double Milliseconds() const { return average; } // 0 until the first result
+
+private:
+	static const int QUERIES = 4;
+
+	/** Timer Data */
+	GLuint queries[QUERIES];
+	bool pending[QUERIES];
+	int current;
+	double average;
+
+	/** Methods */
+	void collect();
+};
+
+#endif
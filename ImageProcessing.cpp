@@ -0,0 +1,459 @@
+#include <ImageProcessing.h>
+#include <ThreadPool.h>
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IMAGE_SSE2 1
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define IMAGE_NEON 1
+#endif
+
+static ImageKernel imageKernel = IMAGE_KERNEL_SIMD;
+static unsigned int imageThreads = 0;
+static std::unique_ptr<ThreadPool> imagePool;
+static std::mutex imagePoolMutex; // kernels also run on the texture streamer's workers
+
+// Rows handed to one task; small mips are not worth a context switch
+static const int ROW_GRAIN = 16;
+
+void SetImageKernel(ImageKernel kernel) {
+	imageKernel = kernel;
+}
+
+void SetImageThreads(unsigned int threads) {
+	std::lock_guard<std::mutex> lock(imagePoolMutex);
+	imageThreads = threads;
+	imagePool.reset();
+}
+
+const char * ImageKernelName() {
+	if (imageKernel == IMAGE_KERNEL_SCALAR) return "scalar";
+#if defined(__AVX2__)
+	return "AVX2";
+#elif defined(IMAGE_NEON)
+	return "NEON";
+#elif defined(IMAGE_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+static void parallelRows(int rows, const std::function<void(int, int)> & body) {
+	if (imageThreads == 1 || rows <= ROW_GRAIN) {
+		body(0, rows);
+		return;
+	}
+	ThreadPool * pool;
+	{
+		std::lock_guard<std::mutex> lock(imagePoolMutex);
+		if (!imagePool)
+			imagePool.reset(new ThreadPool(imageThreads));
+		pool = imagePool.get();
+	}
+	pool->ParallelFor(0, rows, body, ROW_GRAIN);
+}
+
+/** sRGB tables: 8-bit sRGB -> 16-bit linear, 14-bit linear -> 8-bit sRGB */
+
+static const int SRGB_INDEX_BITS = 14;
+static int32_t toLinear[256];
+static unsigned char toSrgb[1 << SRGB_INDEX_BITS]; // bytes, so the table stays in L1
+
+static void buildSrgbTables() {
+	for (int i=0; i<256; i++) {
+		double c = i / 255.0;
+		c = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+		toLinear[i] = (int32_t) (c * 65535.0 + 0.5);
+	}
+	for (int i=0; i<(1 << SRGB_INDEX_BITS); i++) {
+		double c = (i + 0.5) / (1 << SRGB_INDEX_BITS);
+		c = c <= 0.0031308 ? c * 12.92 : 1.055 * std::pow(c, 1.0 / 2.4) - 0.055;
+		toSrgb[i] = (unsigned char) std::min(255.0, std::max(0.0, c * 255.0 + 0.5));
+	}
+}
+
+static void initSrgbTables() {
+	static std::once_flag once;
+	std::call_once(once, buildSrgbTables);
+}
+
+/*************************************************
+*
+* RGB -> RGBA
+*
+*************************************************/
+
+static void expandScalar(const unsigned char * src, unsigned char * dst, size_t pixels) {
+	for (size_t i=0; i<pixels; i++) {
+		dst[4 * i + 0] = src[3 * i + 0];
+		dst[4 * i + 1] = src[3 * i + 1];
+		dst[4 * i + 2] = src[3 * i + 2];
+		dst[4 * i + 3] = 255;
+	}
+}
+
+static size_t expandSimd(const unsigned char * src, unsigned char * dst, size_t pixels) {
+	size_t i = 0;
+#if defined(__SSSE3__)
+	const __m128i mask = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i alpha = _mm_set1_epi32((int) 0xff000000);
+	for (; i + 16 <= pixels; i += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (src + 3 * i));
+		__m128i b = _mm_loadu_si128((const __m128i *) (src + 3 * i + 16));
+		__m128i c = _mm_loadu_si128((const __m128i *) (src + 3 * i + 32));
+		__m128i * out = (__m128i *) (dst + 4 * i);
+		_mm_storeu_si128(out + 0, _mm_or_si128(_mm_shuffle_epi8(a, mask), alpha));
+		_mm_storeu_si128(out + 1, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), mask), alpha));
+		_mm_storeu_si128(out + 2, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), mask), alpha));
+		_mm_storeu_si128(out + 3, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(c, 4), mask), alpha));
+	}
+#elif defined(IMAGE_NEON)
+	for (; i + 16 <= pixels; i += 16) {
+		uint8x16x3_t rgb = vld3q_u8(src + 3 * i);
+		uint8x16x4_t rgba;
+		rgba.val[0] = rgb.val[0];
+		rgba.val[1] = rgb.val[1];
+		rgba.val[2] = rgb.val[2];
+		rgba.val[3] = vdupq_n_u8(255);
+		vst4q_u8(dst + 4 * i, rgba);
+	}
+#else
+	(void) src; (void) dst; (void) pixels; // plain SSE2 has no byte shuffle
+#endif
+	return i;
+}
+
+void ExpandRGBToRGBA(const unsigned char * src, unsigned char * dst, size_t pixels) {
+	const size_t block = 1 << 16;
+	int blocks = (int) ((pixels + block - 1) / block);
+	parallelRows(blocks, [=] (int first, int last) {
+		for (int b=first; b<last; b++) {
+			size_t begin = b * block;
+			size_t count = std::min(block, pixels - begin);
+			size_t done = imageKernel == IMAGE_KERNEL_SIMD
+				? expandSimd(src + 3 * begin, dst + 4 * begin, count) : 0;
+			expandScalar(src + 3 * (begin + done), dst + 4 * (begin + done), count - done);
+		}
+	});
+}
+
+/*************************************************
+*
+* 2x2 downsampling, one destination row at a time
+*
+*************************************************/
+
+static void downsampleRowScalar(
+	const unsigned char * r0, const unsigned char * r1, int srcWidth,
+	unsigned char * dst, int x0, int dstWidth, int components, bool srgb) {
+
+	int colorChannels = srgb ? std::min(components, 3) : 0;
+	for (int x=x0; x<dstWidth; x++) {
+		int xa = std::min(2 * x, srcWidth - 1) * components;
+		int xb = std::min(2 * x + 1, srcWidth - 1) * components;
+		for (int c=0; c<components; c++) {
+			if (c < colorChannels) {
+				int32_t sum = toLinear[r0[xa + c]] + toLinear[r0[xb + c]]
+					+ toLinear[r1[xa + c]] + toLinear[r1[xb + c]];
+				dst[x * components + c] = toSrgb[((sum + 2) >> 2) >> (16 - SRGB_INDEX_BITS)];
+			} else {
+				int sum = r0[xa + c] + r0[xb + c] + r1[xa + c] + r1[xb + c];
+				dst[x * components + c] = (unsigned char) ((sum + 2) >> 2);
+			}
+		}
+	}
+}
+
+// Returns the number of destination pixels written; the caller finishes the row
+static int downsampleRowSimd(
+	const unsigned char * r0, const unsigned char * r1,
+	unsigned char * dst, int dstWidth, int components, bool srgb) {
+
+	int x = 0;
+
+	// Colour maps: table lookups beat both AVX2 gathers and evaluating the
+	// transfer curves in vector lanes, so RGBA gets an unclamped table loop
+	if (srgb) {
+		if (components != 4) return 0;
+		for (; x<dstWidth; x++) {
+			const unsigned char * a = r0 + 8 * x;
+			const unsigned char * b = r1 + 8 * x;
+			unsigned char * out = dst + 4 * x;
+			for (int c=0; c<3; c++) {
+				int32_t sum = toLinear[a[c]] + toLinear[a[c + 4]] + toLinear[b[c]] + toLinear[b[c + 4]];
+				out[c] = toSrgb[((sum + 2) >> 2) >> (16 - SRGB_INDEX_BITS)];
+			}
+			out[3] = (unsigned char) ((a[3] + a[7] + b[3] + b[7] + 2) >> 2);
+		}
+		return x;
+	}
+
+	if (components == 4) {
+#if defined(__AVX2__)
+		{
+			const __m256i zero = _mm256_setzero_si256();
+			const __m256i two = _mm256_set1_epi16(2);
+			for (; x + 8 <= dstWidth; x += 8) {
+				__m256i half[2];
+				for (int h=0; h<2; h++) {
+					__m256i a = _mm256_loadu_si256((const __m256i *) (r0 + 8 * x + 32 * h));
+					__m256i b = _mm256_loadu_si256((const __m256i *) (r1 + 8 * x + 32 * h));
+					// In-lane unpacks: lo = texels {0,1 | 4,5}, hi = {2,3 | 6,7}
+					__m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+					__m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+					__m256i sum = _mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), _mm256_unpackhi_epi64(lo, hi));
+					half[h] = _mm256_srli_epi16(_mm256_add_epi16(sum, two), 2);
+				}
+				__m256i packed = _mm256_packus_epi16(half[0], half[1]);
+				packed = _mm256_permute4x64_epi64(packed, 0xD8); // 0, 2, 1, 3
+				_mm256_storeu_si256((__m256i *) (dst + 4 * x), packed);
+			}
+		}
+#endif
+#if defined(IMAGE_SSE2)
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i two = _mm_set1_epi16(2);
+		for (; x + 4 <= dstWidth; x += 4) {
+			__m128i d[2];
+			for (int h=0; h<2; h++) {
+				__m128i a = _mm_loadu_si128((const __m128i *) (r0 + 8 * x + 16 * h));
+				__m128i b = _mm_loadu_si128((const __m128i *) (r1 + 8 * x + 16 * h));
+				__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+				__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+				__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+				d[h] = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+			}
+			_mm_storeu_si128((__m128i *) (dst + 4 * x), _mm_packus_epi16(d[0], d[1]));
+		}
+#elif defined(IMAGE_NEON)
+		for (; x + 8 <= dstWidth; x += 8) {
+			uint8x16x4_t a = vld4q_u8(r0 + 8 * x);
+			uint8x16x4_t b = vld4q_u8(r1 + 8 * x);
+			uint8x8x4_t out;
+			for (int c=0; c<4; c++)
+				out.val[c] = vrshrn_n_u16(vaddq_u16(vpaddlq_u8(a.val[c]), vpaddlq_u8(b.val[c])), 2);
+			vst4_u8(dst + 4 * x, out);
+		}
+#endif
+	} else if (components == 1) {
+#if defined(__AVX2__)
+		{
+			const __m256i low = _mm256_set1_epi16(0x00ff);
+			const __m256i two = _mm256_set1_epi16(2);
+			for (; x + 16 <= dstWidth; x += 16) {
+				__m256i a = _mm256_loadu_si256((const __m256i *) (r0 + 2 * x));
+				__m256i b = _mm256_loadu_si256((const __m256i *) (r1 + 2 * x));
+				__m256i sum = _mm256_add_epi16(
+					_mm256_add_epi16(_mm256_and_si256(a, low), _mm256_srli_epi16(a, 8)),
+					_mm256_add_epi16(_mm256_and_si256(b, low), _mm256_srli_epi16(b, 8)));
+				sum = _mm256_srli_epi16(_mm256_add_epi16(sum, two), 2);
+				__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(sum, sum), 0xD8);
+				_mm_storeu_si128((__m128i *) (dst + x), _mm256_castsi256_si128(packed));
+			}
+		}
+#endif
+#if defined(IMAGE_SSE2)
+		const __m128i low = _mm_set1_epi16(0x00ff);
+		const __m128i two = _mm_set1_epi16(2);
+		for (; x + 8 <= dstWidth; x += 8) {
+			__m128i a = _mm_loadu_si128((const __m128i *) (r0 + 2 * x));
+			__m128i b = _mm_loadu_si128((const __m128i *) (r1 + 2 * x));
+			__m128i sum = _mm_add_epi16(
+				_mm_add_epi16(_mm_and_si128(a, low), _mm_srli_epi16(a, 8)),
+				_mm_add_epi16(_mm_and_si128(b, low), _mm_srli_epi16(b, 8)));
+			sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+			_mm_storel_epi64((__m128i *) (dst + x), _mm_packus_epi16(sum, sum));
+		}
+#elif defined(IMAGE_NEON)
+		for (; x + 8 <= dstWidth; x += 8) {
+			uint16x8_t sum = vaddq_u16(vpaddlq_u8(vld1q_u8(r0 + 2 * x)), vpaddlq_u8(vld1q_u8(r1 + 2 * x)));
+			vst1_u8(dst + x, vrshrn_n_u16(sum, 2));
+		}
+#endif
+	}
+
+	return x;
+}
+
+void DownsampleImage(
+	const unsigned char * src, int width, int height, int components,
+	bool srgb, unsigned char * dst) {
+
+	initSrgbTables();
+
+	int dstWidth  = std::max(1, width  / 2);
+	int dstHeight = std::max(1, height / 2);
+	size_t srcPitch = (size_t) width * components;
+	size_t dstPitch = (size_t) dstWidth * components;
+
+	// A single source column needs clamped reads that the vector loops do not do
+	bool simd = imageKernel == IMAGE_KERNEL_SIMD && width > 1;
+
+	parallelRows(dstHeight, [=] (int first, int last) {
+		for (int y=first; y<last; y++) {
+			const unsigned char * r0 = src + std::min(2 * y, height - 1) * srcPitch;
+			const unsigned char * r1 = src + std::min(2 * y + 1, height - 1) * srcPitch;
+			unsigned char * row = dst + y * dstPitch;
+			int done = simd ? downsampleRowSimd(r0, r1, row, dstWidth, components, srgb) : 0;
+			downsampleRowScalar(r0, r1, width, row, done, dstWidth, components, srgb);
+		}
+	});
+}
+
+/*************************************************
+*
+* Normal renormalisation
+*
+*************************************************/
+
+static void renormalizeScalar(unsigned char * data, size_t pixels, int components) {
+	for (size_t i=0; i<pixels; i++) {
+		unsigned char * p = data + i * components;
+		float x = p[0] * (2.0f / 255.0f) - 1.0f;
+		float y = p[1] * (2.0f / 255.0f) - 1.0f;
+		float z = p[2] * (2.0f / 255.0f) - 1.0f;
+		float inv = 1.0f / std::sqrt(std::max(x * x + y * y + z * z, 1e-8f));
+		p[0] = (unsigned char) std::min(255.0f, std::max(0.0f, x * inv * 127.5f + 128.0f));
+		p[1] = (unsigned char) std::min(255.0f, std::max(0.0f, y * inv * 127.5f + 128.0f));
+		p[2] = (unsigned char) std::min(255.0f, std::max(0.0f, z * inv * 127.5f + 128.0f));
+	}
+}
+
+#if defined(__AVX2__)
+static inline void transpose8x4(__m256 & r0, __m256 & r1, __m256 & r2, __m256 & r3) {
+	__m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpacklo_ps(r2, r3);
+	__m256 t2 = _mm256_unpackhi_ps(r0, r1), t3 = _mm256_unpackhi_ps(r2, r3);
+	r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+	r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+	r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+#endif
+
+// Lengths use a true square root so that results match the scalar reference
+static size_t renormalizeSimd(unsigned char * data, size_t pixels) {
+	size_t i = 0;
+#if defined(__AVX2__)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256 scale = _mm256_set1_ps(2.0f / 255.0f), one = _mm256_set1_ps(1.0f);
+		const __m256 half = _mm256_set1_ps(127.5f), bias = _mm256_set1_ps(128.0f);
+		const __m256 eps = _mm256_set1_ps(1e-8f), top = _mm256_set1_ps(255.0f);
+		for (; i + 8 <= pixels; i += 8) {
+			__m256i px = _mm256_loadu_si256((const __m256i *) (data + 4 * i));
+			__m256i lo = _mm256_unpacklo_epi8(px, zero), hi = _mm256_unpackhi_epi8(px, zero);
+			// Texels {0,1,2,3 | 4,5,6,7} in AoS, transposed to one channel per register
+			__m256 r = _mm256_cvtepi32_ps(_mm256_unpacklo_epi16(lo, zero));
+			__m256 g = _mm256_cvtepi32_ps(_mm256_unpackhi_epi16(lo, zero));
+			__m256 b = _mm256_cvtepi32_ps(_mm256_unpacklo_epi16(hi, zero));
+			__m256 a = _mm256_cvtepi32_ps(_mm256_unpackhi_epi16(hi, zero));
+			transpose8x4(r, g, b, a);
+			__m256 x = _mm256_sub_ps(_mm256_mul_ps(r, scale), one);
+			__m256 y = _mm256_sub_ps(_mm256_mul_ps(g, scale), one);
+			__m256 z = _mm256_sub_ps(_mm256_mul_ps(b, scale), one);
+			__m256 len2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+			__m256 inv = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_max_ps(len2, eps)));
+			r = _mm256_min_ps(top, _mm256_max_ps(_mm256_setzero_ps(), _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(x, inv), half), bias)));
+			g = _mm256_min_ps(top, _mm256_max_ps(_mm256_setzero_ps(), _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(y, inv), half), bias)));
+			b = _mm256_min_ps(top, _mm256_max_ps(_mm256_setzero_ps(), _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(z, inv), half), bias)));
+			transpose8x4(r, g, b, a);
+			__m256i p0 = _mm256_packs_epi32(_mm256_cvttps_epi32(r), _mm256_cvttps_epi32(g));
+			__m256i p1 = _mm256_packs_epi32(_mm256_cvttps_epi32(b), _mm256_cvttps_epi32(a));
+			_mm256_storeu_si256((__m256i *) (data + 4 * i), _mm256_packus_epi16(p0, p1));
+		}
+	}
+#endif
+#if defined(IMAGE_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 scale = _mm_set1_ps(2.0f / 255.0f), one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(127.5f), bias = _mm_set1_ps(128.0f);
+	const __m128 eps = _mm_set1_ps(1e-8f), top = _mm_set1_ps(255.0f);
+	for (; i + 4 <= pixels; i += 4) {
+		__m128i px = _mm_loadu_si128((const __m128i *) (data + 4 * i));
+		__m128i lo = _mm_unpacklo_epi8(px, zero), hi = _mm_unpackhi_epi8(px, zero);
+		__m128 r = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+		__m128 g = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+		__m128 b = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+		__m128 a = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+		_MM_TRANSPOSE4_PS(r, g, b, a);
+		__m128 x = _mm_sub_ps(_mm_mul_ps(r, scale), one);
+		__m128 y = _mm_sub_ps(_mm_mul_ps(g, scale), one);
+		__m128 z = _mm_sub_ps(_mm_mul_ps(b, scale), one);
+		__m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+		__m128 inv = _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(len2, eps)));
+		r = _mm_min_ps(top, _mm_max_ps(_mm_setzero_ps(), _mm_add_ps(_mm_mul_ps(_mm_mul_ps(x, inv), half), bias)));
+		g = _mm_min_ps(top, _mm_max_ps(_mm_setzero_ps(), _mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, inv), half), bias)));
+		b = _mm_min_ps(top, _mm_max_ps(_mm_setzero_ps(), _mm_add_ps(_mm_mul_ps(_mm_mul_ps(z, inv), half), bias)));
+		_MM_TRANSPOSE4_PS(r, g, b, a);
+		__m128i p0 = _mm_packs_epi32(_mm_cvttps_epi32(r), _mm_cvttps_epi32(g));
+		__m128i p1 = _mm_packs_epi32(_mm_cvttps_epi32(b), _mm_cvttps_epi32(a));
+		_mm_storeu_si128((__m128i *) (data + 4 * i), _mm_packus_epi16(p0, p1));
+	}
+#elif defined(IMAGE_NEON)
+	const float32x4_t scale = vdupq_n_f32(2.0f / 255.0f), one = vdupq_n_f32(1.0f);
+	const float32x4_t half = vdupq_n_f32(127.5f), bias = vdupq_n_f32(128.0f);
+	const float32x4_t eps = vdupq_n_f32(1e-8f), top = vdupq_n_f32(255.0f), bottom = vdupq_n_f32(0.0f);
+	for (; i + 16 <= pixels; i += 16) {
+		uint8x16x4_t px = vld4q_u8(data + 4 * i);
+		uint16x8_t wide[3][2];
+		for (int c=0; c<3; c++) {
+			wide[c][0] = vmovl_u8(vget_low_u8(px.val[c]));
+			wide[c][1] = vmovl_u8(vget_high_u8(px.val[c]));
+		}
+		uint16x8_t out[3][2];
+		for (int h=0; h<2; h++) {
+			uint32x4_t res[3][2];
+			for (int q=0; q<2; q++) {
+				float32x4_t v[3];
+				for (int c=0; c<3; c++) {
+					uint32x4_t u = q == 0 ? vmovl_u16(vget_low_u16(wide[c][h])) : vmovl_u16(vget_high_u16(wide[c][h]));
+					v[c] = vsubq_f32(vmulq_f32(vcvtq_f32_u32(u), scale), one);
+				}
+				float32x4_t len2 = vaddq_f32(vaddq_f32(vmulq_f32(v[0], v[0]), vmulq_f32(v[1], v[1])), vmulq_f32(v[2], v[2]));
+				float32x4_t inv = vdivq_f32(one, vsqrtq_f32(vmaxq_f32(len2, eps)));
+				for (int c=0; c<3; c++) {
+					float32x4_t e = vaddq_f32(vmulq_f32(vmulq_f32(v[c], inv), half), bias);
+					res[c][q] = vcvtq_u32_f32(vminq_f32(top, vmaxq_f32(bottom, e)));
+				}
+			}
+			for (int c=0; c<3; c++)
+				out[c][h] = vcombine_u16(vmovn_u32(res[c][0]), vmovn_u32(res[c][1]));
+		}
+		for (int c=0; c<3; c++)
+			px.val[c] = vcombine_u8(vmovn_u16(out[c][0]), vmovn_u16(out[c][1]));
+		vst4q_u8(data + 4 * i, px);
+	}
+#endif
+	return i;
+}
+
+void RenormalizeNormals(unsigned char * data, size_t pixels, int components) {
+	const size_t block = 1 << 14;
+	int blocks = (int) ((pixels + block - 1) / block);
+	parallelRows(blocks, [=] (int first, int last) {
+		for (int b=first; b<last; b++) {
+			size_t begin = b * block;
+			size_t count = std::min(block, pixels - begin);
+			size_t done = imageKernel == IMAGE_KERNEL_SIMD && components == 4
+				? renormalizeSimd(data + 4 * begin, count) : 0;
+			renormalizeScalar(data + (begin + done) * components, count - done, components);
+		}
+	});
+}
@@ -0,0 +1,41 @@
+#ifndef IMAGE_PROCESSING_H
+#define IMAGE_PROCESSING_H
+
+#include <cstddef>
+
+/**
+* CPU image kernels used while loading textures. Every kernel has a scalar
+* reference and SIMD versions (SSE2, AVX2 with -mavx2, NEON on ARM) that
+* produce bit-identical results; large images are split across rows on a
+* shared thread pool.
+*/
+
+enum MipFilter {
+	MIP_LINEAR, // data maps, averaged as stored
+	MIP_SRGB,   // colour maps, averaged in linear light (alpha stays linear)
+	MIP_NORMAL  // tangent-space normal maps, renormalised after averaging
+};
+
+enum ImageKernel {
+	IMAGE_KERNEL_SIMD,
+	IMAGE_KERNEL_SCALAR
+};
+
+/** Methods */
+
+void SetImageKernel(ImageKernel kernel);
+void SetImageThreads(unsigned int threads); // 0: hardware threads, 1: no threading
+const char * ImageKernelName();
+
+// RGB -> RGBA with opaque alpha, so rows are 4-byte aligned for upload and filtering
+void ExpandRGBToRGBA(const unsigned char * src, unsigned char * dst, size_t pixels);
+
+// 2x2 box filter into a max(1, w/2) x max(1, h/2) image
+void DownsampleImage(
+	const unsigned char * src, int width, int height, int components,
+	bool srgb, unsigned char * dst);
+
+// Re-unit-length the xyz of 8-bit encoded normals in place
+void RenormalizeNormals(unsigned char * data, size_t pixels, int components);
+
+#endif
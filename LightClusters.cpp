@@ -0,0 +1,335 @@
+#include <LightClusters.h>
+#include <ShaderProgram.h>
+#include <ThreadPool.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CLUSTER_SSE2 1
+#endif
+
+static_assert(LightClusters::GRID_X % 4 == 0, "froxel rows are tested four at a time");
+
+/** ClusterLight */
+
+ClusterLight ClusterLight :: Point(const glm::vec3 & position, const glm::vec3 & color, float range) {
+
+	// 1 + q d^2 reaches 256 * brightest channel at range
+	float brightest = std::max(color.r, std::max(color.g, color.b));
+
+	ClusterLight light;
+	light.position = position;
+	light.color = color;
+	light.constant = 1.0f;
+	light.linear = 0.0f;
+	light.quadratic = std::max(256.0f * brightest - 1.0f, 0.0f) / (range * range);
+	light.direction = glm::vec3(0.0f, 0.0f, -1.0f); // unused, but keeps the cone maths finite
+	light.innerCutOff = -1.0f;
+	light.outerCutOff = -2.0f;
+	return light;
+}
+
+ClusterLight ClusterLight :: Spot(const glm::vec3 & position, const glm::vec3 & direction,
+	const glm::vec3 & color, float range, float innerCutOff, float outerCutOff) {
+
+	ClusterLight light = Point(position, color, range);
+	light.direction = glm::normalize(direction);
+	light.innerCutOff = innerCutOff;
+	light.outerCutOff = outerCutOff;
+	return light;
+}
+
+float ClusterLight :: Range() const {
+
+	// Solve quadratic d^2 + linear d + constant = 256 * brightest channel
+	float brightest = std::max(color.r, std::max(color.g, color.b));
+	float c = constant - 256.0f * brightest;
+	if (c >= 0.0f)
+		return 0.0f;
+	if (quadratic > 0.0f)
+		return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+	if (linear > 0.0f)
+		return -c / linear;
+	return INFINITY;
+}
+
+/** LightClusters */
+
+LightClusters :: LightClusters(unsigned int threads)
+	: fovY(0.0f), aspect(0.0f), nearPlane(0.0f), farPlane(0.0f), pool(threads)
+{
+	std::memset(&stats, 0, sizeof(stats));
+	counts.resize(CLUSTERS);
+	slots.resize((size_t) CLUSTERS * MAX_LIGHTS_PER_CLUSTER);
+	dropped.resize(GRID_Z);
+	grid.resize(2 * CLUSTERS);
+
+	std::memset(buffers, 0, sizeof(buffers));
+	std::memset(textures, 0, sizeof(textures));
+}
+
+LightClusters :: ~LightClusters() {
+	if (buffers[0] == 0)
+		return;
+	glDeleteTextures(3, textures);
+	glDeleteBuffers(3, buffers);
+}
+
+int LightClusters :: slice(float depth) const {
+	int k = (int) std::floor(std::log(depth / nearPlane) * GRID_Z / std::log(farPlane / nearPlane));
+	return std::max(0, std::min(k, GRID_Z - 1));
+}
+
+void LightClusters :: buildGrid() {
+
+	boxMinX.resize(CLUSTERS); boxMaxX.resize(CLUSTERS);
+	boxMinY.resize(CLUSTERS); boxMaxY.resize(CLUSTERS);
+	sliceMinZ.resize(GRID_Z); sliceMaxZ.resize(GRID_Z);
+
+	float tanY = std::tan(fovY * 0.5f);
+	float tanX = tanY * aspect;
+	for (int k=0; k<GRID_Z; k++) {
+		float zn = nearPlane * std::pow(farPlane / nearPlane, (float) k / GRID_Z);
+		float zf = nearPlane * std::pow(farPlane / nearPlane, (float) (k + 1) / GRID_Z);
+		sliceMinZ[k] = -zf;
+		sliceMaxZ[k] = -zn;
+
+		// A froxel widens with depth; its box spans both end caps
+		for (int j=0; j<GRID_Y; j++)
+			for (int i=0; i<GRID_X; i++) {
+				float x0 = -1.0f + 2.0f * i / GRID_X, x1 = -1.0f + 2.0f * (i + 1) / GRID_X;
+				float y0 = -1.0f + 2.0f * j / GRID_Y, y1 = -1.0f + 2.0f * (j + 1) / GRID_Y;
+				int c = (k * GRID_Y + j) * GRID_X + i;
+				boxMinX[c] = std::min(x0 * zn, x0 * zf) * tanX;
+				boxMaxX[c] = std::max(x1 * zn, x1 * zf) * tanX;
+				boxMinY[c] = std::min(y0 * zn, y0 * zf) * tanY;
+				boxMaxY[c] = std::max(y1 * zn, y1 * zf) * tanY;
+			}
+	}
+}
+
+void LightClusters :: bin(const std::vector<ClusterLight> & lights, const glm::mat4 & view) {
+
+	float tanY = std::tan(fovY * 0.5f);
+	float tanX = tanY * aspect;
+
+	bins.clear();
+	lightData.resize(lights.size() * 4);
+	for (size_t l=0; l<lights.size(); l++) {
+		const ClusterLight & light = lights[l];
+		float range = std::min(light.Range(), farPlane);
+
+		lightData[4 * l + 0] = glm::vec4(light.position, range);
+		lightData[4 * l + 1] = glm::vec4(light.color, 0.0f);
+		lightData[4 * l + 2] = glm::vec4(light.constant, light.linear, light.quadratic, light.outerCutOff);
+		lightData[4 * l + 3] = glm::vec4(light.direction, light.innerCutOff);
+
+		glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+		float nearest = -center.z - range, furthest = -center.z + range;
+		if (range <= 0.0f || furthest < nearPlane || nearest > farPlane)
+			continue;
+
+		LightBin b;
+		b.center = center;
+		b.radius = range;
+		b.index = (uint32_t) l;
+		b.z0 = slice(std::max(nearest, nearPlane));
+		b.z1 = slice(std::min(furthest, farPlane));
+		b.x0 = 0; b.x1 = GRID_X - 1;
+		b.y0 = 0; b.y1 = GRID_Y - 1;
+
+		// Screen bounds of the sphere: widest at its nearest depth on the far
+		// side of the axis, at its furthest depth on the near side
+		if (nearest > nearPlane) {
+			float right  = (center.x + range) / ((center.x + range > 0.0f ? nearest : furthest) * tanX);
+			float left   = (center.x - range) / ((center.x - range < 0.0f ? nearest : furthest) * tanX);
+			float top    = (center.y + range) / ((center.y + range > 0.0f ? nearest : furthest) * tanY);
+			float bottom = (center.y - range) / ((center.y - range < 0.0f ? nearest : furthest) * tanY);
+			if (right < -1.0f || left > 1.0f || top < -1.0f || bottom > 1.0f)
+				continue;
+			b.x0 = std::max(0, (int) std::floor((left + 1.0f) * 0.5f * GRID_X));
+			b.x1 = std::min(GRID_X - 1, (int) std::floor((right + 1.0f) * 0.5f * GRID_X));
+			b.y0 = std::max(0, (int) std::floor((bottom + 1.0f) * 0.5f * GRID_Y));
+			b.y1 = std::min(GRID_Y - 1, (int) std::floor((top + 1.0f) * 0.5f * GRID_Y));
+		}
+		bins.push_back(b);
+	}
+}
+
+void LightClusters :: assign(int z0, int z1) {
+
+	for (int k=z0; k<z1; k++) {
+		uint32_t * sliceCounts = &counts[(size_t) k * GRID_X * GRID_Y];
+		std::fill(sliceCounts, sliceCounts + GRID_X * GRID_Y, 0);
+		dropped[k] = 0;
+
+		for (const LightBin & b : bins) {
+			if (k < b.z0 || k > b.z1)
+				continue;
+
+			// Sphere against box: squared distance from the centre, z first
+			float dz = std::max(0.0f, std::max(sliceMinZ[k] - b.center.z, b.center.z - sliceMaxZ[k]));
+			float budget = b.radius * b.radius - dz * dz;
+			if (budget < 0.0f)
+				continue;
+
+			for (int j=b.y0; j<=b.y1; j++) {
+				int row = (k * GRID_Y + j) * GRID_X;
+				int i = b.x0;
+#if defined(CLUSTER_SSE2)
+				const __m128 zero = _mm_setzero_ps();
+				const __m128 cx = _mm_set1_ps(b.center.x), cy = _mm_set1_ps(b.center.y);
+				const __m128 limit = _mm_set1_ps(budget);
+				for (i = b.x0 & ~3; i<=b.x1; i+=4) {
+					__m128 dx = _mm_max_ps(zero, _mm_max_ps(
+						_mm_sub_ps(_mm_loadu_ps(&boxMinX[row + i]), cx), _mm_sub_ps(cx, _mm_loadu_ps(&boxMaxX[row + i]))));
+					__m128 dy = _mm_max_ps(zero, _mm_max_ps(
+						_mm_sub_ps(_mm_loadu_ps(&boxMinY[row + i]), cy), _mm_sub_ps(cy, _mm_loadu_ps(&boxMaxY[row + i]))));
+					__m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+					int hits = _mm_movemask_ps(_mm_cmple_ps(d2, limit));
+					for (int lane=0; lane<4; lane++) {
+						int x = i + lane;
+						if (!((hits >> lane) & 1) || x < b.x0 || x > b.x1)
+							continue;
+						uint32_t & n = counts[row + x];
+						if (n < MAX_LIGHTS_PER_CLUSTER)
+							slots[(size_t) (row + x) * MAX_LIGHTS_PER_CLUSTER + n++] = b.index;
+						else
+							dropped[k]++;
+					}
+				}
+#endif
+				for (; i<=b.x1; i++) {
+					int c = row + i;
+					float dx = std::max(0.0f, std::max(boxMinX[c] - b.center.x, b.center.x - boxMaxX[c]));
+					float dy = std::max(0.0f, std::max(boxMinY[c] - b.center.y, b.center.y - boxMaxY[c]));
+					if (dx * dx + dy * dy > budget)
+						continue;
+					if (counts[c] < MAX_LIGHTS_PER_CLUSTER)
+						slots[(size_t) c * MAX_LIGHTS_PER_CLUSTER + counts[c]++] = b.index;
+					else
+						dropped[k]++;
+				}
+			}
+		}
+	}
+}
+
+void LightClusters :: Build(const std::vector<ClusterLight> & lights, const glm::mat4 & view,
+	float fovY, float aspect, float nearPlane, float farPlane) {
+
+	Assign(lights, view, fovY, aspect, nearPlane, farPlane);
+	upload();
+}
+
+void LightClusters :: Assign(const std::vector<ClusterLight> & lights, const glm::mat4 & view,
+	float fovY, float aspect, float nearPlane, float farPlane) {
+
+	if (fovY != this->fovY || aspect != this->aspect || nearPlane != this->nearPlane || farPlane != this->farPlane) {
+		this->fovY = fovY;
+		this->aspect = aspect;
+		this->nearPlane = nearPlane;
+		this->farPlane = farPlane;
+		buildGrid();
+	}
+
+	bin(lights, view);
+
+	// Slices are independent, so threads never share a froxel
+	pool.ParallelFor(0, GRID_Z, [this] (int z0, int z1) { assign(z0, z1); });
+
+	// Compact the fixed-size slots into one list
+	std::memset(&stats, 0, sizeof(stats));
+	stats.lights = (unsigned int) bins.size();
+	indices.clear();
+	for (int c=0; c<CLUSTERS; c++) {
+		grid[2 * c + 0] = (uint32_t) indices.size();
+		grid[2 * c + 1] = counts[c];
+		const uint32_t * first = &slots[(size_t) c * MAX_LIGHTS_PER_CLUSTER];
+		indices.insert(indices.end(), first, first + counts[c]);
+		stats.maxCluster = std::max(stats.maxCluster, counts[c]);
+	}
+	stats.references = (unsigned int) indices.size();
+	for (int k=0; k<GRID_Z; k++)
+		stats.dropped += dropped[k];
+}
+
+int LightClusters :: Froxel(const glm::vec3 & viewPosition) const {
+
+	float depth = -viewPosition.z;
+	if (depth < nearPlane || depth > farPlane)
+		return -1;
+
+	// Normalised device x and y, then the tile gl_FragCoord falls in
+	float tanY = std::tan(fovY * 0.5f);
+	float x = viewPosition.x / (depth * tanY * aspect);
+	float y = viewPosition.y / (depth * tanY);
+	if (x < -1.0f || x > 1.0f || y < -1.0f || y > 1.0f)
+		return -1;
+	int i = std::min(GRID_X - 1, (int) std::floor((x + 1.0f) * 0.5f * GRID_X));
+	int j = std::min(GRID_Y - 1, (int) std::floor((y + 1.0f) * 0.5f * GRID_Y));
+	return (slice(depth) * GRID_Y + j) * GRID_X + i;
+}
+
+const uint32_t * LightClusters :: FroxelLights(int froxel, uint32_t & count) const {
+	count = grid[2 * froxel + 1];
+	return count > 0 ? &indices[grid[2 * froxel]] : NULL;
+}
+
+void LightClusters :: upload() {
+
+	if (buffers[0] == 0) {
+		glGenBuffers(3, buffers);
+		glGenTextures(3, textures);
+	}
+
+	// Buffer textures cannot be empty
+	if (indices.empty())
+		indices.push_back(0);
+	if (lightData.empty())
+		lightData.resize(4, glm::vec4(0.0f));
+
+	const void * data[3] = {grid.data(), indices.data(), lightData.data()};
+	GLsizeiptr size[3] = {
+		(GLsizeiptr) (grid.size() * sizeof(uint32_t)),
+		(GLsizeiptr) (indices.size() * sizeof(uint32_t)),
+		(GLsizeiptr) (lightData.size() * sizeof(glm::vec4))};
+	GLenum format[3] = {GL_RG32UI, GL_R32UI, GL_RGBA32F};
+
+	for (int b=0; b<3; b++) {
+		// Orphan last frame's storage so the upload never waits on the GPU
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[b]);
+		glBufferData(GL_TEXTURE_BUFFER, size[b], NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, size[b], data[b]);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[b]);
+		glTexBuffer(GL_TEXTURE_BUFFER, format[b], buffers[b]);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters :: Bind(Shader & shader, int viewportWidth, int viewportHeight) {
+
+	const GLuint units[3] = {UNIT_GRID, UNIT_INDICES, UNIT_LIGHTS};
+	for (int b=0; b<3; b++) {
+		glActiveTexture(GL_TEXTURE0 + units[b]);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[b]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+
+	// slice = log(depth) * scale + bias, as slice() above
+	float scale = GRID_Z / std::log(farPlane / nearPlane);
+	shader.setUniform("uClusterGrid", (int) UNIT_GRID);
+	shader.setUniform("uLightIndices", (int) UNIT_INDICES);
+	shader.setUniform("uLightData", (int) UNIT_LIGHTS);
+	shader.setUniform("uClusterDims", glm::ivec3(GRID_X, GRID_Y, GRID_Z));
+	shader.setUniform("uClusterTileSize", (float) viewportWidth / GRID_X, (float) viewportHeight / GRID_Y);
+	shader.setUniform("uClusterDepth", scale, -std::log(nearPlane) * scale);
+}
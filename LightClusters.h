@@ -0,0 +1,116 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <vector>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <ShaderProgram.h>
+#include <ThreadPool.h>
+
+/**
+* Clustered forward lighting. The view frustum is cut into a grid of
+* froxels: screen tiles times exponentially spaced depth slices. Every
+* frame Build() assigns each light to the froxels its range sphere
+* touches, on the CPU: lights are binned to slices and screen tiles
+* first, then tested exactly against froxel boxes four at a time (SSE2),
+* one thread per group of slices. The result is uploaded as three buffer
+* textures and object.frag only walks the lights of its own froxel.
+* Assign() does the CPU half alone and needs no GL context, so the lists
+* can be checked with Froxel() and FroxelLights() (see ClusterBench).
+*
+*   uClusterGrid   RG32UI,  per froxel: first index, light count
+*   uLightIndices  R32UI,   light indices, froxel after froxel
+*   uLightData     RGBA32F, 4 texels per light (see ClusterLight)
+*/
+
+struct ClusterLight {
+	glm::vec3 position;  // world space
+	glm::vec3 color;     // diffuse and specular
+	float constant;      // attenuation, as the Point_Light_t fields
+	float linear;
+	float quadratic;
+	glm::vec3 direction; // spot axis
+	float innerCutOff;   // cosines; a point light has outerCutOff < -1
+	float outerCutOff;
+
+	static ClusterLight Point(const glm::vec3 & position, const glm::vec3 & color, float range);
+	static ClusterLight Spot(const glm::vec3 & position, const glm::vec3 & direction,
+		const glm::vec3 & color, float range, float innerCutOff, float outerCutOff);
+
+	float Range() const; // where attenuation drops below 1/256 of the brightest channel
+};
+
+class LightClusters {
+
+public:
+	static const int GRID_X = 16;
+	static const int GRID_Y = 9;
+	static const int GRID_Z = 24;
+	static const int CLUSTERS = GRID_X * GRID_Y * GRID_Z;
+	static const int MAX_LIGHTS_PER_CLUSTER = 256; // further lights in a froxel are dropped
+
+	// Buffer texture units, clear of materials (1-3), shadows (14) and skybox (15)
+	static const GLuint UNIT_GRID    = 11;
+	static const GLuint UNIT_INDICES = 12;
+	static const GLuint UNIT_LIGHTS  = 13;
+
+	struct Stats {
+		unsigned int lights;     // in range of the frustum
+		unsigned int references; // light-froxel pairs
+		unsigned int maxCluster; // most lights in one froxel
+		unsigned int dropped;    // over MAX_LIGHTS_PER_CLUSTER
+	};
+
+	/** Methods */
+	LightClusters(unsigned int threads = 0); // 0: one worker per hardware thread
+	~LightClusters();
+
+	void Build(const std::vector<ClusterLight> & lights, const glm::mat4 & view,
+		float fovY, float aspect, float nearPlane, float farPlane); // Assign() then upload
+	void Assign(const std::vector<ClusterLight> & lights, const glm::mat4 & view,
+		float fovY, float aspect, float nearPlane, float farPlane);
+	void Bind(Shader & shader, int viewportWidth, int viewportHeight);
+
+	int Froxel(const glm::vec3 & viewPosition) const; // as object.frag finds it, -1 outside the frustum
+	const uint32_t * FroxelLights(int froxel, uint32_t & count) const;
+
+	const Stats & LastStats() const { return stats; }
+
+private:
+	struct LightBin {
+		glm::vec3 center; // view space
+		float radius;
+		uint32_t index;
+		int x0, x1, y0, y1, z0, z1; // inclusive froxel ranges
+	};
+
+	/** Grid Data */
+	float fovY, aspect, nearPlane, farPlane; // froxel boxes below are for these
+	std::vector<float> boxMinX, boxMaxX, boxMinY, boxMaxY; // per froxel, view space
+	std::vector<float> sliceMinZ, sliceMaxZ;                // per slice, view space (negative)
+
+	/** Assignment Data */
+	std::vector<LightBin> bins;
+	std::vector<uint32_t> counts;   // per froxel
+	std::vector<uint32_t> slots;    // MAX_LIGHTS_PER_CLUSTER per froxel
+	std::vector<uint32_t> dropped;  // per slice
+	std::vector<uint32_t> grid;     // offset, count per froxel
+	std::vector<uint32_t> indices;
+	std::vector<glm::vec4> lightData;
+	Stats stats;
+
+	ThreadPool pool;
+	GLuint buffers[3], textures[3]; // created on the first upload
+
+	/** Methods */
+	void buildGrid();
+	int slice(float depth) const;
+	void bin(const std::vector<ClusterLight> & lights, const glm::mat4 & view);
+	void assign(int z0, int z1);
+	void upload();
+};
+
+#endif
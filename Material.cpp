@@ -0,0 +1,60 @@
+#include <Material.h>
+#include <ShaderProgram.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+unsigned int Material :: nextId = 1;
+const Material * Material :: boundMaterial = NULL;
+GLuint Material :: boundProgram = 0;
+GLuint Material :: boundTextures[SLOT_COUNT] = {0};
+
+static const char * samplerNames[SLOT_COUNT] = {
+	"uMaterial.texture_diffuse1",
+	"uMaterial.texture_normal1",
+	"uMaterial.texture_packed1"
+};
+
+Material :: Material(const MaterialTexture textures[SLOT_COUNT], bool translucent)
+	: id(nextId++), translucent(translucent)
+{
+	for (int slot=0; slot<SLOT_COUNT; slot++)
+		this->textures[slot] = textures[slot];
+	layers = glm::vec3(textures[SLOT_DIFFUSE].layer, textures[SLOT_NORMAL].layer, textures[SLOT_PACKED].layer);
+}
+
+void Material :: BindSamplers(Shader & shader) {
+	shader.use();
+	for (int slot=0; slot<SLOT_COUNT; slot++)
+		shader.setUniform(samplerNames[slot], (int) Unit((MaterialSlot) slot));
+}
+
+void Material :: Invalidate() {
+	boundMaterial = NULL;
+	boundProgram = 0;
+	for (int slot=0; slot<SLOT_COUNT; slot++)
+		boundTextures[slot] = 0;
+}
+
+void Material :: Bind(Shader & shader) const {
+
+	if (boundMaterial == this && boundProgram == shader.ID())
+		return;
+
+	// Layers are program state, textures are context state
+	shader.setUniform("uMaterialLayers", layers);
+	boundProgram = shader.ID();
+	if (boundMaterial == this)
+		return;
+
+	for (int slot=0; slot<SLOT_COUNT; slot++) {
+		if (textures[slot].id == 0 || textures[slot].id == boundTextures[slot])
+			continue;
+		glActiveTexture(GL_TEXTURE0 + Unit((MaterialSlot) slot));
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textures[slot].id);
+		boundTextures[slot] = textures[slot].id;
+	}
+	glActiveTexture(GL_TEXTURE0);
+
+	boundMaterial = this;
+}
@@ -0,0 +1,62 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <ShaderProgram.h>
+
+/**
+* Immutable set of textures a mesh samples in object.frag. Every slot has a
+* fixed sampler unit, so sampler uniforms are set once per program
+* (BindSamplers) instead of per draw. Material textures are 2D arrays:
+* meshes whose maps share size and format share an array and only differ
+* by the layer passed in uMaterialLayers. Bind() skips units that already
+* hold the right texture and does nothing at all when the previous draw on
+* the same program used this material.
+*
+* Unit 0 is left to texture uploads, which bind on the active unit.
+*/
+
+enum MaterialSlot {
+	SLOT_DIFFUSE,
+	SLOT_NORMAL,
+	SLOT_PACKED,
+	SLOT_COUNT
+};
+
+struct MaterialTexture {
+	GLuint id; // 2D array, 0 leaves the slot unbound
+	int layer;
+};
+
+class Material {
+
+public:
+	/** Methods */
+	Material(const MaterialTexture textures[SLOT_COUNT], bool translucent = false);
+
+	void Bind(Shader & shader) const;
+	const MaterialTexture & Slot(MaterialSlot slot) const { return textures[slot]; }
+	unsigned int Id() const { return id; } // small, unique per material, for sort keys
+	bool Translucent() const { return translucent; } // blended, drawn after opaque geometry
+
+	static GLuint Unit(MaterialSlot slot) { return 1 + slot; }
+	static void BindSamplers(Shader & shader);
+	static void Invalidate(); // after binding textures on material units elsewhere
+
+private:
+	/** Material Data */
+	MaterialTexture textures[SLOT_COUNT];
+	glm::vec3 layers;
+	unsigned int id;
+	bool translucent;
+
+	static unsigned int nextId;
+
+	static const Material * boundMaterial;
+	static GLuint boundProgram;
+	static GLuint boundTextures[SLOT_COUNT];
+};
+
+#endif
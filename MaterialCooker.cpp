@@ -0,0 +1,141 @@
+#include <MaterialCooker.h>
+#include <TextureContainer.h>
+
+#include <stb_image/stb_image.h>
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+static std::string baseName(const std::string & path) {
+	if (path.empty()) return "none";
+	size_t slash = path.find_last_of('/');
+	return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+std::string PackedMaterialPath(const PackedMaterial & material) {
+
+	std::string directory;
+	for (const std::string * source : {&material.height, &material.specular, &material.emission}) {
+		if (source->empty()) continue;
+		size_t slash = source->find_last_of('/');
+		directory = slash == std::string::npos ? "" : source->substr(0, slash + 1);
+		break;
+	}
+
+	return directory + baseName(material.height) + "+"
+		+ baseName(material.specular) + "+" + baseName(material.emission);
+}
+
+/** Channel sources */
+
+struct ScalarMap {
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> data;
+};
+
+// Rec. 709 luma in 8.8 fixed point; grey images pass through unchanged
+static bool loadScalarMap(const std::string & filename, ScalarMap & map) {
+
+	if (filename.empty())
+		return true;
+
+	int nrComponents;
+	unsigned char * data = stbi_load(filename.c_str(), &map.width, &map.height, &nrComponents, 0);
+	if (!data) {
+		std::cerr << "CookPackedMaterial: Failed to load: " << filename << "\n";
+		return false;
+	}
+
+	size_t pixels = (size_t) map.width * map.height;
+	map.data.resize(pixels);
+	for (size_t i=0; i<pixels; i++) {
+		const unsigned char * p = data + i * nrComponents;
+		map.data[i] = nrComponents < 3 ? p[0]
+			: (unsigned char) ((54 * p[0] + 183 * p[1] + 19 * p[2] + 128) >> 8);
+	}
+
+	stbi_image_free(data);
+	return true;
+}
+
+static unsigned char sampleBilinear(const ScalarMap & map, int x, int y, int width, int height) {
+
+	if (map.data.empty())
+		return 0;
+	if (map.width == width && map.height == height)
+		return map.data[(size_t) y * width + x];
+
+	// Texel centres of the packed image mapped onto the source
+	float u = (x + 0.5f) * map.width / width - 0.5f;
+	float v = (y + 0.5f) * map.height / height - 0.5f;
+	int x0 = std::max(0, std::min((int) std::floor(u), map.width - 1));
+	int y0 = std::max(0, std::min((int) std::floor(v), map.height - 1));
+	int x1 = std::min(x0 + 1, map.width - 1);
+	int y1 = std::min(y0 + 1, map.height - 1);
+	float fx = std::max(0.0f, std::min(u - x0, 1.0f));
+	float fy = std::max(0.0f, std::min(v - y0, 1.0f));
+
+	const unsigned char * d = map.data.data();
+	float top    = d[(size_t) y0 * map.width + x0] * (1.0f - fx) + d[(size_t) y0 * map.width + x1] * fx;
+	float bottom = d[(size_t) y1 * map.width + x0] * (1.0f - fx) + d[(size_t) y1 * map.width + x1] * fx;
+	return (unsigned char) (top * (1.0f - fy) + bottom * fy + 0.5f);
+}
+
+bool CookPackedMaterial(const PackedMaterial & material, TextureContainer & container) {
+
+	ScalarMap maps[3];
+	if (!loadScalarMap(material.height, maps[0])
+		|| !loadScalarMap(material.specular, maps[1])
+		|| !loadScalarMap(material.emission, maps[2]))
+		return false;
+
+	int width = 1, height = 1;
+	for (const ScalarMap & map : maps) {
+		width  = std::max(width, map.width);
+		height = std::max(height, map.height);
+	}
+
+	std::vector<unsigned char> packed((size_t) width * height * 4);
+	for (int y=0; y<height; y++)
+		for (int x=0; x<width; x++) {
+			unsigned char * p = &packed[((size_t) y * width + x) * 4];
+			for (int c=0; c<3; c++)
+				p[c] = sampleBilinear(maps[c], x, y, width, height);
+			p[3] = 255;
+		}
+
+	BuildMipChain(packed.data(), width, height, 4, MIP_LINEAR, container);
+	BuildHeightPyramid(container);
+	return true;
+}
+
+void BuildHeightPyramid(TextureContainer & container) {
+
+	if (container.format != ETX_RGBA8)
+		return;
+
+	for (size_t k=1; k<container.levels.size(); k++) {
+		const TextureLevel & prev = container.levels[k - 1];
+		TextureLevel & level = container.levels[k];
+		int channel = k == 1 ? 0 : 3; // the base level's R, then the reduced A
+
+		for (int y=0; y<level.height; y++) {
+			int y0 = y * prev.height / level.height;
+			int y1 = std::max(y0 + 1, ((y + 1) * prev.height + level.height - 1) / level.height);
+			for (int x=0; x<level.width; x++) {
+				int x0 = x * prev.width / level.width;
+				int x1 = std::max(x0 + 1, ((x + 1) * prev.width + level.width - 1) / level.width);
+
+				unsigned char lowest = 255;
+				for (int py=y0; py<y1; py++)
+					for (int px=x0; px<x1; px++)
+						lowest = std::min(lowest, prev.data[((size_t) py * prev.width + px) * 4 + channel]);
+				level.data[((size_t) y * level.width + x) * 4 + 3] = lowest;
+			}
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef MATERIAL_COOKER_H
+#define MATERIAL_COOKER_H
+
+#include <string>
+
+#include <TextureContainer.h>
+
+/**
+* Material cooking: the scalar maps object.frag reads a single value from
+* are packed into the channels of one linear RGBA texture, so a fragment
+* needs one sampler and one fetch for all of them.
+*
+*   R  height (parallax)
+*   G  specular mask
+*   B  emission intensity
+*   A  opaque on the base level; above it, the smallest R of the base
+*      texels each texel covers (see BuildHeightPyramid)
+*
+* Sources may differ in size; the packed image takes the largest one and
+* the others are resampled bilinearly. A missing source packs as zero.
+*/
+
+struct PackedMaterial {
+	std::string height;
+	std::string specular;
+	std::string emission;
+};
+
+/** Methods */
+
+// Image-like name of the packed texture, next to its first source, e.g.
+// "dir/earth_bump.jpg+earth.jpg+night_lights.jpg"; the cooked file is its ContainerPath
+std::string PackedMaterialPath(const PackedMaterial & material);
+
+bool CookPackedMaterial(const PackedMaterial & material, TextureContainer & container);
+
+// Min-reduce R into A of every mip above the base, the quadtree that
+// QuadtreeParallaxMapping (object.frag) walks. Texel x of a level covers
+// the texels of the level below it overlaps, so odd sizes stay
+// conservative. Uncompressed RGBA containers only; it is cheap and
+// idempotent, so containers baked before the pyramid existed are fixed
+// when they are loaded.
+void BuildHeightPyramid(TextureContainer & container);
+
+#endif
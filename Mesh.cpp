@@ -1,6 +1,7 @@
 #include <Mesh.h>
 #include <ShaderProgram.h>
-#include <Texture.h>
+#include <Material.h>
+#include <Culling.h>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -11,9 +12,10 @@
 Mesh :: Mesh(
 	std::vector<Vertex> vertices,
 	std::vector<GLuint> indices,
-	std::vector<Texture> textures) :
-vertices(vertices), indices(indices), textures(textures) {
+	std::shared_ptr<const Material> material) :
+vertices(vertices), indices(indices), material(material) {
 	
+	bounds = Bounds::FromVertices(this->vertices);
 	setup();
 }
 
@@ -43,54 +45,47 @@ void Mesh :: setup() {
 	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
 
 	glBindVertexArray(0); // Release control of vao
+
+	setupDepth();
+}
+
+void Mesh :: setupDepth() {
+
+	// Depth passes only read positions; 12 instead of 56 bytes per vertex
+	std::vector<glm::vec3> positions(vertices.size());
+	for (size_t i=0; i<vertices.size(); i++)
+		positions[i] = vertices[i].position;
+
+	glGenBuffers(1, &depthVbo);
+	glGenVertexArrays(1, &depthVao);
+
+	glBindVertexArray(depthVao);
+	glBindBuffer(GL_ARRAY_BUFFER, depthVbo);
+	glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+
+	glEnableVertexAttribArray(0); // vertex positions
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), NULL);
+
+	glBindVertexArray(0);
 }
 
 void Mesh :: Draw(Shader & shader) {
 
-	// Bind textures
-	unsigned int diffuseNr  = 1;
-	unsigned int specularNr = 1;
-	unsigned int normalNr   = 1;
-	unsigned int heightNr   = 1;
-	unsigned int emissionNr = 1;
-	unsigned int ambientNr  = 1;
-
-	for (unsigned int i=0; i<textures.size(); i++) {
-
-		glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
-
-		std::string number;
-		TextureType type = textures[i].type;
-
-		if (type == TEX_DIFFUSE)
-			number = std::to_string(diffuseNr++);
-		else if (type == TEX_SPECULAR)
-			number = std::to_string(specularNr++);
-		else if (type == TEX_NORMAL)
-			number = std::to_string(normalNr++);
-		else if (type == TEX_HEIGHT)
-			number = std::to_string(heightNr++);
-		else if (type == TEX_EMISSION)
-			number = std::to_string(emissionNr++);
-		else if (type == TEX_AMBIENT)
-			number = std::to_string(ambientNr++);
-
-		shader.setUniform("uMaterial." + TextureTypeName[type] + number, (int)i);
-		// Bind the texture
-		glBindTexture(GL_TEXTURE_2D, textures[i].id);
-	}
-	glActiveTexture(GL_TEXTURE0);
+	// Bind textures, a no-op when the previous draw used the same material
+	if (material)
+		material->Bind(shader);
 
 	// Draw mesh
 	glBindVertexArray(vao);
 	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
 	glBindVertexArray(0);
-
-	glActiveTexture(GL_TEXTURE0);
 }
 
 void Mesh :: DeleteBuffers() {
 	glDeleteVertexArrays(1, &vao);
+	glDeleteVertexArrays(1, &depthVao);
 	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &depthVbo);
 	glDeleteBuffers(1, &ebo);
 }
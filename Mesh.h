@@ -3,12 +3,14 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 #include <ShaderProgram.h>
-#include <Texture.h>
+#include <Material.h>
+#include <Culling.h>
 
 struct Pixel {
 	glm::vec2 position;
@@ -29,12 +31,13 @@ public:
 	/** Mesh Data */
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
-	std::vector<Texture> textures;
+	std::shared_ptr<const Material> material; // shared by every mesh of the same model material
+	Bounds bounds; // model space, computed once at load
 
 	/** Methods */
 	Mesh(std::vector<Vertex> vertices,
 		std::vector<unsigned int> indices,
-		std::vector<Texture> textures);
+		std::shared_ptr<const Material> material);
 	//~Mesh();
 
 	void Draw(Shader & shader);
@@ -43,13 +46,16 @@ public:
 	GLuint VAO() const { return vao; }
 	GLuint VBO() const { return vbo; }
 	GLuint EBO() const { return ebo; }
+	GLuint DepthVAO() const { return depthVao; } // packed positions at location 0, same indices
 
 private:
 	/** Render Data */
 	GLuint vbo, ebo, vao;
+	GLuint depthVbo, depthVao;
 
 	/** Methods */
 	void setup();
+	void setupDepth();
 };
 
 #endif
\ No newline at end of file
@@ -2,6 +2,10 @@
 #include <Mesh.h>
 #include <ShaderProgram.h>
 #include <Texture.h>
+#include <TextureStreamer.h>
+#include <MaterialCooker.h>
+#include <Material.h>
+#include <RenderQueue.h>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -15,8 +19,8 @@
 #include <vector>
 #include <string>
 
-Model :: Model(std::string path, bool gamma)
-	: gammaCorrection(gamma)
+Model :: Model(std::string path, bool gamma, TextureStreamer * streamer)
+	: bounds(), gammaCorrection(gamma), streamer(streamer)
 {
 	//position = glm::vec3(0.0f, 0.0f, 0.0f);
 	//scale    = glm::vec3(1.0f, 1.0f, 1.0f);
@@ -28,6 +32,7 @@ Model :: Model(std::string path, bool gamma)
 Model :: ~Model() {
 	for (Mesh & mesh : meshes)
 		mesh.DeleteBuffers();
+	Material::Invalidate(); // a later material may reuse this one's address
 }
 
 void Model :: Draw(Shader & shader) {
@@ -37,6 +42,85 @@ void Model :: Draw(Shader & shader) {
 		mesh.Draw(shader);
 }
 
+void Model :: Submit(RenderQueue & queue, unsigned int pass, Shader & shader,
+	const glm::mat4 & model, const glm::mat3 & normal, unsigned int flags, MeshSelection selection) {
+
+	for (Mesh & mesh : meshes) {
+		if (!selected(mesh, selection))
+			continue;
+		DrawPacket packet;
+		packet.shader = &shader;
+		packet.material = mesh.material.get();
+		packet.vao = mesh.VAO();
+		packet.count = (GLsizei) mesh.indices.size();
+		packet.flags = flags;
+		packet.model = model;
+		packet.normal = normal;
+		queue.Submit(pass, packet, mesh.bounds.Transform(model));
+	}
+}
+
+void Model :: SubmitDepth(RenderQueue & queue, unsigned int pass, Shader & shader,
+	const glm::mat4 & model) {
+
+	if (depthProxy) {
+		depthProxy->SubmitDepth(queue, pass, shader, model);
+		return;
+	}
+
+	for (Mesh & mesh : meshes) {
+		DrawPacket packet;
+		packet.shader = &shader;
+		packet.material = NULL;
+		packet.vao = mesh.DepthVAO();
+		packet.count = (GLsizei) mesh.indices.size();
+		packet.flags = 0;
+		packet.model = model;
+		packet.normal = glm::mat3(1.0f); // depth only
+		queue.Submit(pass, packet, mesh.bounds.Transform(model));
+	}
+}
+
+void Model :: SubmitPrepass(RenderQueue & queue, unsigned int pass, Shader & shader,
+	const glm::mat4 & model) {
+
+	// Translucent meshes would hide what is behind them; they keep their own depth test
+	for (Mesh & mesh : meshes) {
+		if (!selected(mesh, MESHES_OPAQUE))
+			continue;
+		DrawPacket packet;
+		packet.shader = &shader;
+		packet.material = NULL;
+		packet.vao = mesh.DepthVAO();
+		packet.count = (GLsizei) mesh.indices.size();
+		packet.flags = 0;
+		packet.model = model;
+		packet.normal = glm::mat3(1.0f); // depth only
+		queue.Submit(pass, packet, mesh.bounds.Transform(model));
+	}
+}
+
+Bounds Model :: SelectionBounds(MeshSelection selection) const {
+
+	Bounds result = Bounds();
+	bool any = false;
+	for (const Mesh & mesh : meshes) {
+		if (!selected(mesh, selection))
+			continue;
+		result = any ? result.Merge(mesh.bounds) : mesh.bounds;
+		any = true;
+	}
+	return result;
+}
+
+bool Model :: selected(const Mesh & mesh, MeshSelection selection) {
+
+	if (selection == MESHES_ALL)
+		return true;
+	bool translucent = mesh.material && mesh.material->Translucent();
+	return translucent == (selection == MESHES_TRANSLUCENT);
+}
+
 void Model :: loadModel(std::string & path) {
 
 	/**
@@ -74,8 +158,15 @@ void Model :: loadModel(std::string & path) {
 
 	std::cout << "Model::loadModel: " << directory << "\n";
 
-	// Process ASSIMP's root node recursively
+	// Resolve every material once, then process ASSIMP's root node recursively
+	loadMaterials(scene);
 	processNode(scene->mRootNode, scene);
+
+	if (!meshes.empty()) {
+		bounds = meshes[0].bounds;
+		for (const Mesh & mesh : meshes)
+			bounds = bounds.Merge(mesh.bounds);
+	}
 }
 
 void Model :: processNode(aiNode * node, const aiScene * scene) {
@@ -103,7 +194,6 @@ Mesh Model :: processMesh(aiMesh * mesh, const aiScene * scene) {
 
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
-	std::vector<Texture> textures;
 
 	// process vertex positions, normals and texture coords
 	for (unsigned int i=0; i<mesh->mNumVertices; i++) {
@@ -177,84 +267,125 @@ Mesh Model :: processMesh(aiMesh * mesh, const aiScene * scene) {
 	}
 
 	// process material
-	if (mesh->mMaterialIndex >= 0) {
-
-		aiMaterial * material = scene->mMaterials[mesh->mMaterialIndex];
-		// Sampler names in shaders convention: "texture_typeNameN"
-
-		// diffuse maps
-		std::vector<Texture> diffuseMaps = loadTextures(material,
-			aiTextureType_DIFFUSE, TEX_DIFFUSE);
-		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-		// specular maps
-		std::vector<Texture> specularMaps = loadTextures(material,
-			aiTextureType_SPECULAR, TEX_SPECULAR);
-		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-		// normal maps
-		std::vector<Texture> normalMaps = loadTextures(material,
-			aiTextureType_NORMALS, TEX_NORMAL); // aiTextureType_NORMALS
-		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-		// height maps
-		std::vector<Texture> heightMaps = loadTextures(material,
-			aiTextureType_HEIGHT, TEX_HEIGHT); // aiTextureType_HEIGHT
-		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-		// emission maps
-		std::vector<Texture> emissionMaps = loadTextures(material,
-			aiTextureType_EMISSIVE, TEX_EMISSION);
-		textures.insert(textures.end(), emissionMaps.begin(), emissionMaps.end());
-		// ambient maps
-		std::vector<Texture> ambientMaps = loadTextures(material,
-			aiTextureType_AMBIENT, TEX_AMBIENT);
-		textures.insert(textures.end(), ambientMaps.begin(), ambientMaps.end());
+	std::shared_ptr<const Material> material;
+	if (mesh->mMaterialIndex < materials.size())
+		material = materials[mesh->mMaterialIndex];
+
+	return Mesh(vertices, indices, material);
+}
+
+std::string Model :: texturePath(aiMaterial * material, aiTextureType aiTexType) {
+
+	if (material->GetTextureCount(aiTexType) == 0)
+		return "";
+
+	aiString str;
+	material->GetTexture(aiTexType, 0, &str);
+	return directory + std::string(str.C_Str());
+}
+
+bool Model :: materialSource(aiMaterial * material, MaterialSlot slot, TextureSource & source) {
+
+	if (slot == SLOT_DIFFUSE) {
+		std::string path = texturePath(material, aiTextureType_DIFFUSE);
+		source = ImageSource(path.empty() ? defaultTextureFilename : path, TEX_DIFFUSE);
+		return true;
 	}
 
-	return Mesh(vertices, indices, textures);
+	if (slot == SLOT_NORMAL) {
+		std::string path = texturePath(material, aiTextureType_NORMALS);
+		source = ImageSource(path, TEX_NORMAL);
+		return !path.empty();
+	}
+
+	// Height, specular and emission maps, cooked into one texture (see MaterialCooker.h)
+	PackedMaterial packed;
+	packed.height   = texturePath(material, aiTextureType_HEIGHT);
+	packed.specular = texturePath(material, aiTextureType_SPECULAR);
+	packed.emission = texturePath(material, aiTextureType_EMISSIVE);
+	if (packed.specular.empty())
+		packed.specular = defaultTextureFilename; // same fallback as the unpacked specular map
+	source = PackedSource(packed);
+	return true;
 }
 
-std::vector<Texture> Model :: loadTextures(
-	aiMaterial * material,
-	aiTextureType aiTexType,
-	TextureType type) {
+void Model :: loadMaterials(const aiScene * scene) {
 
 	/**
-	* Check all material textures of a given type and loads 
+	* For every slot, sources of the same size and stored format become layers
+	* of one 2D array, so meshes of different materials can share bindings.
+	* Sizes come from file headers; nothing is decoded here.
 	*/
 
-	std::vector<Texture> textures;
-	unsigned int typeCount = material->GetTextureCount(aiTexType);
+	struct Group {
+		TextureInfo info;
+		std::vector<TextureSource> layers;
+	};
+
+	unsigned int count = scene->mNumMaterials;
+	std::vector<std::vector<MaterialTexture> > resolved(count, std::vector<MaterialTexture>(SLOT_COUNT));
+	bool compressed = IsContainerFormatSupported(ETX_BC1);
 
-	for (unsigned int i=0; i<typeCount; i++) {
+	for (int slot=0; slot<SLOT_COUNT; slot++) {
 
-		aiString str;
-		material->GetTexture(aiTexType, i, &str);
+		std::vector<Group> groups;
+		std::vector<int> groupOf(count, -1);
 
-		// Check if texture was loaded before. Yes: continue.
-		bool skip = false;
-		for (unsigned int j=0; j<textures_loaded.size(); j++) {
-			if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0) {
-				textures.push_back(textures_loaded[j]);
-				skip == true; break;
+		for (unsigned int m=0; m<count; m++) {
+			resolved[m][slot].id = 0;
+			resolved[m][slot].layer = 0;
+
+			TextureSource source;
+			TextureInfo info;
+			if (!materialSource(scene->mMaterials[m], (MaterialSlot) slot, source))
+				continue;
+			if (!ReadTextureInfo(source, compressed, info)) {
+				std::cerr << "Model::loadMaterials: Unable to read: " << source.filename << "\n";
+				continue;
 			}
+
+			unsigned int g = 0;
+			while (g < groups.size() && !(groups[g].info.width == info.width
+				&& groups[g].info.height == info.height && groups[g].info.format == info.format))
+				g++;
+			if (g == groups.size())
+				groups.push_back(Group{info, {}});
+
+			// Materials often repeat a map, e.g. map_Ka and map_Kd
+			std::vector<TextureSource> & layers = groups[g].layers;
+			unsigned int layer = 0;
+			while (layer < layers.size() && layers[layer].filename != source.filename)
+				layer++;
+			if (layer == layers.size())
+				layers.push_back(source);
+
+			groupOf[m] = (int) g;
+			resolved[m][slot].layer = (int) layer;
 		}
-		if (skip) continue;
 
-		Texture texture;
-		texture.id = LoadTexture(directory + std::string(str.C_Str()), gammaCorrection);
-		texture.type = type;
-		texture.path = str.C_Str();
-		textures.push_back(texture);
-		textures_loaded.push_back(texture); // record to avoid repeated loading
+		// Only colour maps follow the model's gamma setting
+		bool gamma = slot == SLOT_DIFFUSE && gammaCorrection;
+		std::vector<GLuint> ids;
+		for (const Group & group : groups) {
+			GLuint id = streamer ? streamer->RequestArray(group.layers, gamma) : LoadTextureArray(group.layers, gamma);
+			ids.push_back(id);
+			std::cout << "Model::loadMaterials: " << id << "\t" << TextureTypeName[group.layers[0].type]
+				<< "\t" << group.info.width << "x" << group.info.height << "\t" << group.layers.size() << " layers\n";
+		}
 
-		std::cout << "Model::loadTextures: " << texture.id << "\t"
-			<< TextureTypeName[texture.type] << "\tfrom: " << texture.path << "\n";
+		for (unsigned int m=0; m<count; m++)
+			if (groupOf[m] >= 0)
+				resolved[m][slot].id = ids[groupOf[m]];
 	}
 
-	if (typeCount == 0 && (type == TEX_DIFFUSE || type == TEX_SPECULAR)) {
-		Texture texture = DefaultTexture(type);
-		textures.push_back(texture);
+	for (unsigned int m=0; m<count; m++) {
+		// An opacity map or partial opacity makes the material blended
+		aiMaterial * material = scene->mMaterials[m];
+		float opacity = 1.0f;
+		material->Get(AI_MATKEY_OPACITY, opacity);
+		bool translucent = material->GetTextureCount(aiTextureType_OPACITY) > 0 || opacity < 1.0f;
+		materials.push_back(std::make_shared<const Material>(resolved[m].data(), translucent));
 	}
-
-	return textures;
 }
 
 /**
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -14,14 +15,39 @@
 #include <ShaderProgram.h>
 #include <Texture.h>
 #include <Mesh.h>
+#include <Material.h>
+#include <Culling.h>
+
+class TextureStreamer;
+class RenderQueue;
+
+// Which meshes a submission covers, by their material's translucency
+enum MeshSelection {
+	MESHES_ALL,
+	MESHES_OPAQUE,
+	MESHES_TRANSLUCENT // e.g. the Earth's cloud shell
+};
 
 class Model
 {
 public:
 	/** Methods */
-	Model(std::string path, bool gamma = false);
+	Model(std::string path, bool gamma = false, TextureStreamer * streamer = NULL);
 	~Model();
 	void Draw(Shader & shader);
+	void Submit(RenderQueue & queue, unsigned int pass, Shader & shader,
+		const glm::mat4 & model, const glm::mat3 & normal, unsigned int flags = 0,
+		MeshSelection selection = MESHES_ALL); // one packet per mesh, culled per mesh
+	void SubmitDepth(RenderQueue & queue, unsigned int pass, Shader & shader,
+		const glm::mat4 & model); // positions only, no material; uses the depth proxy if set
+	void SubmitPrepass(RenderQueue & queue, unsigned int pass, Shader & shader,
+		const glm::mat4 & model); // opaque meshes only, never the proxy: depth must match Submit exactly
+
+	// Union of the selected meshes' bounds in model space, empty if none match
+	Bounds SelectionBounds(MeshSelection selection) const;
+
+	// Coarser stand-in drawn by SubmitDepth, in this model's space
+	void SetDepthProxy(std::shared_ptr<Model> proxy) { depthProxy = proxy; }
 
 	//void Translate(glm::vec3 trans);
 	//void Translate(float x, float y, float z);
@@ -31,12 +57,15 @@ public:
 
 	/** Model Data */
 	std::vector<Mesh> meshes;
-	std::vector<Texture> textures_loaded; // store loaded textures to avoid loading twice
+	std::vector<std::shared_ptr<const Material> > materials; // one per scene material, shared by its meshes
+	Bounds bounds; // model space, union of the mesh bounds
 
 private:
 	/** Model Data */
 	std::string directory;
 	bool gammaCorrection;
+	TextureStreamer * streamer; // optional, textures are loaded synchronously without it
+	std::shared_ptr<Model> depthProxy;
 
 	/** Geometry params */
 	//glm::vec3 position;
@@ -47,13 +76,13 @@ private:
 	//unsigned int cnt_rotate;
 
 	/** Methods */
+	static bool selected(const Mesh & mesh, MeshSelection selection);
 	void loadModel(std::string & path);
 	void processNode(aiNode * node, const aiScene * scene);
 	Mesh processMesh(aiMesh * mesh, const aiScene * scene);
-	std::vector<Texture> loadTextures(
-		aiMaterial * material,
-		aiTextureType aiTexType, 
-		TextureType type);
+	void loadMaterials(const aiScene * scene);
+	bool materialSource(aiMaterial * material, MaterialSlot slot, TextureSource & source);
+	std::string texturePath(aiMaterial * material, aiTextureType aiTexType);
 };
 
 #endif
\ No newline at end of file
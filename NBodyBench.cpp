@@ -0,0 +1,90 @@
+/**
+* N-body benchmark: steps both scenarios of NBodyField on one thread, then
+* on 2, 4, ... up to every hardware thread, and checks the tree's gravity
+* against direct summation on a sample of particles.
+*
+* Usage:
+*   ./NBodyBench.exe [particles] [steps]
+*
+*   100000 particles and 10 timed steps by default.
+*/
+
+#include <NBodyField.h>
+#include <ThreadPool.h>
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+int main(int argc, char ** argv) {
+
+	int particles = argc > 1 ? std::atoi(argv[1]) : 100000;
+	int steps = argc > 2 ? std::atoi(argv[2]) : 10;
+	if (particles <= 0 || steps <= 0) {
+		std::cerr << "NBodyBench: Usage: NBodyBench.exe [particles] [steps]\n";
+		return 1;
+	}
+
+	unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+	std::cout << "NBodyBench: " << particles << " particles, " << hardware << " hardware threads\n";
+
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads=1; threads<hardware; threads*=2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(hardware);
+
+	bool accurate = true;
+	const NBodyScenario scenarios[] = {NBODY_DEBRIS, NBODY_RING};
+	for (NBodyScenario scenario : scenarios) {
+		std::cout << (scenario == NBODY_DEBRIS ? "  debris" : "  ring") << "\n";
+		NBodyField field;
+		double baseline = 0.0;
+
+		for (unsigned int threads : threadCounts) {
+			// The caller takes part in ParallelFor, so n threads is n - 1 workers
+			std::unique_ptr<ThreadPool> pool;
+			if (threads > 1)
+				pool.reset(new ThreadPool(threads - 1));
+
+			field.Reset(scenario, particles);
+			field.Step(pool.get()); // builds the first tree too
+			auto start = std::chrono::steady_clock::now();
+			for (int s=0; s<steps; s++)
+				field.Step(pool.get());
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			double rate = steps / seconds;
+			if (baseline == 0.0)
+				baseline = rate;
+
+			const NBodyField::Stats & stats = field.LastStats();
+			std::cout << "    " << threads << (threads == 1 ? " thread \t" : " threads\t")
+				<< rate << " steps/s\t" << rate / baseline << "x\t"
+				<< "tree " << stats.treeMs << " ms, force " << stats.forceMs << " ms, "
+				<< stats.interactions << " interactions per particle\n";
+		}
+
+		// Relative error of the tree, on every 1/1000th particle
+		std::vector<double> errors;
+		for (int i=0; i<field.Size(); i+=std::max(1, field.Size() / 1000)) {
+			glm::dvec3 direct = field.DirectGravity(i);
+			if (glm::length(direct) > 0.0)
+				errors.push_back(glm::length(glm::dvec3(field.TreeGravity(i)) - direct) / glm::length(direct));
+		}
+		std::sort(errors.begin(), errors.end());
+		if (!errors.empty()) {
+			double median = errors[errors.size() / 2], tail = errors[errors.size() * 99 / 100];
+			std::cout << "    tree gravity error: median " << median * 100.0 << "%, 99th percentile "
+				<< tail * 100.0 << "%\n";
+			accurate = accurate && tail < 0.05;
+		}
+	}
+
+	if (!accurate)
+		std::cerr << "NBodyBench: Tree gravity is off by more than 5% on some particles\n";
+	return accurate ? 0 : 1;
+}
@@ -0,0 +1,621 @@
+#include <NBodyField.h>
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+const double NBodyField::TIME_UNIT = 806.81; // sqrt(R^3 / GM), WGS-84
+
+static const double EARTH_RADIUS = 6378.137; // km
+static const double J2 = 1.08263e-3;
+static const double ESCAPE_RADIUS = 64.0;    // beyond the Moon
+
+static const int LEAF_SIZE = 16;
+static const int GROUP_SIZE = 128;           // particles sharing a walk
+static const int MORTON_BITS = 21;           // per axis
+static const int BUCKET_BITS = 12;           // the first four levels of the tree
+static const int BUCKETS = 1 << BUCKET_BITS;
+static const int SORT_CHUNKS = 32;
+static const int PARTICLE_GRAIN = 4096;
+static const int GROUP_GRAIN = 4;
+
+static void parallelFor(ThreadPool * pool, int begin, int end,
+	const std::function<void(int, int)> & body, int grain) {
+	if (pool)
+		pool->ParallelFor(begin, end, body, grain);
+	else if (begin < end)
+		body(begin, end);
+}
+
+// 21 bits to every third bit, and back
+static uint64_t spread(uint64_t v) {
+	v &= 0x1fffff;
+	v = (v | v << 32) & 0x1f00000000ffffull;
+	v = (v | v << 16) & 0x1f0000ff0000ffull;
+	v = (v | v << 8) & 0x100f00f00f00f00full;
+	v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+	v = (v | v << 2) & 0x1249249249249249ull;
+	return v;
+}
+
+static uint64_t compact(uint64_t v) {
+	v &= 0x1249249249249249ull;
+	v = (v ^ (v >> 2)) & 0x10c30c30c30c30c3ull;
+	v = (v ^ (v >> 4)) & 0x100f00f00f00f00full;
+	v = (v ^ (v >> 8)) & 0x1f0000ff0000ffull;
+	v = (v ^ (v >> 16)) & 0x1f00000000ffffull;
+	v = (v ^ (v >> 32)) & 0x1fffff;
+	return v;
+}
+
+// Softened gravity of an interaction list (padded to eight) on one point
+static void accumulate(const float * lx, const float * ly, const float * lz, const float * lm, int count,
+	float x, float y, float z, float softening2, float * out) {
+
+	int k = 0;
+	float ax = 0.0f, ay = 0.0f, az = 0.0f;
+#if defined(__AVX2__)
+	__m256 sx = _mm256_setzero_ps(), sy = _mm256_setzero_ps(), sz = _mm256_setzero_ps();
+	__m256 px = _mm256_set1_ps(x), py = _mm256_set1_ps(y), pz = _mm256_set1_ps(z);
+	__m256 eps2 = _mm256_set1_ps(softening2), half = _mm256_set1_ps(0.5f), threeHalves = _mm256_set1_ps(1.5f);
+	for (; k<count; k+=8) {
+		__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(lx + k), px);
+		__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(ly + k), py);
+		__m256 dz = _mm256_sub_ps(_mm256_loadu_ps(lz + k), pz);
+		__m256 r2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+			_mm256_add_ps(_mm256_mul_ps(dz, dz), eps2));
+		// Reciprocal square root, one Newton step to full precision
+		__m256 inverse = _mm256_rsqrt_ps(r2);
+		inverse = _mm256_mul_ps(inverse, _mm256_sub_ps(threeHalves, _mm256_mul_ps(_mm256_mul_ps(half, r2), _mm256_mul_ps(inverse, inverse))));
+		__m256 scale = _mm256_mul_ps(_mm256_loadu_ps(lm + k), _mm256_mul_ps(inverse, _mm256_mul_ps(inverse, inverse)));
+		sx = _mm256_add_ps(sx, _mm256_mul_ps(dx, scale));
+		sy = _mm256_add_ps(sy, _mm256_mul_ps(dy, scale));
+		sz = _mm256_add_ps(sz, _mm256_mul_ps(dz, scale));
+	}
+	float lanes[8];
+	_mm256_storeu_ps(lanes, sx);
+	for (int l=0; l<8; l++) ax += lanes[l];
+	_mm256_storeu_ps(lanes, sy);
+	for (int l=0; l<8; l++) ay += lanes[l];
+	_mm256_storeu_ps(lanes, sz);
+	for (int l=0; l<8; l++) az += lanes[l];
+#endif
+	for (; k<count; k++) {
+		float dx = lx[k] - x, dy = ly[k] - y, dz = lz[k] - z;
+		float inverse = 1.0f / std::sqrt(dx * dx + dy * dy + dz * dz + softening2);
+		float scale = lm[k] * inverse * inverse * inverse;
+		ax += dx * scale;
+		ay += dy * scale;
+		az += dz * scale;
+	}
+	out[0] = ax;
+	out[1] = ay;
+	out[2] = az;
+}
+
+NBodyField :: NBodyField(double theta)
+	: scenario(NBODY_OFF), theta(theta), softening(0.0), step(0.0), time(0.0), primed(false), stats(Stats()),
+	leaves(0), origin(0.0), width(1.0)
+{
+}
+
+void NBodyField :: Reset(NBodyScenario scenario, int count, unsigned int seed) {
+
+	this->scenario = scenario;
+	time = 0.0;
+	primed = false;
+	stats = Stats();
+	if (scenario == NBODY_OFF)
+		count = 0;
+	for (std::vector<double> * a : {&x, &y, &z, &vx, &vy, &vz})
+		a->assign(count, 0.0);
+	for (std::vector<float> * a : {&mass, &px, &py, &pz, &gx, &gy, &gz})
+		a->assign(count, 0.0f);
+	nodes.clear();
+	groups.clear();
+	leaves = 0;
+
+	std::mt19937 random(seed);
+	std::normal_distribution<double> normal;
+	std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+	if (scenario == NBODY_DEBRIS) {
+		// Six tonnes at 800 km, fragments thrown out at 100 m/s from within a kilometre
+		double radius = 1.0 + 800.0 / EARTH_RADIUS;
+		double inclination = glm::radians(98.6);
+		double speed = std::sqrt(1.0 / radius);
+		double kick = 0.1 / (EARTH_RADIUS / TIME_UNIT), spread = 1.0 / EARTH_RADIUS;
+		for (int i=0; i<count; i++) {
+			x[i] = radius + spread * normal(random);
+			y[i] = spread * normal(random);
+			z[i] = spread * normal(random);
+			vx[i] = kick * normal(random);
+			vy[i] = speed * std::cos(inclination) + kick * normal(random);
+			vz[i] = speed * std::sin(inclination) + kick * normal(random);
+			mass[i] = (float) (1e-21 / count);
+		}
+		softening = 0.1 / EARTH_RADIUS;
+		step = 10.0 / TIME_UNIT;
+	} else if (scenario == NBODY_RING) {
+		// A thousandth of the Earth's mass at half its density, turning with its
+		// orbit at two Earth radii, well inside its Roche limit
+		double radius = 2.0, size = 0.15;
+		double speed = std::sqrt(1.0 / radius), spin = speed / radius;
+		for (int i=0; i<count; i++) {
+			double dx, dy, dz;
+			do {
+				dx = uniform(random);
+				dy = uniform(random);
+				dz = uniform(random);
+			} while (dx * dx + dy * dy + dz * dz > 1.0);
+			x[i] = radius + size * dx;
+			y[i] = size * dy;
+			z[i] = size * dz;
+			vx[i] = -spin * size * dy;
+			vy[i] = speed + spin * size * dx;
+			vz[i] = 0.0;
+			mass[i] = (float) (1e-3 / count);
+		}
+		softening = size * std::cbrt(4.0 / count); // about the spacing
+		step = 40.0 / TIME_UNIT;
+	}
+	for (int i=0; i<count; i++) {
+		px[i] = (float) x[i];
+		py[i] = (float) y[i];
+		pz[i] = (float) z[i];
+	}
+}
+
+void NBodyField :: Step(ThreadPool * pool) {
+
+	if (x.empty())
+		return;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (!primed) {
+		sort(pool);
+		build(pool);
+		gravity(pool);
+		primed = true;
+	}
+
+	kick(0.5 * step, pool);
+	drift(step, pool);
+	std::chrono::steady_clock::time_point treeStart = std::chrono::steady_clock::now();
+	sort(pool);
+	build(pool);
+	std::chrono::steady_clock::time_point forceStart = std::chrono::steady_clock::now();
+	gravity(pool);
+	std::chrono::steady_clock::time_point forceEnd = std::chrono::steady_clock::now();
+	kick(0.5 * step, pool);
+	time += step;
+
+	stats.particles = (int) std::count_if(mass.begin(), mass.end(), [] (float m) { return m > 0.0f; });
+	stats.nodes = (int) nodes.size();
+	stats.leaves = leaves;
+	stats.treeMs = std::chrono::duration<double, std::milli>(forceStart - treeStart).count();
+	stats.forceMs = std::chrono::duration<double, std::milli>(forceEnd - forceStart).count();
+	stats.stepMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void NBodyField :: kick(double dt, ThreadPool * pool) {
+
+	parallelFor(pool, 0, Size(), [&] (int first, int last) {
+		for (int i=first; i<last; i++) {
+			if (mass[i] == 0.0f)
+				continue;
+			// The Earth and its oblateness
+			double r2 = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+			double r = std::sqrt(r2);
+			double inverse3 = 1.0 / (r2 * r);
+			double oblate = 1.5 * J2 / r2, z2 = 5.0 * z[i] * z[i] / r2;
+			double equatorial = -inverse3 * (1.0 + oblate * (1.0 - z2));
+			double polar = -inverse3 * (1.0 + oblate * (3.0 - z2));
+			vx[i] += dt * (equatorial * x[i] + gx[i]);
+			vy[i] += dt * (equatorial * y[i] + gy[i]);
+			vz[i] += dt * (polar * z[i] + gz[i]);
+		}
+	}, PARTICLE_GRAIN);
+}
+
+void NBodyField :: drift(double dt, ThreadPool * pool) {
+
+	parallelFor(pool, 0, Size(), [&] (int first, int last) {
+		for (int i=first; i<last; i++) {
+			if (mass[i] == 0.0f)
+				continue;
+			x[i] += dt * vx[i];
+			y[i] += dt * vy[i];
+			z[i] += dt * vz[i];
+			double r2 = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+			if (r2 < 1.0 || r2 > ESCAPE_RADIUS * ESCAPE_RADIUS) {
+				mass[i] = 0.0f;
+				x[i] = y[i] = z[i] = vx[i] = vy[i] = vz[i] = 0.0;
+			}
+			px[i] = (float) x[i];
+			py[i] = (float) y[i];
+			pz[i] = (float) z[i];
+		}
+	}, PARTICLE_GRAIN);
+}
+
+void NBodyField :: sort(ThreadPool * pool) {
+
+	int count = Size();
+
+	// Root cube around the particles still there
+	glm::dvec3 low(1e30), high(-1e30);
+	std::mutex merge;
+	parallelFor(pool, 0, count, [&] (int first, int last) {
+		glm::dvec3 l(1e30), h(-1e30);
+		for (int i=first; i<last; i++) {
+			if (mass[i] == 0.0f)
+				continue;
+			glm::dvec3 p(x[i], y[i], z[i]);
+			l = glm::min(l, p);
+			h = glm::max(h, p);
+		}
+		std::lock_guard<std::mutex> lock(merge);
+		low = glm::min(low, l);
+		high = glm::max(high, h);
+	}, PARTICLE_GRAIN);
+	if (low.x > high.x)
+		low = high = glm::dvec3(0.0);
+	glm::dvec3 extent = high - low;
+	width = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6)) * 1.001;
+	origin = 0.5 * (low + high) - 0.5 * width;
+
+	// Codes, the gone last, together
+	keys.resize(count);
+	double scale = (1 << MORTON_BITS) / width;
+	parallelFor(pool, 0, count, [&] (int first, int last) {
+		const double top = (1 << MORTON_BITS) - 1;
+		for (int i=first; i<last; i++) {
+			keys[i].particle = i;
+			if (mass[i] == 0.0f) {
+				keys[i].code = (1ull << (3 * MORTON_BITS)) - 1;
+				continue;
+			}
+			uint64_t cx = (uint64_t) glm::clamp((x[i] - origin.x) * scale, 0.0, top);
+			uint64_t cy = (uint64_t) glm::clamp((y[i] - origin.y) * scale, 0.0, top);
+			uint64_t cz = (uint64_t) glm::clamp((z[i] - origin.z) * scale, 0.0, top);
+			keys[i].code = spread(cx) << 2 | spread(cy) << 1 | spread(cz);
+		}
+	}, PARTICLE_GRAIN);
+
+	// Buckets by the top bits, counted and scattered per chunk of particles. The
+	// scatter keeps the order of the last step, so the buckets are nearly sorted
+	int chunks = std::max(1, std::min(SORT_CHUNKS, count / PARTICLE_GRAIN));
+	const int shift = 3 * MORTON_BITS - BUCKET_BITS;
+	histogram.assign(chunks * BUCKETS, 0);
+	parallelFor(pool, 0, chunks, [&] (int c0, int c1) {
+		for (int c=c0; c<c1; c++) {
+			int * counts = &histogram[c * BUCKETS];
+			for (int i=(int) ((long long) count * c / chunks); i<(int) ((long long) count * (c + 1) / chunks); i++)
+				counts[keys[i].code >> shift]++;
+		}
+	}, 1);
+	std::vector<int> bucketStart(BUCKETS + 1);
+	int offset = 0;
+	for (int b=0; b<BUCKETS; b++) {
+		bucketStart[b] = offset;
+		for (int c=0; c<chunks; c++) {
+			int n = histogram[c * BUCKETS + b];
+			histogram[c * BUCKETS + b] = offset;
+			offset += n;
+		}
+	}
+	bucketStart[BUCKETS] = offset;
+	sorted.resize(count);
+	parallelFor(pool, 0, chunks, [&] (int c0, int c1) {
+		for (int c=c0; c<c1; c++) {
+			int * next = &histogram[c * BUCKETS];
+			for (int i=(int) ((long long) count * c / chunks); i<(int) ((long long) count * (c + 1) / chunks); i++)
+				sorted[next[keys[i].code >> shift]++] = keys[i];
+		}
+	}, 1);
+	parallelFor(pool, 0, BUCKETS, [&] (int b0, int b1) {
+		for (int b=b0; b<b1; b++)
+			std::sort(sorted.begin() + bucketStart[b], sorted.begin() + bucketStart[b + 1]);
+	}, 64);
+
+	// Particles into that order
+	scratch.resize(count);
+	scratchFloat.resize(count);
+	for (std::vector<double> * a : {&x, &y, &z, &vx, &vy, &vz}) {
+		parallelFor(pool, 0, count, [&] (int first, int last) {
+			for (int i=first; i<last; i++)
+				scratch[i] = (*a)[sorted[i].particle];
+		}, PARTICLE_GRAIN);
+		a->swap(scratch);
+	}
+	for (std::vector<float> * a : {&mass, &px, &py, &pz}) {
+		parallelFor(pool, 0, count, [&] (int first, int last) {
+			for (int i=first; i<last; i++)
+				scratchFloat[i] = (*a)[sorted[i].particle];
+		}, PARTICLE_GRAIN);
+		a->swap(scratchFloat);
+	}
+	keys.swap(sorted);
+}
+
+int NBodyField :: split(int level, int begin, int end, int * bounds) const {
+
+	int shift = 3 * (MORTON_BITS - level - 1);
+	int children = 0;
+	for (int digit=0; digit<8 && begin<end; digit++) {
+		int last = (int) (std::partition_point(keys.begin() + begin, keys.begin() + end, [shift, digit] (const SortKey & key) {
+			return (int) ((key.code >> shift) & 7) <= digit;
+		}) - keys.begin());
+		if (last > begin) {
+			bounds[2 * children] = begin;
+			bounds[2 * children + 1] = last;
+			children++;
+		}
+		begin = last;
+	}
+	return children;
+}
+
+void NBodyField :: buildSubtree(int level, int begin, int end, std::vector<Node> & out) const {
+
+	int index = (int) out.size();
+	out.push_back(Node());
+	double m = 0.0, mx = 0.0, my = 0.0, mz = 0.0;
+	if (end - begin <= LEAF_SIZE || level == MORTON_BITS) {
+		for (int i=begin; i<end; i++) {
+			m += mass[i];
+			mx += mass[i] * x[i];
+			my += mass[i] * y[i];
+			mz += mass[i] * z[i];
+		}
+	} else {
+		int bounds[16];
+		int children = split(level, begin, end, bounds);
+		for (int c=0; c<children; c++)
+			buildSubtree(level + 1, bounds[2 * c], bounds[2 * c + 1], out);
+		for (int c=index+1; c<(int) out.size(); c=out[c].next) {
+			m += out[c].mass;
+			mx += out[c].mass * (double) out[c].x;
+			my += out[c].mass * (double) out[c].y;
+			mz += out[c].mass * (double) out[c].z;
+		}
+	}
+	Node & node = out[index];
+	node.mass = (float) m;
+	if (m > 0.0) {
+		node.x = (float) (mx / m);
+		node.y = (float) (my / m);
+		node.z = (float) (mz / m);
+	}
+	node.first = begin;
+	node.count = end - begin;
+	node.next = (int) out.size();
+	finishNode(node, level);
+}
+
+void NBodyField :: finishNode(Node & node, int level) const {
+
+	// The cell, from the code prefix its particles share
+	uint64_t prefix = keys[node.first].code >> (3 * (MORTON_BITS - level));
+	double cell = width / (1 << level);
+	glm::dvec3 centre = origin + cell * (glm::dvec3(compact(prefix >> 2), compact(prefix >> 1), compact(prefix)) + 0.5);
+	if (node.mass == 0.0f) {
+		node.x = (float) centre.x;
+		node.y = (float) centre.y;
+		node.z = (float) centre.z;
+	}
+	// Width over theta, plus how far the centre of mass is off the cell's centre
+	double open = cell / theta + glm::length(glm::dvec3(node.x, node.y, node.z) - centre);
+	node.open2 = (float) (open * open);
+}
+
+void NBodyField :: build(ThreadPool * pool) {
+
+	int count = Size();
+
+	// The top of the tree, down to ranges small enough to be one task each
+	struct Part {
+		int level, begin, end;
+		int task; // subtree, or -1 for a node of the top
+		int skip; // past its descendants in parts
+	};
+	std::vector<Part> parts;
+	int taskSize = std::max(1024, count / 64), tasks = 0;
+	std::function<void(int, int, int)> plan = [&] (int level, int begin, int end) {
+		if (end - begin <= taskSize || level == MORTON_BITS) {
+			Part part = {level, begin, end, tasks++, (int) parts.size() + 1};
+			parts.push_back(part);
+			return;
+		}
+		int index = (int) parts.size();
+		Part part = {level, begin, end, -1, 0};
+		parts.push_back(part);
+		int bounds[16];
+		int children = split(level, begin, end, bounds);
+		for (int c=0; c<children; c++)
+			plan(level + 1, bounds[2 * c], bounds[2 * c + 1]);
+		parts[index].skip = (int) parts.size();
+	};
+	plan(0, 0, count);
+
+	subtrees.resize(std::max((int) subtrees.size(), tasks));
+	parallelFor(pool, 0, (int) parts.size(), [&] (int first, int last) {
+		for (int p=first; p<last; p++) {
+			if (parts[p].task < 0)
+				continue;
+			std::vector<Node> & subtree = subtrees[parts[p].task];
+			subtree.clear();
+			buildSubtree(parts[p].level, parts[p].begin, parts[p].end, subtree);
+		}
+	}, 1);
+
+	// Subtrees in place, depth first, their skips moved by where they land
+	std::vector<int> offsets(parts.size() + 1);
+	int size = 0;
+	for (size_t p=0; p<parts.size(); p++) {
+		offsets[p] = size;
+		size += parts[p].task < 0 ? 1 : (int) subtrees[parts[p].task].size();
+	}
+	offsets[parts.size()] = size;
+	nodes.resize(size);
+	parallelFor(pool, 0, (int) parts.size(), [&] (int first, int last) {
+		for (int p=first; p<last; p++) {
+			if (parts[p].task < 0)
+				continue;
+			const std::vector<Node> & subtree = subtrees[parts[p].task];
+			int base = offsets[p];
+			for (size_t n=0; n<subtree.size(); n++) {
+				nodes[base + n] = subtree[n];
+				nodes[base + n].next += base;
+			}
+		}
+	}, 1);
+
+	// The top, children before their parents
+	for (int p=(int) parts.size()-1; p>=0; p--) {
+		if (parts[p].task >= 0)
+			continue;
+		int index = offsets[p];
+		Node & node = nodes[index];
+		node.first = parts[p].begin;
+		node.count = parts[p].end - parts[p].begin;
+		node.next = offsets[parts[p].skip];
+		double m = 0.0, mx = 0.0, my = 0.0, mz = 0.0;
+		for (int c=index+1; c<node.next; c=nodes[c].next) {
+			m += nodes[c].mass;
+			mx += nodes[c].mass * (double) nodes[c].x;
+			my += nodes[c].mass * (double) nodes[c].y;
+			mz += nodes[c].mass * (double) nodes[c].z;
+		}
+		node.mass = (float) m;
+		if (m > 0.0) {
+			node.x = (float) (mx / m);
+			node.y = (float) (my / m);
+			node.z = (float) (mz / m);
+		}
+		finishNode(node, parts[p].level);
+	}
+
+	// The largest subtrees within a group's size walk the tree together
+	groups.clear();
+	leaves = 0;
+	for (int n=0; n<size; n++)
+		leaves += nodes[n].next == n + 1;
+	for (int n=0; n<size; ) {
+		if (nodes[n].count <= GROUP_SIZE || nodes[n].next == n + 1) {
+			groups.push_back(n);
+			n = nodes[n].next;
+		} else {
+			n++;
+		}
+	}
+}
+
+void NBodyField :: gravity(ThreadPool * pool) {
+
+	std::atomic<long long> interactions(0);
+	float softening2 = (float) (softening * softening);
+	int nodeCount = (int) nodes.size();
+
+	parallelFor(pool, 0, (int) groups.size(), [&] (int first, int last) {
+		std::vector<float> lx, ly, lz, lm;
+		long long local = 0;
+		for (int g=first; g<last; g++) {
+			const Node & group = nodes[groups[g]];
+			int begin = group.first, end = group.first + group.count;
+
+			// The box of the group's particles still there
+			glm::vec3 low(1e30f), high(-1e30f);
+			for (int i=begin; i<end; i++) {
+				if (mass[i] == 0.0f)
+					continue;
+				glm::vec3 p(px[i], py[i], pz[i]);
+				low = glm::min(low, p);
+				high = glm::max(high, p);
+			}
+			if (low.x > high.x) {
+				std::fill(gx.begin() + begin, gx.begin() + end, 0.0f);
+				std::fill(gy.begin() + begin, gy.begin() + end, 0.0f);
+				std::fill(gz.begin() + begin, gz.begin() + end, 0.0f);
+				continue;
+			}
+			glm::vec3 centre = 0.5f * (low + high), half = 0.5f * (high - low);
+
+			// One walk for all of them
+			lx.clear(); ly.clear(); lz.clear(); lm.clear();
+			for (int n=0; n<nodeCount; ) {
+				const Node & node = nodes[n];
+				glm::vec3 gap = glm::max(glm::abs(glm::vec3(node.x, node.y, node.z) - centre) - half, glm::vec3(0.0f));
+				if (glm::dot(gap, gap) > node.open2) {
+					lx.push_back(node.x);
+					ly.push_back(node.y);
+					lz.push_back(node.z);
+					lm.push_back(node.mass);
+					n = node.next;
+				} else if (node.next == n + 1) {
+					lx.insert(lx.end(), px.begin() + node.first, px.begin() + node.first + node.count);
+					ly.insert(ly.end(), py.begin() + node.first, py.begin() + node.first + node.count);
+					lz.insert(lz.end(), pz.begin() + node.first, pz.begin() + node.first + node.count);
+					lm.insert(lm.end(), mass.begin() + node.first, mass.begin() + node.first + node.count);
+					n = node.next;
+				} else {
+					n++;
+				}
+			}
+			int listSize = (int) lx.size();
+			while (lx.size() % 8) { // massless padding
+				lx.push_back(0.0f);
+				ly.push_back(0.0f);
+				lz.push_back(0.0f);
+				lm.push_back(0.0f);
+			}
+			local += (long long) listSize * group.count;
+
+			for (int i=begin; i<end; i++) {
+				float a[3];
+				accumulate(lx.data(), ly.data(), lz.data(), lm.data(), (int) lx.size(), px[i], py[i], pz[i], softening2, a);
+				gx[i] = a[0];
+				gy[i] = a[1];
+				gz[i] = a[2];
+			}
+		}
+		interactions += local;
+	}, GROUP_GRAIN);
+
+	stats.interactions = Size() > 0 ? (double) interactions / Size() : 0.0;
+}
+
+void NBodyField :: Positions(float * out) const {
+
+	for (int i=0; i<Size(); i++) {
+		out[4 * i] = (float) x[i];
+		out[4 * i + 1] = (float) y[i];
+		out[4 * i + 2] = (float) z[i];
+		out[4 * i + 3] = mass[i] > 0.0f ? 1.0f : 0.0f;
+	}
+}
+
+glm::vec3 NBodyField :: TreeGravity(int i) const {
+	return glm::vec3(gx[i], gy[i], gz[i]);
+}
+
+glm::dvec3 NBodyField :: DirectGravity(int i) const {
+
+	glm::dvec3 a(0.0);
+	double softening2 = softening * softening;
+	for (int j=0; j<Size(); j++) {
+		glm::dvec3 d(x[j] - x[i], y[j] - y[i], z[j] - z[i]);
+		double r2 = glm::dot(d, d) + softening2;
+		a += d * (mass[j] / (r2 * std::sqrt(r2)));
+	}
+	return a;
+}
@@ -0,0 +1,127 @@
+#ifndef NBODY_FIELD_H
+#define NBODY_FIELD_H
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include <ThreadPool.h>
+
+/**
+* Particles around the Earth under its gravity (with J2) and their own,
+* the latter by a Barnes-Hut octree. Units are the Earth's: radius 1,
+* mass 1 and G = 1, so a time unit is 806.8 s and a speed unit 7.905 km/s.
+* Axes are equatorial and inertial, as TEME.
+*
+* Particles are kept one array per coordinate and integrated with
+* kick-drift-kick leapfrog. Every step:
+*
+*   1. particles are sorted by the Morton code of their position (parallel
+*      bucket pass on the top bits, then the buckets in parallel), so the
+*      arrays, the tree and the walks below are all in space order
+*   2. the octree is built over the sorted codes: the top is split into
+*      subtrees that are built in parallel, depth first, with a skip index
+*      per node so it can be walked without a stack
+*   3. every subtree of up to 128 particles walks the tree once for all of
+*      them, collecting an interaction list, which its particles then sum
+*      (eight at a time with AVX2). A node is accepted when the group's box
+*      is further from its centre of mass than width / theta plus the
+*      centre's offset from the cell's
+*
+* Particles that strike the Earth or leave for good become massless at the
+* centre and are no longer drawn.
+*/
+
+enum NBodyScenario {
+	NBODY_OFF,
+	NBODY_DEBRIS, // a satellite broken up in a sun-synchronous orbit
+	NBODY_RING    // a rubble moonlet inside the Roche limit, sheared into a ring
+};
+
+class NBodyField {
+
+public:
+	struct Stats {
+		int particles;  // alive
+		int nodes, leaves;
+		double interactions; // per particle
+		double treeMs;  // sort and build
+		double forceMs;
+		double stepMs;
+	};
+
+	static const double TIME_UNIT; // seconds
+
+	/** Methods */
+	NBodyField(double theta = 0.6);
+
+	// Replaces every particle, count of them, with a scenario
+	void Reset(NBodyScenario scenario, int count, unsigned int seed = 1);
+	NBodyScenario Scenario() const { return scenario; }
+	int Size() const { return (int) x.size(); }
+	double Time() const { return time; } // since Reset(), in time units
+
+	// One leapfrog step of the scenario's length
+	void Step(ThreadPool * pool = NULL);
+
+	// Four floats per particle: position in Earth radii, w 1 or 0 once gone
+	void Positions(float * out) const;
+
+	// Accelerations from the other particles, by the last tree and by direct
+	// summation over all of them, to check the first
+	glm::vec3 TreeGravity(int i) const;
+	glm::dvec3 DirectGravity(int i) const;
+
+	const Stats & LastStats() const { return stats; }
+
+private:
+	struct Node {
+		float x, y, z, mass; // centre of mass
+		float open2;         // accepted beyond the square of this distance
+		int first, count;    // particles
+		int next;            // past the subtree; the first child is the next node
+	};
+
+	struct SortKey {
+		uint64_t code;
+		int particle;
+		bool operator<(const SortKey & other) const { return code < other.code; }
+	};
+
+	NBodyScenario scenario;
+	double theta, softening, step, time;
+	bool primed; // accelerations match positions
+	Stats stats;
+
+	/** Particle Data, in Morton order after each step */
+	std::vector<double> x, y, z, vx, vy, vz;
+	std::vector<float> mass;                    // 0 once gone
+	std::vector<float> px, py, pz;              // positions for the tree walk
+	std::vector<float> gx, gy, gz;              // accelerations from the tree
+
+	/** Tree Data */
+	std::vector<SortKey> keys, sorted;
+	std::vector<int> histogram;
+	std::vector<double> scratch;
+	std::vector<float> scratchFloat;
+	std::vector<Node> nodes;
+	std::vector<std::vector<Node> > subtrees;
+	std::vector<int> groups; // nodes walking the tree together
+	int leaves;
+	glm::dvec3 origin; // of the root cube
+	double width;
+
+	/** Methods */
+	void kick(double dt, ThreadPool * pool);
+	void drift(double dt, ThreadPool * pool);
+	void sort(ThreadPool * pool);
+	void build(ThreadPool * pool);
+	// Bounds of the non-empty children of a node's particles, returns how many
+	int split(int level, int begin, int end, int * bounds) const;
+	void buildSubtree(int level, int begin, int end, std::vector<Node> & out) const;
+	void finishNode(Node & node, int level) const;
+	void gravity(ThreadPool * pool);
+};
+
+#endif
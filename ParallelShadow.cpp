@@ -1,13 +1,44 @@
 #include <ParallelShadow.h>
+#include <ShaderProgram.h>
+#include <Culling.h>
 
-ParallelShadow :: ParallelShadow(int width, int height)
-	: width(width), height(height), active_texture_unit(14)
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+ParallelShadow :: ParallelShadow(int tileSize, int tileCount, ShadowDepthFormat format)
+	: active_texture_unit(14), tileSize(tileSize), format(format),
+	fitted(0), threshold(0.5f), interval(0)
 {
+	cacheStats.tests = 0;
+	cacheStats.hits = 0;
+
+	tileCount = std::max(1, std::min(tileCount, MAX_SHADOW_TILES));
+	int columns = std::min(tileCount, 2);
+	int rows = (tileCount + 1) / 2;
+	width = columns * tileSize;
+	height = rows * tileSize;
+
+	tiles.resize(tileCount);
+	for (int i=0; i<tileCount; i++) {
+		tiles[i].lightSpace = glm::mat4(1.0f);
+		tiles[i].x = (i % columns) * tileSize;
+		tiles[i].y = (i / columns) * tileSize;
+		tiles[i].texelDepth = 0.0f;
+	}
+	cache.resize(tileCount);
+	Invalidate();
+
 	setup();
 }
 
 ParallelShadow :: ~ParallelShadow() {
 	glDeleteFramebuffers(1, &fbo);
+	glDeleteTextures(1, &tid);
 }
 
 void ParallelShadow :: Bind() {
@@ -15,15 +46,157 @@ void ParallelShadow :: Bind() {
 }
 
 void ParallelShadow :: Unbind() {
+	glDisable(GL_SCISSOR_TEST);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+void ParallelShadow :: BindTile(int tile) {
+	const ShadowTile & t = tiles[tile];
+	glViewport(t.x, t.y, tileSize, tileSize);
+	glScissor(t.x, t.y, tileSize, tileSize); // so a tile can be cleared alone
+	glEnable(GL_SCISSOR_TEST);
+}
+
+void ParallelShadow :: Fit(const glm::vec3 & lightDirection,
+	const std::vector<Bounds> & casters, const std::vector<Bounds> & receivers) {
+
+	glm::vec3 direction = glm::normalize(lightDirection);
+	glm::vec3 up = std::fabs(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), direction, up); // rotation only, looks down -z
+
+	fitted = std::min((int) casters.size(), (int) tiles.size());
+	for (int i=0; i<fitted; i++) {
+		glm::vec3 centre = glm::vec3(lightView * glm::vec4(casters[i].center, 1.0f));
+
+		// Sphere-sized tiles keep their size as the caster turns; keep 2 texels
+		// clear on every side for the 3x3 filter
+		float radius = casters[i].radius * tileSize / (tileSize - 4.0f);
+		float texel = 2.0f * radius / tileSize;
+		float x = std::floor(centre.x / texel + 0.5f) * texel;
+		float y = std::floor(centre.y / texel + 0.5f) * texel;
+
+		// From the caster's front to the furthest receiver its shadow can reach
+		float nearDepth = -centre.z - casters[i].radius;
+		float farDepth = -centre.z + casters[i].radius;
+		for (const Bounds & receiver : receivers) {
+			glm::vec3 r = glm::vec3(lightView * glm::vec4(receiver.center, 1.0f));
+			if (std::fabs(r.x - x) < radius + receiver.radius && std::fabs(r.y - y) < radius + receiver.radius)
+				farDepth = std::max(farDepth, -r.z + receiver.radius);
+		}
+		// Snap the near plane and the depth span, not both ends, so the span
+		// (and the cached tile, see NeedsUpdate) holds while the caster drifts
+		float step = 0.25f * radius;
+		float span = std::ceil((farDepth - nearDepth) / step) * step + 3.0f * step;
+		nearDepth = std::floor(nearDepth / step) * step - step;
+		farDepth = nearDepth + span;
+
+		glm::mat4 projection = glm::ortho(x - radius, x + radius, y - radius, y + radius, nearDepth, farDepth);
+		tiles[i].lightSpace = projection * lightView;
+		tiles[i].texelDepth = texel / (farDepth - nearDepth);
+	}
+}
+
+void ParallelShadow :: SetUniforms(Shader & shader) const {
+
+	shader.setUniform("uShadowMap", (int) active_texture_unit);
+	shader.setUniform("uShadowTileCount", fitted);
+	for (int i=0; i<fitted; i++) {
+		std::string index = "[" + std::to_string(i) + "]";
+		shader.setUniform("uShadowMatrices" + index, tiles[i].lightSpace);
+		shader.setUniform("uShadowTiles" + index, glm::vec4(
+			(float) tiles[i].x / width, (float) tiles[i].y / height,
+			(float) tileSize / width, (float) tileSize / height));
+		shader.setUniform("uShadowTexelDepth" + index, tiles[i].texelDepth);
+	}
+}
+
+void SetSphereOccluders(Shader & shader, const std::vector<Bounds> & occluders, float sunAngularRadius) {
+
+	int count = std::min((int) occluders.size(), MAX_SHADOW_OCCLUDERS);
+	shader.setUniform("uOccluderCount", count);
+	shader.setUniform("uSunAngularRadius", sunAngularRadius);
+	for (int i=0; i<count; i++)
+		shader.setUniform("uOccluders[" + std::to_string(i) + "]",
+			glm::vec4(occluders[i].center, occluders[i].radius));
+}
+
+void ParallelShadow :: SetCaching(float threshold, unsigned int interval) {
+	this->threshold = threshold;
+	this->interval = interval;
+}
+
+void ParallelShadow :: Invalidate() {
+	for (CacheEntry & entry : cache) {
+		entry.age = 0;
+		entry.valid = false;
+	}
+}
+
+bool ParallelShadow :: NeedsUpdate(int tile, const ShadowCaster & caster) {
+
+	CacheEntry & entry = cache[tile];
+	glm::mat4 current = tiles[tile].lightSpace * caster.model;
+	bool update = !entry.valid || (interval > 0 && entry.age + 1 >= interval);
+	float texels = tileSize * 0.5f; // NDC to texels
+
+	// The bounding sphere in the tile: centre in NDC, half size along each tile axis in texels
+	glm::vec3 centre = glm::vec3(current * glm::vec4(caster.bounds.center, 1.0f));
+	glm::vec3 extent;
+	for (int r=0; r<3; r++)
+		extent[r] = caster.bounds.radius * glm::length(glm::vec3(current[0][r], current[1][r], current[2][r])) * texels;
+
+	if (!update && caster.sphere) {
+		// Spinning about its centre, a sphere draws the same image wherever the
+		// tile sits around it: only a change of size (radius, depth range) counts,
+		// and the tile moves back so the centre lands where the image has it
+		glm::vec3 grown = glm::abs(extent - entry.extent);
+		update = std::max(grown.x, std::max(grown.y, grown.z)) > threshold;
+		if (!update)
+			tiles[tile].lightSpace = glm::translate(glm::mat4(1.0f), entry.centre - centre) * tiles[tile].lightSpace;
+	} else if (!update) {
+		// A point c + v, |v| <= r, moves by at most |dC c| + r ||dC||, C = lightSpace * model
+		glm::mat4 delta = current - entry.cached;
+		glm::vec3 moved = glm::vec3(delta * glm::vec4(caster.bounds.center, 1.0f)) * texels;
+		float norm = 0.0f; // Frobenius, bounds the spectral norm
+		for (int c=0; c<3; c++) {
+			glm::vec3 column = glm::vec3(delta[c]) * texels;
+			norm += glm::dot(column, column);
+		}
+		update = glm::length(moved) + caster.bounds.radius * std::sqrt(norm) > threshold;
+	}
+
+	cacheStats.tests++;
+	if (!update) {
+		cacheStats.hits++;
+		entry.age++;
+		return false;
+	}
+
+	entry.cached = current;
+	entry.centre = centre;
+	entry.extent = extent;
+	entry.age = 0;
+	entry.valid = true;
+	return true;
+}
+
 void ParallelShadow :: setup() {
+
+	GLint internalFormat = GL_DEPTH_COMPONENT24;
+	GLenum type = GL_UNSIGNED_INT;
+	if (format == SHADOW_DEPTH16) {
+		internalFormat = GL_DEPTH_COMPONENT16;
+		type = GL_UNSIGNED_SHORT;
+	} else if (format == SHADOW_DEPTH32F) {
+		internalFormat = GL_DEPTH_COMPONENT32F;
+		type = GL_FLOAT;
+	}
+
 	// create depth texture
 	glGenTextures(1, &tid);
 	glBindTexture(GL_TEXTURE_2D, tid);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height,
-		0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height,
+		0, GL_DEPTH_COMPONENT, type, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
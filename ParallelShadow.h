@@ -2,7 +2,64 @@
 #define PARALLEL_SHADOW_H
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 #include <Texture.h>
+#include <ShaderProgram.h>
+#include <Culling.h>
+
+#include <vector>
+
+/**
+* Directional light shadows as an atlas of per-caster tiles. Every frame
+* Fit() gives caster i its own orthographic tile, sized to its bounding
+* sphere and deep enough to reach the receivers behind it, so texels are
+* spent on the caster instead of the empty space between bodies. Tile
+* centres snap to whole texels in light space and depth ranges to coarse
+* steps, so a moving caster does not make its shadow shimmer.
+*
+* Each tile only needs its own caster drawn into it: receivers test every
+* tile and take the darkest result (object.frag, MAX_SHADOW_TILES).
+*/
+
+enum ShadowDepthFormat {
+	SHADOW_DEPTH16,
+	SHADOW_DEPTH24,
+	SHADOW_DEPTH32F
+};
+
+static const int MAX_SHADOW_TILES = 4;
+static const int MAX_SHADOW_OCCLUDERS = 8;
+
+/**
+* How object.frag shadows the directional light. Bodies in this scene are
+* spheres, so eclipses can also be computed exactly from occluder centres
+* and radii: no shadow pass, and a penumbra from the sun's angular radius
+* instead of a 3x3 filter.
+*/
+enum ShadowMode {
+	SHADOW_MODE_MAP,    // this atlas
+	SHADOW_MODE_SPHERES // analytic, see SetSphereOccluders
+};
+
+// World-space bounding spheres, at most MAX_SHADOW_OCCLUDERS are used
+void SetSphereOccluders(Shader & shader, const std::vector<Bounds> & occluders, float sunAngularRadius);
+
+/**
+* A caster as the shadow cache sees it: its transform and model-space
+* bounds, and whether it is a sphere turning about bounds.center, whose
+* shadow only changes when that sphere moves in the tile.
+*/
+struct ShadowCaster {
+	glm::mat4 model;
+	Bounds bounds;
+	bool sphere;
+};
+
+struct ShadowTile {
+	glm::mat4 lightSpace; // world to tile NDC
+	int x, y;             // atlas texel origin
+	float texelDepth;     // one texel in world units, as [0, 1] depth
+};
 
 class ParallelShadow {
 
@@ -10,24 +67,73 @@ public:
 
 	const unsigned int active_texture_unit;
 
-	int width;
+	int width;    // atlas
 	int height;
+	int tileSize;
 
-	ParallelShadow(int width = 1024, int height = 1024);
+	ParallelShadow(int tileSize = 1024, int tileCount = 2, ShadowDepthFormat format = SHADOW_DEPTH24);
 	~ParallelShadow();
 
 	void Bind();
 	void Unbind();
 
+	// World-space bounds; caster i gets tile i, extra casters are ignored
+	void Fit(const glm::vec3 & lightDirection,
+		const std::vector<Bounds> & casters, const std::vector<Bounds> & receivers);
+	void BindTile(int tile); // viewport and scissor on the tile, after Bind()
+	void SetUniforms(Shader & shader) const;
+
+	int Tiles() const { return fitted; }
+	int MaxTiles() const { return (int) tiles.size(); }
+	const ShadowTile & Tile(int tile) const { return tiles[tile]; }
+
+	/**
+	* Shadow map caching, per tile. A tile is kept while no point of its
+	* caster's bounds moves more than threshold texels in its light space
+	* since the last render, whether the caster, the light or the fit moved;
+	* interval forces a re-render every that many frames regardless (0: never).
+	* A sphere caster is kept while its size in the tile holds, and the tile
+	* is shifted back over the cached image, so call NeedsUpdate() after
+	* Fit() and before SetUniforms().
+	*/
+	void SetCaching(float threshold, unsigned int interval);
+	bool NeedsUpdate(int tile, const ShadowCaster & caster);
+	void Invalidate();
+
+	// NeedsUpdate() calls and tiles kept, since construction
+	struct CacheStats {
+		unsigned long long tests;
+		unsigned long long hits;
+	};
+	const CacheStats & CacheTotals() const { return cacheStats; }
+
 	unsigned int FBO() { return fbo; }
 	unsigned int TID() { return tid; }
-	
+
 private:
 
 	unsigned int fbo;
 	unsigned int tid;
+	ShadowDepthFormat format;
+
+	/** Atlas Data */
+	std::vector<ShadowTile> tiles;
+	int fitted;
+
+	/** Cache Data, per tile as of its last render */
+	struct CacheEntry {
+		glm::mat4 cached; // lightSpace * model
+		glm::vec3 centre; // bounds.center in tile NDC
+		glm::vec3 extent; // bounding sphere half size per tile axis, texels
+		unsigned int age;
+		bool valid;
+	};
+	std::vector<CacheEntry> cache;
+	float threshold;
+	unsigned int interval;
+	CacheStats cacheStats;
 
 	void setup();
 };
 
-#endif
\ No newline at end of file
+#endif
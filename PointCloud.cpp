@@ -0,0 +1,62 @@
+#include <PointCloud.h>
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+PointCloud :: PointCloud() : vao(0), vbo(0), count(0), capacity(0) {
+
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vbo);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *) 0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+PointCloud :: ~PointCloud() {
+	glDeleteBuffers(1, &vbo);
+	glDeleteVertexArrays(1, &vao);
+}
+
+float * PointCloud :: Map(int count) {
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	if (count > capacity) {
+		capacity = count;
+		glBufferData(GL_ARRAY_BUFFER, capacity * 4 * sizeof(float), NULL, GL_STREAM_DRAW);
+	}
+	// Invalidated: the driver hands out fresh storage while the last frame's points are still drawn
+	void * data = glMapBufferRange(GL_ARRAY_BUFFER, 0, count * 4 * sizeof(float),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	if (!data) {
+		std::cerr << "PointCloud::Map: Unable to map " << count << " points\n";
+		this->count = 0;
+		return NULL;
+	}
+	this->count = count;
+	return (float *) data;
+}
+
+void PointCloud :: Unmap() {
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	// The contents are lost if the display mode changed meanwhile, skip a frame
+	if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE)
+		count = 0;
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void PointCloud :: Draw() const {
+
+	if (count == 0)
+		return;
+	glEnable(GL_PROGRAM_POINT_SIZE);
+	glBindVertexArray(vao);
+	glDrawArrays(GL_POINTS, 0, count);
+	glBindVertexArray(0);
+	glDisable(GL_PROGRAM_POINT_SIZE);
+}
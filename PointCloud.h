@@ -0,0 +1,32 @@
+#ifndef POINT_CLOUD_H
+#define POINT_CLOUD_H
+
+#include <glad/glad.h>
+
+/**
+* Points rewritten every frame, four floats each (attribute 0), drawn as
+* GL_POINTS with the shader's gl_PointSize. Map() orphans the buffer and
+* returns write-only memory to fill in place, from any thread, until
+* Unmap(); the GL calls themselves stay on the context's thread.
+*/
+
+class PointCloud {
+
+public:
+	/** Methods */
+	PointCloud();
+	~PointCloud();
+
+	float * Map(int count); // NULL if the driver refuses the mapping
+	void Unmap();
+	void Draw() const;
+
+	int Count() const { return count; }
+
+private:
+	/** GL Data */
+	GLuint vao, vbo;
+	int count, capacity; // points
+};
+
+#endif
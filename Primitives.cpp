@@ -122,7 +122,7 @@ void Base2D :: AddTexture(unsigned int tid) { // for frame buffer
 void Base2D :: AddTexture(const std::string path, TextureType type, bool gamma) {
 	
 	Texture texture;
-	texture.id   = LoadTexture(path, gamma);
+	texture.id   = LoadTexture(path, gamma, type);
 	texture.path = path;
 	texture.type = type;
 	if (texture.id != 0) {
@@ -193,6 +193,8 @@ Base3D :: ~Base3D() {
 
 void Base3D :: setup() {
 
+	bounds = Bounds::FromVertices(vertices);
+
 	glGenBuffers(1, &vbo); // Generate an empty vertex buffer on the GPU
 	glGenBuffers(1, &ebo);
 	glGenVertexArrays(1, &vao); // Tell OpenGL to create new Vertex Array Object
@@ -285,7 +287,7 @@ void Base3D :: AddTexture(unsigned int tid) {
 void Base3D :: AddTexture(const std::string path, TextureType type, bool gamma) {
 	
 	Texture texture;
-	texture.id   = LoadTexture(path, gamma);
+	texture.id   = LoadTexture(path, gamma, type);
 	texture.type = type;
 	texture.path = path;
 	if (texture.id != 0) {
@@ -72,6 +72,7 @@ public:
 	std::vector<Vertex>        vertices;
 	std::vector<unsigned int>  indices;
 	std::vector<Texture>       textures;
+	Bounds                     bounds; // model space, set by setup()
 
 	/** Methods */
 	Base3D();
@@ -0,0 +1,159 @@
+#include <RenderQueue.h>
+#include <ShaderProgram.h>
+#include <Material.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+static const int DEPTH_BITS = 24;
+
+RenderQueue :: RenderQueue()
+	: eye(0.0f), farPlane(100.0f), viewProjection(1.0f)
+{
+	std::memset(&stats, 0, sizeof(stats));
+}
+
+void RenderQueue :: Begin(const glm::vec3 & eye, float farPlane, const glm::mat4 & viewProjection) {
+	this->eye = eye;
+	this->farPlane = farPlane;
+	this->viewProjection = viewProjection;
+	frustum = Frustum(viewProjection);
+}
+
+void RenderQueue :: Submit(unsigned int pass, const DrawPacket & packet) {
+	Submit(pass, packet, Bounds::Infinite());
+}
+
+void RenderQueue :: Submit(unsigned int pass, const DrawPacket & packet, const Bounds & bounds) {
+
+	float distance = glm::length(glm::vec3(packet.model[3]) - eye) / farPlane;
+	uint64_t depth = (uint64_t) (glm::clamp(distance, 0.0f, 1.0f) * ((1 << DEPTH_BITS) - 1));
+	uint64_t program = packet.shader->ID() & 0xff;
+	uint64_t material = packet.material ? packet.material->Id() & 0xfff : 0;
+	uint64_t vao = packet.vao & 0xfff;
+
+	uint64_t key = (uint64_t) (pass & 0xf) << 60;
+	if (packet.material && packet.material->Translucent()) {
+		uint64_t farFirst = ((1 << DEPTH_BITS) - 1) - depth;
+		key |= 1ull << 59 | farFirst << 32 | program << 24 | material << 12 | vao;
+	} else {
+		key |= program << 51 | material << 39 | vao << 27 | depth << 3;
+	}
+
+	SortItem item = {key, (uint32_t) packets.size()};
+	items.push_back(item);
+	packets.push_back(packet);
+	culler.Add(bounds);
+}
+
+void RenderQueue :: cull() {
+
+	// Items are still in submission order, so item i is culler entry i
+	culler.Cull(frustum);
+	size_t kept = 0;
+	for (size_t i=0; i<items.size(); i++)
+		if (culler.Visible((unsigned int) i))
+			items[kept++] = items[i];
+	items.resize(kept);
+	stats.culled = culler.LastStats().culled;
+}
+
+void RenderQueue :: sort() {
+
+	// LSD radix sort on 16-bit digits; digits every key shares are skipped
+	scratch.resize(items.size());
+	counts.resize(1 << 16);
+	for (int shift=0; shift<64; shift+=16) {
+		std::fill(counts.begin(), counts.end(), 0);
+		for (const SortItem & item : items)
+			counts[(item.key >> shift) & 0xffff]++;
+		if (counts[(items[0].key >> shift) & 0xffff] == items.size())
+			continue;
+
+		uint32_t offset = 0;
+		for (uint32_t & count : counts) {
+			uint32_t n = count;
+			count = offset;
+			offset += n;
+		}
+		for (const SortItem & item : items)
+			scratch[counts[(item.key >> shift) & 0xffff]++] = item;
+		items.swap(scratch);
+	}
+}
+
+void RenderQueue :: execute() {
+
+	Shader * shader = NULL;
+	const Material * material = NULL;
+	GLuint vao = 0;
+	unsigned int flags = ~0u;
+	GLint modelLoc = -1, mvpLoc = -1, normalMatrixLoc = -1;
+	GLint normalLoc = -1, emissionLoc = -1, atmosphereLoc = -1;
+
+	for (const SortItem & item : items) {
+		const DrawPacket & packet = packets[item.index];
+
+		if (packet.shader != shader) {
+			shader = packet.shader;
+			shader->use();
+			modelLoc        = glGetUniformLocation(shader->ID(), "uModel");
+			mvpLoc          = glGetUniformLocation(shader->ID(), "uModelViewProjection");
+			normalMatrixLoc = glGetUniformLocation(shader->ID(), "uNormalMatrix");
+			normalLoc     = glGetUniformLocation(shader->ID(), "uEnableNormal");
+			emissionLoc   = glGetUniformLocation(shader->ID(), "uEnableEmission");
+			atmosphereLoc = glGetUniformLocation(shader->ID(), "uEnableAtmosphere");
+			material = NULL;
+			flags = ~0u;
+			stats.programs++;
+		}
+		if (packet.material && packet.material != material) {
+			material = packet.material;
+			material->Bind(*shader);
+			stats.materials++;
+		}
+		if (packet.vao != vao) {
+			vao = packet.vao;
+			glBindVertexArray(vao);
+			stats.vaos++;
+		}
+		if (packet.flags != flags) {
+			flags = packet.flags;
+			glUniform1i(normalLoc, (flags & DRAW_NORMAL) ? 1 : 0);
+			glUniform1i(emissionLoc, (flags & DRAW_EMISSION) ? 1 : 0);
+			glUniform1i(atmosphereLoc, (flags & DRAW_ATMOSPHERE) ? 1 : 0);
+		}
+
+		// One product per draw instead of per vertex; every pass computes it the same
+		// way, so the pre-pass and main pass positions still agree bit for bit
+		glm::mat4 modelViewProjection = viewProjection * packet.model;
+		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(packet.model));
+		glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, glm::value_ptr(modelViewProjection));
+		glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(packet.normal));
+		glDrawElements(GL_TRIANGLES, packet.count, GL_UNSIGNED_INT, 0);
+		stats.draws++;
+	}
+
+	glBindVertexArray(0);
+}
+
+void RenderQueue :: Flush() {
+
+	std::memset(&stats, 0, sizeof(stats));
+	if (!items.empty())
+		cull();
+	if (!items.empty()) {
+		sort();
+		execute();
+	}
+
+	packets.clear();
+	items.clear();
+	culler.Clear();
+}
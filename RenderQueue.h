@@ -0,0 +1,90 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <vector>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <ShaderProgram.h>
+#include <Material.h>
+#include <Culling.h>
+
+/**
+* Per-frame draw queue. Objects submit packets; Flush() radix-sorts them by
+* a 64-bit key and issues them, changing program, material and vertex array
+* only when the next packet needs a different one. Packets carry world-space
+* bounds; Flush() culls them all against the pass frustum in one batch
+* before sorting, so culled packets cost neither a sort slot nor a draw.
+*
+* Key layout, most significant first:
+*   opaque       pass:4 | 0 | program:8 | material:12 | vao:12 | depth:24 (front to back)
+*   translucent  pass:4 | 1 | depth:24 (back to front) | program:8 | material:12 | vao:12
+*/
+
+enum DrawFlags {
+	DRAW_NORMAL     = 1 << 0, // uEnableNormal
+	DRAW_EMISSION   = 1 << 1, // uEnableEmission
+	DRAW_ATMOSPHERE = 1 << 2  // uEnableAtmosphere
+};
+
+struct DrawPacket {
+	Shader * shader;
+	const Material * material; // NULL for depth-only packets
+	GLuint vao;
+	GLsizei count; // indices, GL_UNSIGNED_INT triangles
+	unsigned int flags;
+	glm::mat4 model;
+	glm::mat3 normal; // transpose(inverse(mat3(model))), from the frame's scene state
+};
+
+class RenderQueue {
+
+public:
+	struct Stats {
+		unsigned int draws;
+		unsigned int culled;
+		unsigned int programs;
+		unsigned int materials;
+		unsigned int vaos;
+	};
+
+	/** Methods */
+	RenderQueue();
+
+	// Depth in keys is the distance from eye, scaled to [0, farPlane];
+	// packets are culled against the frustum of viewProjection, and drawn
+	// with uModelViewProjection = viewProjection * model
+	void Begin(const glm::vec3 & eye, float farPlane, const glm::mat4 & viewProjection);
+	void Submit(unsigned int pass, const DrawPacket & packet, const Bounds & bounds);
+	void Submit(unsigned int pass, const DrawPacket & packet); // never culled
+	void Flush(); // sort, execute, clear
+
+	unsigned int Size() const { return (unsigned int) packets.size(); }
+	const Stats & LastStats() const { return stats; }
+
+private:
+	struct SortItem {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	/** Queue Data */
+	std::vector<DrawPacket> packets;
+	std::vector<SortItem> items, scratch;
+	std::vector<uint32_t> counts; // radix histogram, kept across frames
+	glm::vec3 eye;
+	float farPlane;
+	glm::mat4 viewProjection;
+	Frustum frustum;
+	FrustumCuller culler; // one entry per packet, same order
+	Stats stats;
+
+	/** Methods */
+	void cull();
+	void sort();
+	void execute();
+};
+
+#endif
@@ -0,0 +1,479 @@
+#include <SatelliteCatalogue.h>
+#include <ThreadPool.h>
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// WGS-72, as the element sets are fitted with it
+const double SatelliteCatalogue::EARTH_RADIUS = 6378.135;
+static const double MU = 398600.8;          // km^3/s^2
+static const double J2 = 0.001082616;
+static const double J3 = -0.00000253881;
+static const double J4 = -0.00000165597;
+static const double J3OJ2 = J3 / J2;
+static const double XKE = 60.0 / std::sqrt(SatelliteCatalogue::EARTH_RADIUS
+	* SatelliteCatalogue::EARTH_RADIUS * SatelliteCatalogue::EARTH_RADIUS / MU); // Earth radii^1.5 / min
+static const double PI = 3.14159265358979323846;
+static const double TWO_PI = 2.0 * PI;
+static const double X2O3 = 2.0 / 3.0;
+
+// Satellites per SIMD batch, and batches per pool task
+static const int BATCH = 4;
+static const int BATCH_GRAIN = 64;
+
+//-----------------------------------------------------------------------------
+// Lanes: the propagation kernel is written once against these. Scalar uses
+// the C library; AVX2 four doubles with polynomial sine and cosine
+//-----------------------------------------------------------------------------
+struct ScalarLanes {
+	typedef double Value;
+	typedef bool Mask;
+
+	static Value Load(const double * p) { return *p; }
+	static void SinCos(Value x, Value & s, Value & c) { s = std::sin(x); c = std::cos(x); }
+	static Value Sqrt(Value x) { return std::sqrt(x); }
+	static Value Abs(Value x) { return std::abs(x); }
+	static Value Min(Value a, Value b) { return std::min(a, b); }
+	static Value Max(Value a, Value b) { return std::max(a, b); }
+	static Value Mod2Pi(Value x) { return std::fmod(x, TWO_PI); }
+	static Mask Less(Value a, Value b) { return a < b; }
+	static Mask And(Mask a, Mask b) { return a && b; }
+	static Mask AndNot(Mask a, Mask b) { return a && !b; }
+	static Mask All() { return true; }
+	static bool Any(Mask m) { return m; }
+	static Value Select(Mask m, Value a, Value b) { return m ? a : b; }
+
+	static void Store(Value x, Value y, Value z, Mask valid, float * out) {
+		out[0] = valid ? (float) x : 0.0f;
+		out[1] = valid ? (float) y : 0.0f;
+		out[2] = valid ? (float) z : 0.0f;
+		out[3] = valid ? 1.0f : 0.0f;
+	}
+};
+
+#if defined(__AVX2__)
+struct Double4 {
+	__m256d v;
+	Double4() {}
+	Double4(__m256d v) : v(v) {}
+	Double4(double x) : v(_mm256_set1_pd(x)) {}
+};
+static inline Double4 operator+(Double4 a, Double4 b) { return _mm256_add_pd(a.v, b.v); }
+static inline Double4 operator-(Double4 a, Double4 b) { return _mm256_sub_pd(a.v, b.v); }
+static inline Double4 operator*(Double4 a, Double4 b) { return _mm256_mul_pd(a.v, b.v); }
+static inline Double4 operator/(Double4 a, Double4 b) { return _mm256_div_pd(a.v, b.v); }
+static inline Double4 operator-(Double4 a) { return _mm256_xor_pd(a.v, _mm256_set1_pd(-0.0)); }
+
+struct Avx2Lanes {
+	typedef Double4 Value;
+	typedef __m256d Mask; // all ones or all zeros per lane
+
+	static Value Load(const double * p) { return _mm256_loadu_pd(p); }
+
+	// Cody-Waite reduction by pi/2 and the Cephes polynomials on [-pi/4, pi/4]
+	static void SinCos(Value x, Value & s, Value & c) {
+		Value q = _mm256_round_pd((x * 0.63661977236758134308).v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		Value r = x - q * 1.57079625129699707031 - q * 7.54978941586159635336e-8 - q * 5.39030285815811905290e-15;
+		Value z = r * r;
+		Value sinr = r + r * z * (((((1.58962301576546568060e-10 * z - 2.50507477628578072866e-8) * z
+			+ 2.75573136213857245213e-6) * z - 1.98412698295895385996e-4) * z
+			+ 8.33333333332211858878e-3) * z - 1.66666666666666307295e-1);
+		Value cosr = 1.0 - 0.5 * z + z * z * (((((-1.13585365213876817300e-11 * z + 2.08757008419747316778e-9) * z
+			- 2.75573141792967388112e-7) * z + 2.48015872888517045348e-5) * z
+			- 1.38888888888730564116e-3) * z + 4.16666666666665929218e-2);
+
+		// Quadrant: odd swaps sine and cosine, bit 1 of q (of q + 1) flips the sine (cosine)
+		__m256i quadrant = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(q.v));
+		__m256i one = _mm256_set1_epi64x(1), two = _mm256_set1_epi64x(2);
+		__m256d swap = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(quadrant, one), one));
+		__m256d sinSign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(quadrant, two), 62));
+		__m256d cosSign = _mm256_castsi256_pd(_mm256_slli_epi64(
+			_mm256_and_si256(_mm256_add_epi64(quadrant, one), two), 62));
+		s = _mm256_xor_pd(_mm256_blendv_pd(sinr.v, cosr.v, swap), sinSign);
+		c = _mm256_xor_pd(_mm256_blendv_pd(cosr.v, sinr.v, swap), cosSign);
+	}
+	static Value Sqrt(Value x) { return _mm256_sqrt_pd(x.v); }
+	static Value Abs(Value x) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x.v); }
+	static Value Min(Value a, Value b) { return _mm256_min_pd(a.v, b.v); }
+	static Value Max(Value a, Value b) { return _mm256_max_pd(a.v, b.v); }
+	static Value Mod2Pi(Value x) {
+		// fmod: the quotient truncated toward zero
+		return x - Value(_mm256_round_pd((x / TWO_PI).v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)) * TWO_PI;
+	}
+	static Mask Less(Value a, Value b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ); }
+	static Mask And(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+	static Mask AndNot(Mask a, Mask b) { return _mm256_andnot_pd(b, a); }
+	static Mask All() { return _mm256_castsi256_pd(_mm256_set1_epi64x(-1)); }
+	static bool Any(Mask m) { return _mm256_movemask_pd(m) != 0; }
+	static Value Select(Mask m, Value a, Value b) { return _mm256_blendv_pd(b.v, a.v, m); }
+
+	static void Store(Value x, Value y, Value z, Mask valid, float * out) {
+		__m128 mask = _mm256_cvtpd_ps(valid); // all ones converts to a NaN that is still all ones
+		__m128 px = _mm256_cvtpd_ps(x.v), py = _mm256_cvtpd_ps(y.v), pz = _mm256_cvtpd_ps(z.v);
+		__m128 pw = _mm_and_ps(mask, _mm_set1_ps(1.0f));
+		px = _mm_and_ps(mask, px);
+		py = _mm_and_ps(mask, py);
+		pz = _mm_and_ps(mask, pz);
+		_MM_TRANSPOSE4_PS(px, py, pz, pw);
+		_mm_storeu_ps(out, px);
+		_mm_storeu_ps(out + 4, py);
+		_mm_storeu_ps(out + 8, pz);
+		_mm_storeu_ps(out + 12, pw);
+	}
+};
+#endif
+
+//-----------------------------------------------------------------------------
+// SatelliteCatalogue
+//-----------------------------------------------------------------------------
+template <class L>
+void SatelliteCatalogue :: propagate(const std::vector<double> * f, int i, double day, float * out) {
+
+	typedef typename L::Value V;
+	typedef typename L::Mask M;
+
+	V t = (V(day) - L::Load(&f[EPOCH][i])) * 1440.0; // minutes since epoch
+
+	// Secular gravity and atmospheric drag
+	V xmdf = L::Load(&f[MO][i]) + L::Load(&f[MDOT][i]) * t;
+	V argpm = L::Load(&f[ARGPO][i]) + L::Load(&f[ARGPDOT][i]) * t;
+	V t2 = t * t, t3 = t2 * t, t4 = t3 * t;
+	V nodem = L::Load(&f[NODEO][i]) + L::Load(&f[NODEDOT][i]) * t + L::Load(&f[NODECF][i]) * t2;
+	// The higher order terms have zero coefficients for low perigees
+	V sinxmdf, cosxmdf;
+	L::SinCos(xmdf, sinxmdf, cosxmdf);
+	V delmtemp = 1.0 + L::Load(&f[ETA][i]) * cosxmdf;
+	V temp = L::Load(&f[OMGCOF][i]) * t
+		+ L::Load(&f[XMCOF][i]) * (delmtemp * delmtemp * delmtemp - L::Load(&f[DELMO][i]));
+	V mm = xmdf + temp;
+	argpm = argpm - temp;
+	V tempa = 1.0 - L::Load(&f[CC1][i]) * t
+		- L::Load(&f[D2][i]) * t2 - L::Load(&f[D3][i]) * t3 - L::Load(&f[D4][i]) * t4;
+	V sinmm, cosmm;
+	L::SinCos(mm, sinmm, cosmm);
+	V tempe = L::Load(&f[BCC4][i]) * t + L::Load(&f[BCC5][i]) * (sinmm - L::Load(&f[SINMAO][i]));
+	V templ = L::Load(&f[T2COF][i]) * t2 + L::Load(&f[T3COF][i]) * t3
+		+ t4 * (L::Load(&f[T4COF][i]) + t * L::Load(&f[T5COF][i]));
+
+	V am = L::Load(&f[AO][i]) * tempa * tempa;
+	V em = L::Load(&f[ECCO][i]) - tempe;
+	M valid = L::AndNot(L::Less(em, 1.0), L::Less(em, -0.001));
+	em = L::Max(em, 1e-6);
+	mm = mm + L::Load(&f[NO][i]) * templ;
+	V xlm = L::Mod2Pi(mm + argpm + nodem);
+	nodem = L::Mod2Pi(nodem);
+	argpm = L::Mod2Pi(argpm);
+	mm = L::Mod2Pi(xlm - argpm - nodem);
+
+	// Long period periodics
+	V sinargp, cosargp;
+	L::SinCos(argpm, sinargp, cosargp);
+	V axnl = em * cosargp;
+	temp = 1.0 / (am * (1.0 - em * em));
+	V aynl = em * sinargp + temp * L::Load(&f[AYCOF][i]);
+	V xl = mm + argpm + nodem + temp * L::Load(&f[XLCOF][i]) * axnl;
+
+	// Kepler's equation, each lane stops where it converges
+	V u = L::Mod2Pi(xl - nodem);
+	V eo1 = u, sineo1 = 0.0, coseo1 = 1.0;
+	M active = L::All();
+	for (int k=0; k<10 && L::Any(active); k++) {
+		V s, c;
+		L::SinCos(eo1, s, c);
+		sineo1 = L::Select(active, s, sineo1);
+		coseo1 = L::Select(active, c, coseo1);
+		V step = (u - aynl * c + axnl * s - eo1) / (1.0 - c * axnl - s * aynl);
+		step = L::Min(L::Max(step, -0.95), 0.95);
+		eo1 = eo1 + L::Select(active, step, 0.0);
+		active = L::AndNot(active, L::Less(L::Abs(step), 1e-12));
+	}
+
+	// Short period preliminary quantities
+	V ecose = axnl * coseo1 + aynl * sineo1;
+	V esine = axnl * sineo1 - aynl * coseo1;
+	V el2 = axnl * axnl + aynl * aynl;
+	V pl = am * (1.0 - el2);
+	valid = L::And(valid, L::Less(0.0, pl));
+	V rl = am * (1.0 - ecose);
+	V betal = L::Sqrt(1.0 - el2);
+	temp = esine / (1.0 + betal);
+	V sinu = am / rl * (sineo1 - aynl - axnl * temp);
+	V cosu = am / rl * (coseo1 - axnl + aynl * temp);
+	V sin2u = (cosu + cosu) * sinu;
+	V cos2u = 1.0 - 2.0 * sinu * sinu;
+	temp = 1.0 / pl;
+	V temp1 = 0.5 * J2 * temp;
+	V temp2 = temp1 * temp;
+
+	// Short period periodics
+	V cosio = L::Load(&f[COSIO][i]);
+	V mrt = rl * (1.0 - 1.5 * temp2 * betal * L::Load(&f[CON41][i]))
+		+ 0.5 * temp1 * L::Load(&f[X1MTH2][i]) * cos2u;
+	V dsu = 0.25 * temp2 * L::Load(&f[X7THM1][i]) * sin2u;
+	V xnode = nodem + 1.5 * temp2 * cosio * sin2u;
+	V xinc = L::Load(&f[INCLO][i]) + 1.5 * temp2 * cosio * L::Load(&f[SINIO][i]) * cos2u;
+	valid = L::AndNot(valid, L::Less(mrt, 1.0)); // decayed
+
+	// Orientation vector. su is atan2(sinu, cosu) - dsu: rotate (cosu, sinu)
+	// back by dsu instead of taking the arctangent
+	V norm = 1.0 / L::Sqrt(sinu * sinu + cosu * cosu);
+	V sindsu, cosdsu, snod, cnod, sini, cosi;
+	L::SinCos(dsu, sindsu, cosdsu);
+	L::SinCos(xnode, snod, cnod);
+	L::SinCos(xinc, sini, cosi);
+	V sinsu = (sinu * cosdsu - cosu * sindsu) * norm;
+	V cossu = (cosu * cosdsu + sinu * sindsu) * norm;
+	V xmx = -snod * cosi;
+	V xmy = cnod * cosi;
+	V r = mrt * SatelliteCatalogue::EARTH_RADIUS;
+	L::Store(r * (xmx * sinsu + cnod * cossu), r * (xmy * sinsu + snod * cossu), r * (sini * sinsu),
+		valid, out);
+}
+
+SatelliteCatalogue :: SatelliteCatalogue() : count(0) {}
+
+static std::string trimmed(const std::string & text) {
+	size_t first = text.find_first_not_of(" \t\r\n");
+	if (first == std::string::npos)
+		return "";
+	return text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+bool SatelliteCatalogue :: Load(const std::string & filename) {
+
+	std::ifstream file(filename);
+	if (!file) {
+		std::cerr << "SatelliteCatalogue::Load: Unable to open " << filename << "\n";
+		return false;
+	}
+
+	// Three-line sets carry a name line (in some catalogues prefixed "0 ")
+	std::string line, line1, name;
+	int rejected = 0;
+	while (std::getline(file, line)) {
+		line = trimmed(line);
+		if (line.empty())
+			continue;
+		if (line.compare(0, 2, "1 ") == 0) {
+			line1 = line;
+		} else if (line.compare(0, 2, "2 ") == 0 && !line1.empty()) {
+			if (!Add(line1, line, name))
+				rejected++;
+			line1.clear();
+			name.clear();
+		} else {
+			name = line.compare(0, 2, "0 ") == 0 ? line.substr(2) : line;
+		}
+	}
+
+	if (rejected > 0)
+		std::cerr << "SatelliteCatalogue::Load: " << rejected << " element sets rejected in " << filename << "\n";
+	return true;
+}
+
+bool SatelliteCatalogue :: Add(const std::string & line1, const std::string & line2, const std::string & name) {
+
+	if (line1.size() < 68 || line2.size() < 63 || line1[0] != '1' || line2[0] != '2')
+		return false;
+
+	auto number = [] (const std::string & line, size_t first, size_t length) {
+		return std::atof(line.substr(first, length).c_str());
+	};
+	// Implied leading decimal point and exponent: " 12345-4" is 0.12345e-4
+	auto exponential = [] (const std::string & line, size_t first) {
+		double mantissa = std::atof(("0." + line.substr(first + 1, 5)).c_str());
+		double value = mantissa * std::pow(10.0, std::atoi(line.substr(first + 6, 2).c_str()));
+		return line[first] == '-' ? -value : value;
+	};
+
+	// Epoch: two digit year (57 to 99 in the 1900s) and fractional day of the year
+	int year = std::atoi(line1.substr(18, 2).c_str());
+	year += year < 57 ? 2000 : 1900;
+	double epoch = 367.0 * year - std::floor(7.0 * year / 4.0) + 30.0 + 1721013.5 + number(line1, 20, 12);
+
+	double deg = PI / 180.0;
+	double inclination = number(line2, 8, 8) * deg;
+	double node = number(line2, 17, 8) * deg;
+	double eccentricity = std::atof(("0." + line2.substr(26, 7)).c_str());
+	double perigee = number(line2, 34, 8) * deg;
+	double anomaly = number(line2, 43, 8) * deg;
+	double meanMotion = number(line2, 52, 11) * TWO_PI / 1440.0; // rev/day to rad/min
+	double bstar = exponential(line1, 53);
+
+	if (meanMotion <= 0.0 || eccentricity >= 1.0)
+		return false;
+
+	initialise(epoch, meanMotion, eccentricity, inclination, node, perigee, anomaly, bstar);
+	names.push_back(name.empty() ? trimmed(line1.substr(2, 5)) : name);
+	count++;
+	return true;
+}
+
+void SatelliteCatalogue :: initialise(double epoch, double no, double ecco, double inclo,
+	double nodeo, double argpo, double mo, double bstar) {
+
+	// Recover the original mean motion and semi-major axis from the Kozai mean motion
+	double eccsq = ecco * ecco;
+	double omeosq = 1.0 - eccsq;
+	double rteosq = std::sqrt(omeosq);
+	double cosio = std::cos(inclo), sinio = std::sin(inclo);
+	double cosio2 = cosio * cosio;
+	double ak = std::pow(XKE / no, X2O3);
+	double d1 = 0.75 * J2 * (3.0 * cosio2 - 1.0) / (rteosq * omeosq);
+	double del = d1 / (ak * ak);
+	double adel = ak * (1.0 - del * del - del * (1.0 / 3.0 + 134.0 * del * del / 81.0));
+	del = d1 / (adel * adel);
+	no = no / (1.0 + del);
+	double ao = std::pow(XKE / no, X2O3);
+
+	double po = ao * omeosq;
+	double con42 = 1.0 - 5.0 * cosio2;
+	double con41 = -con42 - cosio2 - cosio2;
+	double posq = po * po;
+	double rp = ao * (1.0 - ecco);
+
+	// Perigees under 220 km, and deep-space orbits here, keep to the simple drag model
+	bool simple = rp < 220.0 / EARTH_RADIUS + 1.0 || TWO_PI / no >= 225.0;
+
+	// Density function, with s moved down for perigees under 156 km
+	double sfour = 78.0 / EARTH_RADIUS + 1.0;
+	double qzms24 = std::pow((120.0 - 78.0) / EARTH_RADIUS, 4.0);
+	double perige = (rp - 1.0) * EARTH_RADIUS;
+	if (perige < 156.0) {
+		sfour = perige < 98.0 ? 20.0 : perige - 78.0;
+		qzms24 = std::pow((120.0 - sfour) / EARTH_RADIUS, 4.0);
+		sfour = sfour / EARTH_RADIUS + 1.0;
+	}
+	double pinvsq = 1.0 / posq;
+	double tsi = 1.0 / (ao - sfour);
+	double eta = ao * ecco * tsi;
+	double etasq = eta * eta;
+	double eeta = ecco * eta;
+	double psisq = std::abs(1.0 - etasq);
+	double coef = qzms24 * std::pow(tsi, 4.0);
+	double coef1 = coef / std::pow(psisq, 3.5);
+	double cc2 = coef1 * no * (ao * (1.0 + 1.5 * etasq + eeta * (4.0 + etasq))
+		+ 0.375 * J2 * tsi / psisq * con41 * (8.0 + 3.0 * etasq * (8.0 + etasq)));
+	double cc1 = bstar * cc2;
+	double cc3 = ecco > 1.0e-4 ? -2.0 * coef * tsi * J3OJ2 * no * sinio / ecco : 0.0;
+	double x1mth2 = 1.0 - cosio2;
+	double cc4 = 2.0 * no * coef1 * ao * omeosq * (eta * (2.0 + 0.5 * etasq) + ecco * (0.5 + 2.0 * etasq)
+		- J2 * tsi / (ao * psisq) * (-3.0 * con41 * (1.0 - 2.0 * eeta + etasq * (1.5 - 0.5 * eeta))
+		+ 0.75 * x1mth2 * (2.0 * etasq - eeta * (1.0 + etasq)) * std::cos(2.0 * argpo)));
+	double cc5 = 2.0 * coef1 * ao * omeosq * (1.0 + 2.75 * (etasq + eeta) + eeta * etasq);
+
+	// Secular rates
+	double cosio4 = cosio2 * cosio2;
+	double temp1 = 1.5 * J2 * pinvsq * no;
+	double temp2 = 0.5 * temp1 * J2 * pinvsq;
+	double temp3 = -0.46875 * J4 * pinvsq * pinvsq * no;
+	double mdot = no + 0.5 * temp1 * rteosq * con41 + 0.0625 * temp2 * rteosq * (13.0 - 78.0 * cosio2 + 137.0 * cosio4);
+	double argpdot = -0.5 * temp1 * con42 + 0.0625 * temp2 * (7.0 - 114.0 * cosio2 + 395.0 * cosio4)
+		+ temp3 * (3.0 - 36.0 * cosio2 + 49.0 * cosio4);
+	double xhdot1 = -temp1 * cosio;
+	double nodedot = xhdot1 + (0.5 * temp2 * (4.0 - 19.0 * cosio2) + 2.0 * temp3 * (3.0 - 7.0 * cosio2)) * cosio;
+	double omgcof = bstar * cc3 * std::cos(argpo);
+	double xmcof = ecco > 1.0e-4 ? -X2O3 * coef * bstar / eeta : 0.0;
+	double nodecf = 3.5 * omeosq * xhdot1 * cc1;
+	double t2cof = 1.5 * cc1;
+	// Division by zero for an inclination of 180 degrees
+	double xlcof = -0.25 * J3OJ2 * sinio * (3.0 + 5.0 * cosio) / std::max(std::abs(1.0 + cosio), 1.5e-12);
+	double aycof = -0.5 * J3OJ2 * sinio;
+	double delmo = std::pow(1.0 + eta * std::cos(mo), 3.0);
+	double x7thm1 = 7.0 * cosio2 - 1.0;
+
+	double d2 = 0.0, d3 = 0.0, d4 = 0.0, t3cof = 0.0, t4cof = 0.0, t5cof = 0.0;
+	if (simple) {
+		omgcof = 0.0;
+		xmcof = 0.0;
+		cc5 = 0.0;
+	} else {
+		double cc1sq = cc1 * cc1;
+		d2 = 4.0 * ao * tsi * cc1sq;
+		double temp = d2 * tsi * cc1 / 3.0;
+		d3 = (17.0 * ao + sfour) * temp;
+		d4 = 0.5 * temp * ao * tsi * (221.0 * ao + 31.0 * sfour) * cc1;
+		t3cof = d2 + 2.0 * cc1sq;
+		t4cof = 0.25 * (3.0 * d3 + cc1 * (12.0 * d2 + 10.0 * cc1sq));
+		t5cof = 0.2 * (3.0 * d4 + 12.0 * cc1 * d3 + 6.0 * d2 * d2 + 15.0 * cc1sq * (2.0 * d2 + cc1sq));
+	}
+
+	const double values[FIELD_COUNT] = {
+		epoch, no, ao, ecco, bstar, inclo,
+		mo, mdot, argpo, argpdot, nodeo, nodedot, nodecf,
+		sinio, cosio,
+		cc1, bstar * cc4, bstar * cc5, t2cof, t3cof, t4cof, t5cof,
+		d2, d3, d4,
+		eta, omgcof, xmcof, delmo, std::sin(mo),
+		aycof, xlcof, con41, x1mth2, x7thm1
+	};
+	for (int f=0; f<FIELD_COUNT; f++)
+		fields[f].push_back(values[f]);
+}
+
+void SatelliteCatalogue :: Propagate(double day, float * positions, ThreadPool * pool,
+	PropagationKernel kernel) const {
+
+#if defined(__AVX2__)
+	bool simd = kernel == PROPAGATE_SIMD;
+#else
+	(void) kernel; // scalar is all there is
+#endif
+	int batches = (count + BATCH - 1) / BATCH;
+
+	auto run = [&] (int first, int last) {
+		for (int b=first; b<last; b++) {
+			int begin = b * BATCH, end = std::min(count, begin + BATCH);
+#if defined(__AVX2__)
+			if (simd && end - begin == BATCH) {
+				propagate<Avx2Lanes>(fields, begin, day, positions + 4 * begin);
+				continue;
+			}
+#endif
+			for (int i=begin; i<end; i++)
+				propagate<ScalarLanes>(fields, i, day, positions + 4 * i);
+		}
+	};
+
+	if (pool)
+		pool->ParallelFor(0, batches, run, BATCH_GRAIN);
+	else
+		run(0, batches);
+}
+
+void SatelliteCatalogue :: PropagateSatellite(int satellite, double day, float * position) const {
+	propagate<ScalarLanes>(fields, satellite, day, position);
+}
+
+const char * SatelliteCatalogue :: KernelName(PropagationKernel kernel) {
+#if defined(__AVX2__)
+	return kernel == PROPAGATE_SIMD ? "AVX2" : "scalar";
+#else
+	(void) kernel;
+	return "scalar";
+#endif
+}
+
+bool SatelliteCatalogue :: HasSimdKernel() {
+#if defined(__AVX2__)
+	return true;
+#else
+	return false;
+#endif
+}
+
+double SatelliteCatalogue :: SiderealAngle(double day) {
+	double T = (day - 2451545.0) / 36525.0;
+	double seconds = -6.2e-6 * T * T * T + 0.093104 * T * T + (876600.0 * 3600.0 + 8640184.812866) * T + 67310.54841;
+	double angle = std::fmod(seconds * PI / 180.0 / 240.0, TWO_PI); // 240 s of time to the degree
+	return angle < 0.0 ? angle + TWO_PI : angle;
+}
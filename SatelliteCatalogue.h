@@ -0,0 +1,90 @@
+#ifndef SATELLITE_CATALOGUE_H
+#define SATELLITE_CATALOGUE_H
+
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+/**
+* Orbital elements of a satellite catalogue (two- or three-line element
+* sets) propagated with SGP4 (Vallado's revision, WGS-72 constants).
+*
+* The elements and every constant SGP4 derives from them at load time are
+* kept one array per field, so a batch of satellites is a load from each
+* array. With AVX2 enabled (SIMD = -mavx2) Propagate() runs four satellites
+* per instruction with polynomial sine and cosine; the scalar kernel is the
+* reference and handles the tail. Batches are shared out over a ThreadPool.
+*
+* Deep-space orbits (periods of 225 minutes and more) are propagated with
+* the near-Earth model, without SDP4's lunar-solar and resonance terms:
+* their positions drift by tens of kilometres a day from the epoch, which
+* is well inside a pixel at the scale of the globe.
+*/
+
+enum PropagationKernel {
+	PROPAGATE_SCALAR,
+	PROPAGATE_SIMD    // AVX2 when compiled in, scalar otherwise
+};
+
+class SatelliteCatalogue {
+
+public:
+	static const double EARTH_RADIUS; // km, WGS-72
+
+	/** Methods */
+	SatelliteCatalogue();
+
+	// Appends every element set of the file, false if it cannot be read
+	bool Load(const std::string & filename);
+	// One element set, false if it does not parse
+	bool Add(const std::string & line1, const std::string & line2, const std::string & name = "");
+
+	int Size() const { return count; }
+	const std::string & Name(int i) const { return names[i]; }
+
+	// Positions at day (Julian, UTC) in the TEME frame, km, four floats per
+	// satellite: w is 1, or 0 once the elements have failed (decayed or out
+	// of range) and the satellite should not be drawn. Any pool worker may
+	// write any part of positions, so it must be safe to write from them
+	void Propagate(double day, float * positions, ThreadPool * pool = NULL,
+		PropagationKernel kernel = PROPAGATE_SIMD) const;
+	static const char * KernelName(PropagationKernel kernel);
+	// Whether PROPAGATE_SIMD has a batch kernel of its own (AVX2) in this build
+	static bool HasSimdKernel();
+	// One satellite, four floats as above, with the scalar kernel
+	void PropagateSatellite(int satellite, double day, float * position) const;
+
+	// Greenwich mean sidereal angle (IAU-82), radians: TEME to Earth-fixed about z
+	static double SiderealAngle(double day);
+
+private:
+	// Per satellite, in the order of the derivation in sgp4init()
+	enum Field {
+		EPOCH,       // Julian day
+		NO,          // un-Kozai'd mean motion, rad/min
+		AO,          // semi-major axis, Earth radii
+		ECCO, BSTAR, INCLO,
+		MO, MDOT, ARGPO, ARGPDOT, NODEO, NODEDOT, NODECF,
+		SINIO, COSIO,
+		CC1, BCC4, BCC5, T2COF, T3COF, T4COF, T5COF,
+		D2, D3, D4,
+		ETA, OMGCOF, XMCOF, DELMO, SINMAO,
+		AYCOF, XLCOF, CON41, X1MTH2, X7THM1,
+		FIELD_COUNT
+	};
+
+	/** Catalogue Data */
+	std::vector<double> fields[FIELD_COUNT];
+	std::vector<std::string> names;
+	int count;
+
+	/** Methods */
+	void initialise(double epoch, double no, double ecco, double inclo,
+		double nodeo, double argpo, double mo, double bstar);
+	// Satellite i, or i to i + 3 with AVX2 lanes, into their own four floats each
+	template <class Lanes>
+	static void propagate(const std::vector<double> * fields, int i, double day, float * out);
+};
+
+#endif
@@ -84,6 +84,40 @@ bool Shader::loadShaders(
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Load a vertex shader whose outputs are captured by transform feedback
+//-----------------------------------------------------------------------------
+bool Shader::loadFeedbackShader(
+	const char* vsFilename,
+	const char* const* varyings,
+	int varyingCount)
+{
+	mHandle = glCreateProgram();
+	if (mHandle == 0) {
+		std::cerr << "Unable to create shader program!" << std::endl;
+		return false;
+	}
+
+	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+	std::string vsString = fileToString(vsFilename);
+	const GLchar* vsSourcePtr = vsString.c_str();
+	glShaderSource(vs, 1, &vsSourcePtr, NULL);
+	glCompileShader(vs);
+	checkCompileErrors(vs, VERTEX);
+	glAttachShader(mHandle, vs);
+
+	// Before linking, which assigns the captured outputs
+	glTransformFeedbackVaryings(mHandle, varyingCount, varyings, GL_INTERLEAVED_ATTRIBS);
+	glLinkProgram(mHandle);
+	checkCompileErrors(mHandle, PROGRAM);
+
+	glDeleteShader(vs);
+
+	mUniformLocations.clear();
+
+	return true;
+}
+
 //-----------------------------------------------------------------------------
 // Opens and reads contents of ASCII file to a string.  Returns the string.
 // Not good for very large files.
@@ -240,6 +274,15 @@ void Shader :: setUniform(const string& name, float x, float y, float z, float w
 	glUniform4f(loc, x, y, z, w);
 }
 
+//-----------------------------------------------------------------------------
+// Sets a glm::ivec3 shader uniform
+//-----------------------------------------------------------------------------
+void Shader :: setUniform(const string& name, const glm::ivec3& v)
+{
+	GLint loc = getUniformLocation(name.c_str());
+	glUniform3iv(loc, 1, &v[0]);
+}
+
 //-----------------------------------------------------------------------------
 // Sets a glm::mat2 shader uniform
 //-----------------------------------------------------------------------------
@@ -35,6 +35,13 @@ public:
 		const char* fsFilename,
 		const char* gsFilename = NULL);
 
+	// Vertex shader only, for transform feedback: the varyings are captured
+	// interleaved into one buffer, in order
+	bool loadFeedbackShader(
+		const char* vsFilename,
+		const char* const* varyings,
+		int varyingCount);
+
 	void setUniform(const std::string& name, bool value);
 	void setUniform(const std::string& name, int value);
 	void setUniform(const std::string& name, float value);
@@ -44,6 +51,7 @@ public:
 	void setUniform(const std::string& name, const glm::vec2& v);
 	void setUniform(const std::string& name, const glm::vec3& v);
 	void setUniform(const std::string& name, const glm::vec4& v);
+	void setUniform(const std::string& name, const glm::ivec3& v);
 	void setUniform(const std::string& name, const glm::mat2& m);
 	void setUniform(const std::string& name, const glm::mat3& m);
 	void setUniform(const std::string& name, const glm::mat4& m);
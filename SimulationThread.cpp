@@ -0,0 +1,41 @@
+#include <SimulationThread.h>
+
+#include <thread>
+#include <mutex>
+#include <functional>
+
+SimulationThread :: SimulationThread(std::function<void()> step)
+	: step(step), pending(false), stopping(false), worker(&SimulationThread::work, this)
+{
+}
+
+SimulationThread :: ~SimulationThread() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeup.notify_one();
+	worker.join();
+}
+
+void SimulationThread :: Kick() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending = true;
+	}
+	wakeup.notify_one();
+}
+
+void SimulationThread :: work() {
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeup.wait(lock, [this] { return pending || stopping; });
+			if (stopping)
+				return;
+			pending = false;
+		}
+		step();
+	}
+}
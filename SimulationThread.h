@@ -0,0 +1,39 @@
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/**
+* One worker thread that runs a simulation step whenever the render loop
+* asks for it. The render loop kicks off step N+1 and then draws the
+* result of step N, so simulation overlaps GL submission; results travel
+* back through a TripleBuffer, never through this class. Kicks that
+* arrive while a step is running fold into a single next step.
+*/
+
+class SimulationThread {
+
+public:
+	/** Methods */
+	SimulationThread(std::function<void()> step);
+	~SimulationThread(); // finishes the running step, drops a pending one
+
+	void Kick();
+
+private:
+	/** Thread Data */
+	std::function<void()> step;
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	bool pending;
+	bool stopping;
+	std::thread worker; // last, starts once the rest is set up
+
+	/** Methods */
+	void work();
+};
+
+#endif
@@ -7,6 +7,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cmath>
+
 /** Shader Wrapper */
 #include <ShaderProgram.h>
 
@@ -80,7 +82,7 @@ void Skybox :: Draw(Shader & shader, glm::mat4 & view, glm::mat4 & projection) {
 	shader.use();
 	shader.setUniform("uView", view);
 	shader.setUniform("uProjection", projection);
-	shader.setUniform("uSkybox", 0); // no other texture units
+	shader.setUniform("uSkybox", (int) active_texture_unit);
 
 	glDepthMask(GL_FALSE);
 	glDepthFunc(GL_LEQUAL); // change depth func so depth test passes when val == depth buffer
@@ -96,6 +98,11 @@ void Skybox :: Draw(Shader & shader, glm::mat4 & view, glm::mat4 & projection) {
 	glDepthMask(GL_TRUE);
 }
 
-void Skybox :: LoadTexture(std::vector<std::string> & faces) {
-	tid = LoadCubemap(faces);
+void Skybox :: LoadTexture(std::vector<std::string> & faces, int faceSize) {
+	tid = LoadCubemap(faces, faceSize);
+}
+
+int Skybox :: FaceSizeFor(int viewportHeight, float fovY) {
+	// A face covers 90 degrees, i.e. tan(45) = 1 against tan(fovY / 2) on screen
+	return (int) std::ceil(viewportHeight / std::tan(glm::radians(fovY) * 0.5f));
 }
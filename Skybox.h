@@ -16,7 +16,10 @@ public:
 	Skybox();
 
 	void Draw(Shader & shader, glm::mat4 & view, glm::mat4 & projection);
-	void LoadTexture(std::vector<std::string> & faces);
+	void LoadTexture(std::vector<std::string> & faces, int faceSize = 0);
+
+	// Face resolution that maps one texel to about one pixel at this view
+	static int FaceSizeFor(int viewportHeight, float fovY);
 
 	unsigned int VBO() { return vbo; }
 	unsigned int VAO() { return vao; }
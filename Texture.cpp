@@ -1,4 +1,8 @@
 #include <Texture.h>
+#include <TextureContainer.h>
+#include <ImageProcessing.h>
+#include <MaterialCooker.h>
+#include <ThreadPool.h>
 
 /** Only include this once */
 #define STB_IMAGE_IMPLEMENTATION
@@ -10,8 +14,19 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <cstring>
+#include <thread>
+#include <algorithm>
 #include <unordered_map>
 
+/** S3TC enums are an extension and are not part of the core loader */
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT        0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT       0x83F3
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT       0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
 std::unordered_map<TextureType, std::string> TextureTypeName = {
 	std::pair<TextureType, std::string> (TEX_UNKNOWN,  "texture_unknown"),
 	std::pair<TextureType, std::string> (TEX_DIFFUSE,  "texture_diffuse"),
@@ -19,50 +34,259 @@ std::unordered_map<TextureType, std::string> TextureTypeName = {
 	std::pair<TextureType, std::string> (TEX_NORMAL,   "texture_normal"),
 	std::pair<TextureType, std::string> (TEX_HEIGHT,   "texture_height"),
 	std::pair<TextureType, std::string> (TEX_EMISSION, "texture_emission"),
-	std::pair<TextureType, std::string> (TEX_AMBIENT,  "texture_ambient")
+	std::pair<TextureType, std::string> (TEX_AMBIENT,  "texture_ambient"),
+	std::pair<TextureType, std::string> (TEX_PACKED,   "texture_packed")
 };
 
-unsigned int LoadTexture(const std::string filename, bool gamma) {
+static bool hasExtension(const char * name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i=0; i<count; i++) {
+		const char * ext = (const char *) glGetStringi(GL_EXTENSIONS, i);
+		if (ext && std::strcmp(ext, name) == 0) return true;
+	}
+	return false;
+}
+
+bool IsContainerFormatSupported(int format) {
+	static int s3tc = -1;
+	if (format != ETX_BC1 && format != ETX_BC3)
+		return true; // uncompressed and RGTC are core in GL 3.0
+	if (s3tc < 0)
+		s3tc = hasExtension("GL_EXT_texture_compression_s3tc") ? 1 : 0;
+	return s3tc == 1;
+}
+
+void ContainerGLFormat(int format, bool gamma, unsigned int & imageFormat, unsigned int & dataFormat) {
+	imageFormat = GL_RGBA8;
+	dataFormat = GL_RGBA;
+	switch (format) {
+		case ETX_R8:    imageFormat = GL_R8; dataFormat = GL_RED; break;
+		case ETX_RGB8:  imageFormat = gamma ? GL_SRGB8 : GL_RGB8; dataFormat = GL_RGB; break;
+		case ETX_RGBA8: imageFormat = gamma ? GL_SRGB8_ALPHA8 : GL_RGBA8; dataFormat = GL_RGBA; break;
+		case ETX_BC1:   imageFormat = gamma ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT; break;
+		case ETX_BC3:   imageFormat = gamma ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+		case ETX_BC4:   imageFormat = GL_COMPRESSED_RED_RGTC1; break;
+	}
+}
+
+// Upload levels [firstLevel, end) of a container as levels 0.. of the bound target
+static void uploadLevels(GLenum target, const TextureContainer & container, bool gamma, unsigned int firstLevel) {
+
+	GLenum imageFormat, dataFormat;
+	ContainerGLFormat(container.format, gamma, imageFormat, dataFormat);
+
+	// Levels are tightly packed, RGB rows of small mips are not 4-byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (unsigned int level=firstLevel; level<container.levels.size(); level++) {
+		const TextureLevel & data = container.levels[level];
+		if (IsCompressedFormat(container.format))
+			glCompressedTexImage2D(target, level - firstLevel, imageFormat, data.width, data.height,
+				0, (GLsizei) data.data.size(), data.data.data());
+		else
+			glTexImage2D(target, level - firstLevel, imageFormat, data.width, data.height,
+				0, dataFormat, GL_UNSIGNED_BYTE, data.data.data());
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+unsigned int UploadTextureContainer(const TextureContainer & container, bool gamma) {
 
 	unsigned int textureID{};
 	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
 
-	int width, height, nrComponents;
-	unsigned char * data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-
-	if (!data)
-		std::cerr << "LoadTexture: Texture failed to load at path: " << filename << "\n";
-
-	else {
-		GLenum imageFormat;
-		GLenum dataFormat;
-		if (nrComponents == 1) {
-			imageFormat = GL_RED;
-			dataFormat = GL_RED;
-		} else if (nrComponents == 3) {
-			imageFormat = gamma ? GL_SRGB : GL_RGB;
-			dataFormat = GL_RGB;
-		} else if (nrComponents == 4) {
-			imageFormat = gamma ? GL_SRGB_ALPHA : GL_RGBA;
-			dataFormat = GL_RGBA;
+	uploadLevels(GL_TEXTURE_2D, container, gamma, 0);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint) container.levels.size() - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	return textureID;
+}
+
+MipFilter MipFilterFor(TextureType type) {
+	if (type == TEX_DIFFUSE || type == TEX_AMBIENT || type == TEX_EMISSION)
+		return MIP_SRGB;
+	if (type == TEX_NORMAL)
+		return MIP_NORMAL;
+	return MIP_LINEAR;
+}
+
+/** Texture sources */
+
+TextureSource ImageSource(const std::string & filename, TextureType type) {
+	TextureSource source;
+	source.filename = filename;
+	source.type = type;
+	return source;
+}
+
+TextureSource PackedSource(const PackedMaterial & material) {
+	TextureSource source;
+	source.filename = PackedMaterialPath(material);
+	source.type = TEX_PACKED;
+	source.material = material;
+	return source;
+}
+
+static bool usableContainer(ContainerFormat format, bool compressed) {
+	return compressed || (format != ETX_BC1 && format != ETX_BC3);
+}
+
+bool ReadTextureInfo(const TextureSource & source, bool compressed, TextureInfo & info) {
+
+	// Mirrors LoadTextureSource: a usable baked container wins, otherwise the decoded layout
+	ContainerFormat format;
+	if (ReadTextureContainerInfo(ContainerPath(source.filename), format, info.width, info.height)
+		&& usableContainer(format, compressed)) {
+		info.format = format;
+		return true;
+	}
+
+	int nrComponents;
+	if (source.type == TEX_PACKED) {
+		info.width = info.height = 1;
+		for (const std::string * image : {&source.material.height, &source.material.specular, &source.material.emission}) {
+			int width, height;
+			if (image->empty()) continue;
+			if (!stbi_info(image->c_str(), &width, &height, &nrComponents)) return false;
+			info.width  = std::max(info.width, width);
+			info.height = std::max(info.height, height);
 		}
+		info.format = ETX_RGBA8;
+		return true;
+	}
+
+	if (!stbi_info(source.filename.c_str(), &info.width, &info.height, &nrComponents))
+		return false;
+	info.format = nrComponents == 1 ? ETX_R8 : ETX_RGBA8;
+	return true;
+}
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, imageFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+bool LoadTextureSource(const TextureSource & source, bool compressed, TextureContainer & container) {
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// Prefer a pre-baked mip chain (see TextureBaker) over decoding and filtering here
+	if (ReadTextureContainer(ContainerPath(source.filename), container)
+		&& usableContainer(container.format, compressed)) {
+		if (source.type == TEX_PACKED)
+			BuildHeightPyramid(container);
+		return true;
 	}
 
+	if (source.type == TEX_PACKED)
+		return CookPackedMaterial(source.material, container);
+
+	int width, height, nrComponents;
+	unsigned char * data = stbi_load(source.filename.c_str(), &width, &height, &nrComponents, 0);
+	if (!data) {
+		std::cerr << "LoadTextureSource: Texture failed to load at path: " << source.filename << "\n";
+		return false;
+	}
+
+	// Mips are filtered by the SIMD image kernels rather than glGenerateMipmap
+	BuildMipChain(data, width, height, nrComponents, MipFilterFor(source.type), container);
 	stbi_image_free(data);
+	return true;
+}
+
+unsigned int LoadTexture(const std::string filename, bool gamma, TextureType type) {
+
+	TextureContainer container;
+	if (!LoadTextureSource(ImageSource(filename, type), IsContainerFormatSupported(ETX_BC1), container)) {
+		unsigned int textureID{};
+		glGenTextures(1, &textureID);
+		return textureID;
+	}
+
+	return UploadTextureContainer(container, gamma);
+}
+
+unsigned int LoadPackedMaterial(const PackedMaterial & material) {
+
+	// Cooked offline by TextureBaker -pack, or here on first use
+	TextureContainer container;
+	if (!LoadTextureSource(PackedSource(material), IsContainerFormatSupported(ETX_BC1), container)) {
+		std::cerr << "LoadPackedMaterial: Failed to cook: " << PackedMaterialPath(material) << "\n";
+		unsigned int textureID{};
+		glGenTextures(1, &textureID);
+		return textureID;
+	}
+
+	return UploadTextureContainer(container, false);
+}
+
+bool SameLayout(const TextureContainer & a, const TextureContainer & b) {
+	return a.format == b.format && a.levels.size() == b.levels.size()
+		&& a.levels[0].width == b.levels[0].width && a.levels[0].height == b.levels[0].height;
+}
+
+unsigned int LoadTextureArray(const std::vector<TextureSource> & layers, bool gamma) {
+
+	bool compressed = IsContainerFormatSupported(ETX_BC1);
+
+	std::vector<TextureContainer> images(layers.size());
+	int reference = -1;
+	for (unsigned int i=0; i<layers.size(); i++) {
+		if (!LoadTextureSource(layers[i], compressed, images[i]))
+			continue;
+		if (reference < 0)
+			reference = (int) i;
+		else if (!SameLayout(images[i], images[reference])) {
+			std::cerr << "LoadTextureArray: Layer does not match the first one: " << layers[i].filename << "\n";
+			images[i].levels.clear();
+		}
+	}
+
+	unsigned int textureID{};
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+	if (reference < 0)
+		return textureID;
+
+	const TextureContainer & layout = images[reference];
+	GLenum imageFormat, dataFormat;
+	ContainerGLFormat(layout.format, gamma, imageFormat, dataFormat);
+	bool blocks = IsCompressedFormat(layout.format);
+	GLsizei depth = (GLsizei) layers.size();
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (unsigned int level=0; level<layout.levels.size(); level++) {
+		const TextureLevel & size = layout.levels[level];
+		if (blocks)
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, imageFormat, size.width, size.height, depth,
+				0, (GLsizei) size.data.size() * depth, NULL);
+		else
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, imageFormat, size.width, size.height, depth,
+				0, dataFormat, GL_UNSIGNED_BYTE, NULL);
+
+		for (unsigned int i=0; i<images.size(); i++) {
+			if (images[i].levels.empty()) continue;
+			const TextureLevel & data = images[i].levels[level];
+			if (blocks)
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, i, data.width, data.height, 1,
+					imageFormat, (GLsizei) data.data.size(), data.data.data());
+			else
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, i, data.width, data.height, 1,
+					dataFormat, GL_UNSIGNED_BYTE, data.data.data());
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint) layout.levels.size() - 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 	return textureID;
 }
 
-unsigned int LoadCubemap(const std::vector<std::string> & faces) {
+unsigned int LoadCubemap(const std::vector<std::string> & faces, int faceSize) {
 
 	/**
 	* loads a cubemap texture from 6 individual texture faces
@@ -73,35 +297,61 @@ unsigned int LoadCubemap(const std::vector<std::string> & faces) {
 	* -Y (bottom)
 	* +Z (front) 
 	* -Z (back)
+	*
+	* Faces are decoded and filtered in parallel, or read pre-baked (and possibly
+	* block-compressed) from their ETX containers. Levels larger than needed for
+	* faceSize output pixels are dropped, 0 keeps the full resolution.
 	*/
 
+	std::vector<TextureContainer> images(faces.size());
+	std::vector<char> loaded(faces.size(), 0);
+
+	// Driver capabilities can only be queried here, on the context thread
+	bool compressed = IsContainerFormatSupported(ETX_BC1);
+
+	ThreadPool pool((unsigned int) std::min<size_t>(faces.size(), std::thread::hardware_concurrency()));
+	pool.ParallelFor(0, (int) faces.size(), [&] (int first, int last) {
+		for (int i=first; i<last; i++)
+			loaded[i] = LoadTextureSource(ImageSource(faces[i], TEX_DIFFUSE), compressed, images[i]) ? 1 : 0;
+	});
+
 	unsigned int textureID{};
 	glGenTextures(1, &textureID);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-	int width, height, nrComponents;
-
+	// Faces must agree in size and format, the first one that loaded decides
+	int reference = -1;
 	for (unsigned int i=0; i<faces.size(); i++) {
-
-		unsigned char * data = stbi_load(faces[i].c_str(), &width, &height, &nrComponents, 0);
-
-		if (!data)
+		if (!loaded[i]) {
 			std::cerr << "LoadCubemap: Texture failed to load at path: " << faces[i] << "\n";
-
-		else {
-			GLenum imageFormat;
-			if (nrComponents == 1) imageFormat = GL_RED;
-			else if (nrComponents == 3) imageFormat = GL_RGB;
-			else if (nrComponents == 4) imageFormat = GL_RGBA;
-
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-				0, imageFormat, width, height, 0, imageFormat, GL_UNSIGNED_BYTE, data);
+			continue;
 		}
+		if (reference < 0) {
+			reference = (int) i;
+		} else if (!SameLayout(images[i], images[reference])) {
+			std::cerr << "LoadCubemap: Face does not match the others: " << faces[i] << "\n";
+			loaded[i] = 0;
+		}
+	}
 
-		stbi_image_free(data);
+	unsigned int firstLevel = 0, levels = 1;
+	if (reference >= 0) {
+		const TextureContainer & image = images[reference];
+		levels = (unsigned int) image.levels.size();
+		while (faceSize > 0 && firstLevel + 1 < levels && image.levels[firstLevel + 1].width >= faceSize)
+			firstLevel++;
 	}
 
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	for (unsigned int i=0; i<faces.size(); i++)
+		if (loaded[i])
+			uploadLevels(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, images[i], false, firstLevel);
+
+	// Filter across face edges instead of clamping inside each face
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, (GLint) (levels - firstLevel - 1));
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -126,11 +376,11 @@ Texture defaultUnknownTexture  {0, TEX_UNKNOWN, defaultTextureFilename};
 Texture DefaultTexture(TextureType type) {
 	if (type == defaultDiffuseTexture.type) {
 		if (defaultDiffuseTexture.id == 0)
-			defaultDiffuseTexture.id = LoadTexture(defaultDiffuseTexture.path);
+			defaultDiffuseTexture.id = LoadTexture(defaultDiffuseTexture.path, false, defaultDiffuseTexture.type);
 		return defaultDiffuseTexture;
 	} else if (type == defaultSpecularTexture.type) {
 		if (defaultSpecularTexture.id == 0)
-			defaultSpecularTexture.id = LoadTexture(defaultSpecularTexture.path);
+			defaultSpecularTexture.id = LoadTexture(defaultSpecularTexture.path, false, defaultSpecularTexture.type);
 		return defaultSpecularTexture;
 	} /**else if (type == defaultNormalTexture.type) {
 		if (defaultNormalTexture.id == 0)
@@ -146,7 +396,7 @@ Texture DefaultTexture(TextureType type) {
 		return defaultEmissionTexture;
 	}*/ else {
 		if (defaultUnknownTexture.id == 0)
-			defaultUnknownTexture.id = LoadTexture(defaultUnknownTexture.path);
+			defaultUnknownTexture.id = LoadTexture(defaultUnknownTexture.path, false, defaultUnknownTexture.type);
 		return defaultUnknownTexture;
 	}
 }
@@ -5,6 +5,9 @@
 #include <string>
 #include <unordered_map>
 
+#include <ImageProcessing.h>
+#include <MaterialCooker.h>
+
 enum TextureType {
 	TEX_UNKNOWN,
 	TEX_DIFFUSE,
@@ -12,7 +15,8 @@ enum TextureType {
 	TEX_NORMAL,
 	TEX_HEIGHT,
 	TEX_EMISSION,
-	TEX_AMBIENT
+	TEX_AMBIENT,
+	TEX_PACKED // height, specular and emission cooked into one texture
 };
 
 struct Texture {
@@ -21,12 +25,42 @@ struct Texture {
 	std::string path;
 };
 
+// Where texture data comes from: an image file, or cooked material maps
+struct TextureSource {
+	std::string filename; // the image, or PackedMaterialPath() for TEX_PACKED
+	TextureType type;
+	PackedMaterial material;
+};
+
+// Size and stored format read from headers only, to group sources into arrays
+struct TextureInfo {
+	int width;
+	int height;
+	int format; // ContainerFormat
+};
+
+struct TextureContainer;
+
 extern std::unordered_map<TextureType, std::string> TextureTypeName;
+extern std::string defaultTextureFilename;
 
 /** Methods */
 
-unsigned int LoadTexture(const std::string textureFile, bool gamma = false);
-unsigned int LoadCubemap(const std::vector<std::string> & faces);
+TextureSource ImageSource(const std::string & filename, TextureType type);
+TextureSource PackedSource(const PackedMaterial & material);
+// compressed: whether BC1/BC3 containers may be used; both are safe off the GL thread
+bool ReadTextureInfo(const TextureSource & source, bool compressed, TextureInfo & info);
+bool LoadTextureSource(const TextureSource & source, bool compressed, TextureContainer & container);
+bool SameLayout(const TextureContainer & a, const TextureContainer & b);
+
+unsigned int LoadTexture(const std::string textureFile, bool gamma = false, TextureType type = TEX_UNKNOWN);
+unsigned int LoadTextureArray(const std::vector<TextureSource> & layers, bool gamma = false);
+unsigned int LoadPackedMaterial(const PackedMaterial & material);
+unsigned int UploadTextureContainer(const TextureContainer & container, bool gamma = false);
+bool IsContainerFormatSupported(int format);
+void ContainerGLFormat(int format, bool gamma, unsigned int & imageFormat, unsigned int & dataFormat);
+unsigned int LoadCubemap(const std::vector<std::string> & faces, int faceSize = 0);
 Texture DefaultTexture(TextureType type);
+MipFilter MipFilterFor(TextureType type);
 
 #endif
\ No newline at end of file
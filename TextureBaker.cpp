@@ -0,0 +1,89 @@
+/**
+* Offline converter: decodes images with stb_image and writes an ETX
+* container (see TextureContainer.h) next to each of them, holding a
+* complete mip chain and optionally a block-compressed encoding.
+*
+* Usage:
+*   ./TextureBaker.exe [-srgb | -linear | -normal] [-bc1 | -bc3 | -bc4] image ...
+*   ./TextureBaker.exe -pack height specular emission ...
+*
+*   -srgb    colour image, mips are averaged in linear light (default)
+*   -linear  data image (height, masks), mips are averaged as stored
+*   -normal  tangent-space normal map, every level is renormalised
+*   -bcN     block-compress every level
+*   -pack    cook three scalar maps into one material texture (see
+*            MaterialCooker.h), "-" leaves a channel empty
+*/
+
+#include <TextureContainer.h>
+#include <MaterialCooker.h>
+
+#include <stb_image/stb_image.h>
+
+#include <iostream>
+#include <string>
+#include <cstring>
+
+int main(int argc, char ** argv) {
+
+	MipFilter filter = MIP_SRGB;
+	bool compress = false;
+	ContainerFormat target = ETX_BC1;
+	int baked = 0;
+
+	for (int i=1; i<argc; i++) {
+
+		std::string arg = argv[i];
+		if (arg == "-srgb")   { filter = MIP_SRGB; continue; }
+		if (arg == "-linear") { filter = MIP_LINEAR; continue; }
+		if (arg == "-normal") { filter = MIP_NORMAL; continue; }
+		if (arg == "-bc1")    { compress = true; target = ETX_BC1; continue; }
+		if (arg == "-bc3")    { compress = true; target = ETX_BC3; continue; }
+		if (arg == "-bc4")    { compress = true; target = ETX_BC4; continue; }
+
+		if (arg == "-pack") {
+			if (i + 3 >= argc) {
+				std::cerr << "TextureBaker: -pack needs height, specular and emission maps\n";
+				return 1;
+			}
+			PackedMaterial material;
+			std::string * sources[3] = {&material.height, &material.specular, &material.emission};
+			for (int c=0; c<3; c++) {
+				std::string source = argv[++i];
+				if (source != "-") *sources[c] = source;
+			}
+
+			TextureContainer container;
+			std::string output = ContainerPath(PackedMaterialPath(material));
+			if (CookPackedMaterial(material, container) && WriteTextureContainer(output, container)) {
+				std::cout << "TextureBaker: " << output << "\t" << container.levels[0].width << "x"
+					<< container.levels[0].height << "\t" << container.levels.size() << " levels\n";
+				baked++;
+			}
+			continue;
+		}
+
+		int width, height, nrComponents;
+		unsigned char * data = stbi_load(arg.c_str(), &width, &height, &nrComponents, 0);
+		if (!data) {
+			std::cerr << "TextureBaker: Failed to load: " << arg << "\n";
+			continue;
+		}
+
+		TextureContainer container;
+		BuildMipChain(data, width, height, nrComponents, filter, container);
+		stbi_image_free(data);
+
+		if (compress && !CompressContainer(container, target))
+			std::cerr << "TextureBaker: Compression skipped for: " << arg << "\n";
+
+		std::string output = ContainerPath(arg);
+		if (WriteTextureContainer(output, container)) {
+			std::cout << "TextureBaker: " << output << "\t" << width << "x" << height
+				<< "\t" << container.levels.size() << " levels\n";
+			baked++;
+		}
+	}
+
+	return baked > 0 ? 0 : 1;
+}
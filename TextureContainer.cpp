@@ -0,0 +1,349 @@
+#include <TextureContainer.h>
+#include <ImageProcessing.h>
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+static const char ETX_MAGIC[4] = {'E', 'T', 'X', '1'};
+
+// Limits on what a file may claim before anything is allocated for it
+static const uint32_t ETX_MAX_LEVELS = 32;       // a full chain of a 2^31 texel side
+static const uint32_t ETX_MAX_SIZE = 1u << 16;   // texels per side
+
+std::string ContainerPath(const std::string & imageFile) {
+	// Keep the full image name so that "earth.jpg" and "Earth.jpeg" never collide
+	return imageFile + ".etx";
+}
+
+bool IsCompressedFormat(ContainerFormat format) {
+	return format == ETX_BC1 || format == ETX_BC3 || format == ETX_BC4;
+}
+
+// Payload size of one level, as WriteTextureContainer stores it
+static size_t levelBytes(ContainerFormat format, uint32_t width, uint32_t height) {
+	size_t blocks = (size_t) ((width + 3) / 4) * ((height + 3) / 4);
+	switch (format) {
+	case ETX_R8:    return (size_t) width * height;
+	case ETX_RGB8:  return (size_t) width * height * 3;
+	case ETX_RGBA8: return (size_t) width * height * 4;
+	case ETX_BC3:   return blocks * 16;
+	default:        return blocks * 8; // BC1, BC4
+	}
+}
+
+/** File I/O */
+
+bool ReadTextureContainer(const std::string & filename, TextureContainer & container) {
+
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	char magic[4];
+	uint32_t header[4]; // format, flags, components, levelCount
+	file.read(magic, sizeof(magic));
+	file.read((char*)header, sizeof(header));
+
+	if (!file || std::memcmp(magic, ETX_MAGIC, sizeof(magic)) != 0 || header[0] > ETX_BC4
+		|| header[2] < 1 || header[2] > 4 || header[3] < 1 || header[3] > ETX_MAX_LEVELS) {
+		std::cerr << "ReadTextureContainer: Invalid container: " << filename << "\n";
+		return false;
+	}
+
+	ContainerFormat format = (ContainerFormat) header[0];
+	std::vector<uint32_t> table(3 * header[3]);
+	file.read((char*)table.data(), table.size() * sizeof(uint32_t));
+	std::streampos payload = file.tellg();
+	file.seekg(0, std::ios::end);
+	std::streamoff available = file.tellg() - payload;
+	file.seekg(payload);
+
+	// A full mip chain, largest first, each level exactly as large as its
+	// format needs, and all of it in the file: checked before any allocation
+	size_t total = 0;
+	for (uint32_t i=0; i<header[3]; i++) {
+		uint32_t width = table[3 * i + 0], height = table[3 * i + 1];
+		bool sized = i == 0
+			? width >= 1 && height >= 1 && width <= ETX_MAX_SIZE && height <= ETX_MAX_SIZE
+			: width == std::max(1u, table[3 * i - 3] / 2) && height == std::max(1u, table[3 * i - 2] / 2);
+		if (!file || !sized || table[3 * i + 2] != levelBytes(format, width, height)) {
+			std::cerr << "ReadTextureContainer: Invalid level " << i << " in container: " << filename << "\n";
+			return false;
+		}
+		total += table[3 * i + 2];
+	}
+	if (available < 0 || (size_t) available < total) {
+		std::cerr << "ReadTextureContainer: Truncated container: " << filename << "\n";
+		return false;
+	}
+
+	container.format = format;
+	container.srgb = (header[1] & 1u) != 0;
+	container.components = (int) header[2];
+	container.levels.resize(header[3]);
+
+	for (unsigned int i=0; i<container.levels.size(); i++) {
+		TextureLevel & level = container.levels[i];
+		level.width  = (int) table[3 * i + 0];
+		level.height = (int) table[3 * i + 1];
+		level.data.resize(table[3 * i + 2]);
+		file.read((char*)level.data.data(), level.data.size());
+	}
+
+	if (!file) {
+		std::cerr << "ReadTextureContainer: Truncated container: " << filename << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool ReadTextureContainerInfo(const std::string & filename, ContainerFormat & format, int & width, int & height) {
+
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	// Header and the first level table entry only, no payload
+	char magic[4];
+	uint32_t header[4];
+	uint32_t entry[3];
+	file.read(magic, sizeof(magic));
+	file.read((char*)header, sizeof(header));
+	file.read((char*)entry, sizeof(entry));
+
+	if (!file || std::memcmp(magic, ETX_MAGIC, sizeof(magic)) != 0 || header[0] > ETX_BC4
+		|| header[3] < 1 || header[3] > ETX_MAX_LEVELS
+		|| entry[0] < 1 || entry[1] < 1 || entry[0] > ETX_MAX_SIZE || entry[1] > ETX_MAX_SIZE)
+		return false;
+
+	format = (ContainerFormat) header[0];
+	width  = (int) entry[0];
+	height = (int) entry[1];
+	return true;
+}
+
+bool WriteTextureContainer(const std::string & filename, const TextureContainer & container) {
+
+	std::ofstream file(filename, std::ios::out | std::ios::binary);
+	if (!file.is_open()) {
+		std::cerr << "WriteTextureContainer: Unable to open: " << filename << "\n";
+		return false;
+	}
+
+	uint32_t header[4] = {
+		(uint32_t) container.format,
+		container.srgb ? 1u : 0u,
+		(uint32_t) container.components,
+		(uint32_t) container.levels.size()
+	};
+	file.write(ETX_MAGIC, sizeof(ETX_MAGIC));
+	file.write((const char*)header, sizeof(header));
+
+	for (const TextureLevel & level : container.levels) {
+		uint32_t entry[3] = {
+			(uint32_t) level.width, (uint32_t) level.height, (uint32_t) level.data.size() };
+		file.write((const char*)entry, sizeof(entry));
+	}
+
+	for (const TextureLevel & level : container.levels)
+		file.write((const char*)level.data.data(), level.data.size());
+
+	return (bool) file;
+}
+
+/** Mip generation */
+
+void BuildMipChain(
+	const unsigned char * data, int width, int height, int components,
+	MipFilter filter, TextureContainer & container) {
+
+	// Everything but single channel images is widened to RGBA: rows stay 4-byte
+	// aligned and the SIMD kernels only need the 1 and 4 channel layouts
+	int stored = components == 1 ? 1 : 4;
+
+	container.format = stored == 1 ? ETX_R8 : ETX_RGBA8;
+	container.srgb = filter == MIP_SRGB;
+	container.components = components;
+	container.levels.clear();
+
+	TextureLevel base;
+	base.width = width;
+	base.height = height;
+	base.data.resize((size_t) width * height * stored);
+	if (components == stored) {
+		std::memcpy(base.data.data(), data, base.data.size());
+	} else if (components == 3) {
+		ExpandRGBToRGBA(data, base.data.data(), (size_t) width * height);
+	} else {
+		for (size_t i=0; i<(size_t) width * height; i++) {
+			base.data[4 * i + 0] = data[2 * i];
+			base.data[4 * i + 1] = data[2 * i];
+			base.data[4 * i + 2] = data[2 * i];
+			base.data[4 * i + 3] = data[2 * i + 1];
+		}
+	}
+	if (filter == MIP_NORMAL && stored == 4)
+		RenormalizeNormals(base.data.data(), (size_t) width * height, stored);
+	container.levels.push_back(std::move(base));
+
+	while (container.levels.back().width > 1 || container.levels.back().height > 1) {
+		const TextureLevel & prev = container.levels.back();
+		TextureLevel next;
+		next.width  = std::max(1, prev.width  / 2);
+		next.height = std::max(1, prev.height / 2);
+		next.data.resize((size_t) next.width * next.height * stored);
+		DownsampleImage(prev.data.data(), prev.width, prev.height, stored,
+			filter == MIP_SRGB, next.data.data());
+		if (filter == MIP_NORMAL && stored == 4)
+			RenormalizeNormals(next.data.data(), (size_t) next.width * next.height, stored);
+		container.levels.push_back(std::move(next));
+	}
+}
+
+/** Block compression */
+
+static uint16_t to565(const float c[3]) {
+	int r = (int) (c[0] * 31.0f / 255.0f + 0.5f);
+	int g = (int) (c[1] * 63.0f / 255.0f + 0.5f);
+	int b = (int) (c[2] * 31.0f / 255.0f + 0.5f);
+	return (uint16_t) ((r << 11) | (g << 5) | b);
+}
+
+static void from565(uint16_t v, int c[3]) {
+	int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+	c[0] = (r << 3) | (r >> 2);
+	c[1] = (g << 2) | (g >> 4);
+	c[2] = (b << 3) | (b >> 2);
+}
+
+// Gather a 4x4 block as RGBA, replicating edge texels for partial blocks
+static void fetchBlock(const TextureLevel & level, int stored, int bx, int by, unsigned char block[16][4]) {
+	for (int y=0; y<4; y++) {
+		int sy = std::min(by * 4 + y, level.height - 1);
+		for (int x=0; x<4; x++) {
+			int sx = std::min(bx * 4 + x, level.width - 1);
+			const unsigned char * p = &level.data[((size_t) sy * level.width + sx) * stored];
+			unsigned char * q = block[4 * y + x];
+			if (stored == 1) { q[0] = q[1] = q[2] = p[0]; q[3] = 255; }
+			else { q[0] = p[0]; q[1] = p[1]; q[2] = p[2]; q[3] = stored == 4 ? p[3] : 255; }
+		}
+	}
+}
+
+static void encodeColorBlock(unsigned char block[16][4], unsigned char out[8]) {
+
+	// Bounding box of the block, with the diagonal chosen from the covariance sign
+	float lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0}, mean[3] = {0, 0, 0};
+	for (int i=0; i<16; i++)
+		for (int c=0; c<3; c++) {
+			lo[c] = std::min(lo[c], (float) block[i][c]);
+			hi[c] = std::max(hi[c], (float) block[i][c]);
+			mean[c] += block[i][c] / 16.0f;
+		}
+	float covRG = 0.0f, covRB = 0.0f;
+	for (int i=0; i<16; i++) {
+		covRG += (block[i][0] - mean[0]) * (block[i][1] - mean[1]);
+		covRB += (block[i][0] - mean[0]) * (block[i][2] - mean[2]);
+	}
+	if (covRG < 0.0f) std::swap(lo[1], hi[1]);
+	if (covRB < 0.0f) std::swap(lo[2], hi[2]);
+
+	// Inset the box slightly to reduce the error of the endpoints
+	for (int c=0; c<3; c++) {
+		float inset = (hi[c] - lo[c]) / 16.0f;
+		hi[c] -= inset;
+		lo[c] += inset;
+	}
+
+	uint16_t c0 = to565(hi), c1 = to565(lo);
+	if (c0 < c1) std::swap(c0, c1);
+
+	uint32_t indices = 0;
+	if (c0 != c1) {
+		int p[4][3];
+		from565(c0, p[0]);
+		from565(c1, p[1]);
+		for (int c=0; c<3; c++) {
+			p[2][c] = (2 * p[0][c] + p[1][c]) / 3;
+			p[3][c] = (p[0][c] + 2 * p[1][c]) / 3;
+		}
+		for (int i=0; i<16; i++) {
+			int best = 0, bestDist = 1 << 30;
+			for (int k=0; k<4; k++) {
+				int dr = block[i][0] - p[k][0], dg = block[i][1] - p[k][1], db = block[i][2] - p[k][2];
+				int dist = dr * dr + dg * dg + db * db;
+				if (dist < bestDist) { bestDist = dist; best = k; }
+			}
+			indices |= (uint32_t) best << (2 * i);
+		}
+	}
+
+	out[0] = c0 & 0xff; out[1] = c0 >> 8;
+	out[2] = c1 & 0xff; out[3] = c1 >> 8;
+	for (int i=0; i<4; i++) out[4 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+static void encodeScalarBlock(unsigned char block[16][4], int channel, unsigned char out[8]) {
+
+	int a0 = 0, a1 = 255;
+	for (int i=0; i<16; i++) {
+		a0 = std::max(a0, (int) block[i][channel]);
+		a1 = std::min(a1, (int) block[i][channel]);
+	}
+
+	uint64_t bits = 0;
+	if (a0 != a1) {
+		for (int i=0; i<16; i++) {
+			// Position along the a0 -> a1 ramp, then remap to the BC4 palette order
+			int t = ((a0 - block[i][channel]) * 7 + (a0 - a1) / 2) / (a0 - a1);
+			uint64_t index = t == 0 ? 0 : (t == 7 ? 1 : t + 1);
+			bits |= index << (3 * i);
+		}
+	}
+
+	out[0] = (unsigned char) a0;
+	out[1] = (unsigned char) a1;
+	for (int i=0; i<6; i++) out[2 + i] = (bits >> (8 * i)) & 0xff;
+}
+
+bool CompressContainer(TextureContainer & container, ContainerFormat target) {
+
+	if (IsCompressedFormat(container.format) || !IsCompressedFormat(target))
+		return false;
+
+	int stored = container.format == ETX_R8 ? 1 : (container.format == ETX_RGB8 ? 3 : 4);
+	int blockBytes = target == ETX_BC3 ? 16 : 8;
+
+	for (TextureLevel & level : container.levels) {
+		int blocksX = (level.width + 3) / 4;
+		int blocksY = (level.height + 3) / 4;
+		std::vector<unsigned char> packed((size_t) blocksX * blocksY * blockBytes);
+
+		for (int by=0; by<blocksY; by++)
+			for (int bx=0; bx<blocksX; bx++) {
+				unsigned char block[16][4];
+				fetchBlock(level, stored, bx, by, block);
+				unsigned char * out = &packed[((size_t) by * blocksX + bx) * blockBytes];
+				if (target == ETX_BC1) {
+					encodeColorBlock(block, out);
+				} else if (target == ETX_BC3) {
+					encodeScalarBlock(block, 3, out);
+					encodeColorBlock(block, out + 8);
+				} else {
+					encodeScalarBlock(block, 0, out);
+				}
+			}
+
+		level.data.swap(packed);
+	}
+
+	container.format = target;
+	return true;
+}
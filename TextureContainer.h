@@ -0,0 +1,61 @@
+#ifndef TEXTURE_CONTAINER_H
+#define TEXTURE_CONTAINER_H
+
+#include <vector>
+#include <string>
+
+#include <ImageProcessing.h>
+
+/**
+* ETX container: a small DDS/KTX-style file carrying a complete,
+* pre-filtered mip chain so that textures can be uploaded level by level
+* instead of running glGenerateMipmap at load time.
+*
+* Layout (little endian):
+*   "ETX1" | format | flags | components | levelCount
+*   levelCount x { width | height | byteSize }
+*   level payloads, largest first
+*/
+
+enum ContainerFormat {
+	ETX_R8,    // 1 byte per texel
+	ETX_RGB8,  // 3 bytes per texel, rows tightly packed
+	ETX_RGBA8, // 4 bytes per texel
+	ETX_BC1,   // S3TC DXT1, 8 bytes per 4x4 block
+	ETX_BC3,   // S3TC DXT5, 16 bytes per 4x4 block
+	ETX_BC4    // RGTC1, 8 bytes per 4x4 block
+};
+
+struct TextureLevel {
+	int width;
+	int height;
+	std::vector<unsigned char> data;
+};
+
+struct TextureContainer {
+	ContainerFormat format;
+	bool srgb; // colour data, mips were filtered in linear light
+	int components; // channel count of the source image
+	std::vector<TextureLevel> levels;
+};
+
+/** Methods */
+
+std::string ContainerPath(const std::string & imageFile);
+
+bool ReadTextureContainer(const std::string & filename, TextureContainer & container);
+bool ReadTextureContainerInfo(const std::string & filename, ContainerFormat & format, int & width, int & height);
+bool WriteTextureContainer(const std::string & filename, const TextureContainer & container);
+
+bool IsCompressedFormat(ContainerFormat format);
+
+// Build a full mip chain (down to 1x1) from 8-bit image data; RGB and
+// grey-alpha inputs are stored as RGBA
+void BuildMipChain(
+	const unsigned char * data, int width, int height, int components,
+	MipFilter filter, TextureContainer & container);
+
+// Re-encode every level of an uncompressed container into a block format
+bool CompressContainer(TextureContainer & container, ContainerFormat target);
+
+#endif
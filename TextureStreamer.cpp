@@ -0,0 +1,315 @@
+#include <TextureStreamer.h>
+#include <TextureContainer.h>
+#include <Texture.h>
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <cstring>
+#include <algorithm>
+
+TextureStreamer :: TextureStreamer(
+		unsigned int workers,
+		unsigned int bufferCount,
+		unsigned int bufferSize)
+	: pool(workers), bufferSize(bufferSize), pending(0)
+{
+	buffers.resize(bufferCount);
+	for (Staging & staging : buffers) {
+		glGenBuffers(1, &staging.pbo);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.pbo);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, bufferSize, NULL, GL_STREAM_DRAW);
+		staging.fence = 0;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureStreamer :: ~TextureStreamer() {
+	// Workers touch the queues below, let them drain before anything is torn down
+	pool.Wait();
+	for (Staging & staging : buffers) {
+		if (staging.fence) glDeleteSync(staging.fence);
+		glDeleteBuffers(1, &staging.pbo);
+	}
+}
+
+unsigned int TextureStreamer :: Request(const std::string & filename, TextureType type, bool gamma) {
+	return Request(ImageSource(filename, type), gamma);
+}
+
+unsigned int TextureStreamer :: Request(const TextureSource & source, bool gamma) {
+
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->target = GL_TEXTURE_2D;
+	job->gamma = gamma;
+	job->sources.push_back(source);
+	return submit(job);
+}
+
+unsigned int TextureStreamer :: RequestArray(const std::vector<TextureSource> & layers, bool gamma) {
+
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->target = GL_TEXTURE_2D_ARRAY;
+	job->gamma = gamma;
+	job->sources = layers;
+	return submit(job);
+}
+
+unsigned int TextureStreamer :: submit(std::shared_ptr<Job> job) {
+
+	unsigned int layers = (unsigned int) job->sources.size();
+	job->images.resize(layers);
+	job->remaining = layers;
+	job->level = 0;
+	job->layer = 0;
+	job->row = 0;
+
+	// 1x1 placeholder, neutral for the way each map is used in object.frag
+	TextureType type = job->sources.front().type;
+	unsigned char color[4] = {128, 128, 128, 255};
+	if (type == TEX_NORMAL) { color[0] = 128; color[1] = 128; color[2] = 255; }
+	else if (type == TEX_HEIGHT || type == TEX_EMISSION || type == TEX_SPECULAR || type == TEX_PACKED)
+		color[0] = color[1] = color[2] = 0;
+	std::vector<unsigned char> placeholder(4 * layers);
+	for (unsigned int i=0; i<4 * layers; i++)
+		placeholder[i] = color[i % 4];
+
+	glGenTextures(1, &job->id);
+	glBindTexture(job->target, job->id);
+	if (job->target == GL_TEXTURE_2D_ARRAY)
+		glTexImage3D(job->target, 0, GL_RGBA8, 1, 1, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder.data());
+	else
+		glTexImage2D(job->target, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder.data());
+	glTexParameteri(job->target, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexParameteri(job->target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(job->target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(job->target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(job->target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// Driver capabilities can only be queried here, on the context thread
+	bool compressed = IsContainerFormatSupported(ETX_BC1);
+
+	// One task per layer, the last one to finish hands the job over
+	pending++;
+	for (unsigned int i=0; i<layers; i++)
+		pool.Submit([this, job, i, compressed] {
+			if (!LoadTextureSource(job->sources[i], compressed, job->images[i]))
+				job->images[i].levels.clear();
+			if (--job->remaining == 0) {
+				std::lock_guard<std::mutex> lock(mutex);
+				decoded.push_back(job);
+			}
+		});
+
+	return job->id;
+}
+
+bool TextureStreamer :: validate(Job & job) {
+
+	// Layers that failed or do not match the first good one keep the placeholder colour
+	int reference = -1;
+	for (unsigned int i=0; i<job.images.size(); i++) {
+		if (job.images[i].levels.empty())
+			continue;
+		if (reference < 0)
+			reference = (int) i;
+		else if (!SameLayout(job.images[i], job.images[reference])) {
+			std::cerr << "TextureStreamer: Layer does not match the first one: " << job.sources[i].filename << "\n";
+			job.images[i].levels.clear();
+		}
+	}
+	if (reference < 0)
+		return false;
+
+	// Stand-ins share the layout so every layer can be copied the same way
+	for (TextureContainer & image : job.images) {
+		if (!image.levels.empty())
+			continue;
+		image = job.images[reference];
+		for (TextureLevel & level : image.levels)
+			std::fill(level.data.begin(), level.data.end(), 0);
+	}
+	return true;
+}
+
+static size_t levelBytes(ContainerFormat format, int width, int height) {
+	if (IsCompressedFormat(format))
+		return (size_t) ((width + 3) / 4) * ((height + 3) / 4) * (format == ETX_BC3 ? 16 : 8);
+	return (size_t) width * height * (format == ETX_R8 ? 1 : (format == ETX_RGB8 ? 3 : 4));
+}
+
+void TextureStreamer :: allocate(Job & job) {
+
+	const TextureContainer & image = job.images.front();
+	const TextureLevel & base = image.levels.front();
+	bool compressed = IsCompressedFormat(image.format);
+	GLsizei layers = (GLsizei) job.images.size();
+
+	GLenum imageFormat, dataFormat;
+	ContainerGLFormat(image.format, job.gamma, imageFormat, dataFormat);
+
+	unsigned int levels = (unsigned int) image.levels.size();
+
+	// The smallest level of every layer, gathered for the storage call
+	std::vector<unsigned char> tail;
+	for (const TextureContainer & layer : job.images)
+		tail.insert(tail.end(), layer.levels.back().data.begin(), layer.levels.back().data.end());
+
+	// Storage for the whole chain; the smallest level doubles as the placeholder
+	glBindTexture(job.target, job.id);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (unsigned int level=0; level<levels; level++) {
+		int w = std::max(1, base.width >> level);
+		int h = std::max(1, base.height >> level);
+		const void * data = level + 1 == levels ? tail.data() : NULL;
+		GLsizei bytes = (GLsizei) (levelBytes(image.format, w, h) * layers);
+		if (job.target == GL_TEXTURE_2D_ARRAY) {
+			if (compressed)
+				glCompressedTexImage3D(job.target, level, imageFormat, w, h, layers, 0, bytes, data);
+			else
+				glTexImage3D(job.target, level, imageFormat, w, h, layers, 0, dataFormat, GL_UNSIGNED_BYTE, data);
+		} else {
+			if (compressed)
+				glCompressedTexImage2D(job.target, level, imageFormat, w, h, 0, bytes, data);
+			else
+				glTexImage2D(job.target, level, imageFormat, w, h, 0, dataFormat, GL_UNSIGNED_BYTE, data);
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// Keep sampling the placeholder until the full chain has landed
+	glTexParameteri(job.target, GL_TEXTURE_BASE_LEVEL, levels - 1);
+	glTexParameteri(job.target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glTexParameteri(job.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+	job.level = 0;
+	job.layer = 0;
+	job.row = 0;
+}
+
+bool TextureStreamer :: upload(Job & job, Staging & staging, unsigned int & budget) {
+
+	const TextureContainer & image = job.images[job.layer];
+	const TextureLevel & level = image.levels[job.level];
+	bool compressed = IsCompressedFormat(image.format);
+
+	GLenum imageFormat, dataFormat;
+	ContainerGLFormat(image.format, job.gamma, imageFormat, dataFormat);
+
+	// Compressed levels are copied in rows of 4x4 blocks
+	size_t rowBytes = levelBytes(image.format, level.width, compressed ? 4 : 1);
+	int rowCount = compressed ? (level.height + 3) / 4 : level.height;
+	int rows = (int) std::min<size_t>(rowCount - job.row,
+		std::max<size_t>(1, std::min<size_t>(budget, bufferSize) / rowBytes));
+	size_t bytes = rows * rowBytes;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.pbo);
+	if (bytes > bufferSize) // a single row of a very wide texture
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+	void * dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	std::memcpy(dst, &level.data[job.row * rowBytes], bytes);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	int y = compressed ? job.row * 4 : job.row;
+	int h = compressed ? std::min(rows * 4, level.height - y) : rows;
+
+	glBindTexture(job.target, job.id);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (job.target == GL_TEXTURE_2D_ARRAY) {
+		if (compressed)
+			glCompressedTexSubImage3D(job.target, job.level, 0, y, job.layer, level.width, h, 1,
+				imageFormat, (GLsizei) bytes, NULL);
+		else
+			glTexSubImage3D(job.target, job.level, 0, y, job.layer, level.width, h, 1,
+				dataFormat, GL_UNSIGNED_BYTE, NULL);
+	} else {
+		if (compressed)
+			glCompressedTexSubImage2D(job.target, job.level, 0, y, level.width, h,
+				imageFormat, (GLsizei) bytes, NULL);
+		else
+			glTexSubImage2D(job.target, job.level, 0, y, level.width, h,
+				dataFormat, GL_UNSIGNED_BYTE, NULL);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	staging.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	budget -= (unsigned int) std::min<size_t>(budget, bytes);
+
+	// Rows, then layers, then levels
+	job.row += rows;
+	if (job.row == rowCount) {
+		job.row = 0;
+		if (++job.layer == job.images.size()) {
+			job.layer = 0;
+			job.level++;
+		}
+	}
+
+	// The 1x1 tail was uploaded along with the storage
+	return job.level + 1 >= image.levels.size();
+}
+
+void TextureStreamer :: finish(Job & job) {
+
+	glBindTexture(job.target, job.id);
+	glTexParameteri(job.target, GL_TEXTURE_BASE_LEVEL, 0);
+
+	for (const TextureSource & source : job.sources)
+		std::cout << "TextureStreamer: " << job.id << "\tcompleted: " << source.filename << "\n";
+
+	// Release the CPU copies
+	std::vector<TextureContainer>().swap(job.images);
+}
+
+void TextureStreamer :: Update(unsigned int byteBudget) {
+
+	// Retire copies the GPU has consumed
+	for (Staging & staging : buffers) {
+		if (!staging.fence)
+			continue;
+		GLenum status = glClientWaitSync(staging.fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			continue;
+		glDeleteSync(staging.fence);
+		staging.fence = 0;
+		if (staging.job) {
+			finish(*staging.job);
+			staging.job.reset();
+			pending--;
+		}
+	}
+
+	// Pick up freshly decoded images
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		while (!decoded.empty()) {
+			std::shared_ptr<Job> job = decoded.front();
+			decoded.pop_front();
+			if (!validate(*job)) {
+				pending--; // failed to decode, the placeholder stays
+				continue;
+			}
+			allocate(*job);
+			uploading.push_back(job);
+		}
+	}
+
+	// Copy as much as the budget and the free staging buffers allow
+	for (Staging & staging : buffers) {
+		if (staging.fence)
+			continue;
+		if (uploading.empty() || byteBudget == 0)
+			break;
+		std::shared_ptr<Job> job = uploading.front();
+		if (upload(*job, staging, byteBudget)) {
+			staging.job = job;
+			uploading.pop_front();
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+#include <glad/glad.h>
+
+#include <Texture.h>
+#include <TextureContainer.h>
+#include <ThreadPool.h>
+
+/**
+* Asynchronous texture loading. Request() hands back a texture name right
+* away that samples a 1x1 placeholder; images are decoded on worker threads
+* and copied through a pool of pixel-unpack buffers by Update(), which is
+* called once per frame on the render thread under a byte budget. Fences
+* tell when a buffer may be refilled and when a texture is complete, at
+* which point its full mip range is enabled. RequestArray() does the same
+* for a 2D array, one source per layer.
+*/
+class TextureStreamer {
+
+public:
+	/** Methods */
+	TextureStreamer(
+		unsigned int workers = 2,
+		unsigned int bufferCount = 4,
+		unsigned int bufferSize = 4 << 20);
+	~TextureStreamer();
+
+	unsigned int Request(const std::string & filename, TextureType type, bool gamma = false);
+	unsigned int Request(const TextureSource & source, bool gamma = false);
+	unsigned int RequestArray(const std::vector<TextureSource> & layers, bool gamma = false);
+	void Update(unsigned int byteBudget = 8 << 20);
+
+	unsigned int Pending() const { return pending; }
+	bool Idle() const { return pending == 0; }
+
+private:
+	struct Job {
+		unsigned int id;
+		GLenum target; // GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+		bool gamma;
+		std::vector<TextureSource> sources;
+		std::vector<TextureContainer> images; // full mip chain per layer, baked or filtered by a worker
+		std::atomic<unsigned int> remaining; // layers still decoding
+		unsigned int level; // upload cursor
+		unsigned int layer;
+		int row;
+	};
+
+	struct Staging {
+		GLuint pbo;
+		GLsync fence;
+		std::shared_ptr<Job> job; // set when this copy finishes its texture
+	};
+
+	/** Streamer Data */
+	ThreadPool pool;
+	std::vector<Staging> buffers;
+	unsigned int bufferSize;
+	unsigned int pending;
+
+	std::mutex mutex;
+	std::deque<std::shared_ptr<Job> > decoded; // filled by workers
+	std::deque<std::shared_ptr<Job> > uploading; // render thread only
+
+	/** Methods */
+	unsigned int submit(std::shared_ptr<Job> job);
+	bool validate(Job & job);
+	void allocate(Job & job);
+	bool upload(Job & job, Staging & staging, unsigned int & budget);
+	void finish(Job & job);
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include <ThreadPool.h>
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool :: ThreadPool(unsigned int threads)
+	: busy(0), stopping(false)
+{
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned int i=0; i<threads; i++)
+		workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool :: ~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeup.notify_all();
+	for (std::thread & worker : workers)
+		worker.join();
+}
+
+void ThreadPool :: Submit(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	wakeup.notify_one();
+}
+
+void ThreadPool :: Wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+	drained.wait(lock, [this] { return tasks.empty() && busy == 0; });
+}
+
+void ThreadPool :: ParallelFor(int begin, int end,
+	const std::function<void(int, int)> & body, int grain) {
+
+	if (end <= begin)
+		return;
+
+	int chunks = std::min((end - begin + grain - 1) / std::max(1, grain), (int) Size() * 4);
+	if (chunks <= 1) {
+		body(begin, end);
+		return;
+	}
+
+	struct Range {
+		std::atomic<int> next;
+		std::atomic<int> done;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+	std::shared_ptr<Range> range = std::make_shared<Range>();
+	range->next = 0;
+	range->done = 0;
+
+	int span = (end - begin + chunks - 1) / chunks;
+
+	// Helpers that start after every chunk is claimed return without touching body
+	auto run = [range, chunks, span, begin, end, &body] () {
+		int chunk;
+		while ((chunk = range->next++) < chunks) {
+			int first = begin + chunk * span;
+			int last = std::min(end, first + span);
+			if (first < last)
+				body(first, last);
+			if (++range->done == chunks) {
+				std::lock_guard<std::mutex> lock(range->mutex);
+				range->finished.notify_all();
+			}
+		}
+	};
+
+	for (int i=0; i<std::min((int) Size(), chunks - 1); i++)
+		Submit(run);
+	run();
+
+	std::unique_lock<std::mutex> lock(range->mutex);
+	range->finished.wait(lock, [&range, chunks] { return range->done == chunks; });
+}
+
+void ThreadPool :: work() {
+
+	for (;;) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeup.wait(lock, [this] { return stopping || !tasks.empty(); });
+			if (stopping && tasks.empty())
+				return;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+			busy++;
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busy--;
+			if (tasks.empty() && busy == 0)
+				drained.notify_all();
+		}
+	}
+}
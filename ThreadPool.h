@@ -0,0 +1,42 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class ThreadPool {
+
+public:
+	/** Methods */
+	ThreadPool(unsigned int threads = 0); // 0: one worker per hardware thread
+	~ThreadPool();
+
+	void Submit(std::function<void()> task);
+	void Wait(); // block until every submitted task has finished
+
+	// Split [begin, end) into chunks of at least grain items; the caller takes part,
+	// so this is safe to call from inside a task of the same pool
+	void ParallelFor(int begin, int end,
+		const std::function<void(int, int)> & body, int grain = 1);
+
+	unsigned int Size() const { return (unsigned int) workers.size(); }
+
+private:
+	/** Pool Data */
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()> > tasks;
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	std::condition_variable drained;
+	unsigned int busy;
+	bool stopping;
+
+	/** Methods */
+	void work();
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include <TrailRenderer.h>
+
+TrailRenderer :: TrailRenderer(int trails, int length, int firstTrack)
+	: trails(trails), length(length), firstTrack(firstTrack < 0 ? trails : firstTrack), newest(-1), filled(0),
+	vao(0), buffer(0), texture(0), firsts(trails), counts(trails)
+{
+	// No attributes, but core profiles draw with a vertex array bound
+	glGenVertexArrays(1, &vao);
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr) trails * length * 4 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+	for (int t=0; t<trails; t++)
+		firsts[t] = t * length;
+}
+
+TrailRenderer :: ~TrailRenderer() {
+	glDeleteTextures(1, &texture);
+	glDeleteBuffers(1, &buffer);
+	glDeleteVertexArrays(1, &vao);
+}
+
+void TrailRenderer :: Append(const float * row) {
+
+	newest = (newest + 1) % length;
+	filled = filled < length ? filled + 1 : length;
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferSubData(GL_TEXTURE_BUFFER, (GLintptr) newest * trails * 4 * sizeof(float),
+		(GLsizeiptr) trails * 4 * sizeof(float), row);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void TrailRenderer :: Clear() {
+	newest = -1;
+	filled = 0;
+}
+
+void TrailRenderer :: Draw(Shader & shader) {
+
+	if (filled < 2)
+		return;
+	glActiveTexture(GL_TEXTURE0 + UNIT_SAMPLES);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glActiveTexture(GL_TEXTURE0);
+
+	shader.setUniform("uSamples", (int) UNIT_SAMPLES);
+	shader.setUniform("uTrails", trails);
+	shader.setUniform("uLength", length);
+	shader.setUniform("uNewest", newest);
+	shader.setUniform("uFilled", filled);
+	shader.setUniform("uFirstTrack", firstTrack);
+
+	for (int t=0; t<trails; t++)
+		counts[t] = filled;
+	glBindVertexArray(vao);
+	glMultiDrawArrays(GL_LINE_STRIP, firsts.data(), counts.data(), trails);
+	glBindVertexArray(0);
+}
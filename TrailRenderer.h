@@ -0,0 +1,60 @@
+#ifndef TRAIL_RENDERER_H
+#define TRAIL_RENDERER_H
+
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <ShaderProgram.h>
+
+/**
+* Trails of many bodies sampled together, kept in a ring buffer on the GPU.
+* Append() writes one row, a sample of every trail, over the oldest with a
+* single glBufferSubData; nothing already uploaded is written again.
+*
+* The buffer is read as a buffer texture by shaders/trail.vert, which has no
+* vertex attributes: a vertex's trail and age follow from gl_VertexID, so
+* each trail is one range of one glMultiDrawArrays however the ring has
+* wrapped, drawn oldest to newest and fading with age.
+*
+*   uSamples  RGBA32F, row after row, a texel per trail: xyz in the trail's
+*             frame, w 0 where there is no sample (the strip breaks there)
+*
+* Trails from FirstTrack() on are drawn with uTrackToWorld instead of
+* uTrailToWorld, so orbits and the ground tracks under them, in different
+* frames, still share the buffer and the draw.
+*/
+
+class TrailRenderer {
+
+public:
+	// Buffer texture unit, past the fixed ones (see LightClusters.h)
+	static const GLuint UNIT_SAMPLES = 16;
+
+	/** Methods */
+	TrailRenderer(int trails, int length, int firstTrack = -1); // -1: no ground tracks
+	~TrailRenderer();
+
+	void Append(const float * row); // four floats per trail
+	void Clear();                   // the next Append() starts every trail afresh
+
+	int Trails() const { return trails; }
+	int Length() const { return length; }
+	int Filled() const { return filled; }
+	int FirstTrack() const { return firstTrack; }
+
+	// Binds the samples and sets their uniforms; the caller sets the
+	// transforms and colours (see shaders/trail.vert)
+	void Draw(Shader & shader);
+
+private:
+	int trails, length, firstTrack;
+	int newest, filled; // row of the last sample, rows with samples
+
+	/** GL Data */
+	GLuint vao, buffer, texture;
+	std::vector<GLint> firsts;
+	std::vector<GLsizei> counts;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+/**
+* Lock-free hand-over of whole values from one producer thread to one
+* consumer thread. The producer fills Back() and publishes it; the consumer
+* picks up the newest published value with Update() and reads it through
+* Front() for as long as it likes. Neither side ever waits: the third slot
+* sits between them, and a value published twice before the consumer looks
+* simply replaces the older one.
+*
+* Slots are reused, so a producer that rebuilds vectors in Back() keeps
+* their capacity from two publications ago.
+*/
+
+template <typename T>
+class TripleBuffer {
+
+public:
+	/** Methods */
+	TripleBuffer() : middle(1), back(0), front(2) {}
+
+	// Producer side
+	T & Back() { return slots[back]; }
+	void Publish() {
+		// release: the slot's contents before the index; acquire: the consumer is done with what comes back
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	// Consumer side, returns whether Front() changed
+	bool Update() {
+		if (!(middle.load(std::memory_order_relaxed) & FRESH))
+			return false;
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+		return true;
+	}
+	const T & Front() const { return slots[front]; }
+
+private:
+	static const unsigned int INDEX = 3;
+	static const unsigned int FRESH = 4; // published and not yet taken
+
+	/** Buffer Data */
+	T slots[3];
+	std::atomic<unsigned int> middle; // index of the shared slot | FRESH
+	unsigned int back;  // producer only
+	unsigned int front; // consumer only
+
+	TripleBuffer(const TripleBuffer &);
+	TripleBuffer & operator=(const TripleBuffer &);
+};
+
+#endif
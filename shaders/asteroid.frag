@@ -0,0 +1,14 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in float Alpha;
+
+void main() {
+
+	// Round sprites with a soft edge, faint ones fainter
+	float edge = length(gl_PointCoord * 2.0 - 1.0);
+	if (edge > 1.0)
+		discard;
+	FragColor = vec4(1.0, 0.93, 0.8, Alpha * (1.0 - edge * edge));
+}
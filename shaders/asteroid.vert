@@ -0,0 +1,50 @@
+#version 330 core
+
+/**
+* Asteroids, one point each (see AsteroidCatalogue.h), moved along their
+* orbits here rather than on the CPU. They are drawn on the sky at infinity,
+* like the skybox, in the direction they are seen from the Earth.
+*/
+
+layout (location = 0) in vec4 aAxisP;  // a P, AU in the J2000 ecliptic; eccentricity
+layout (location = 1) in vec4 aAxisQ;  // b Q; absolute magnitude H
+layout (location = 2) in vec2 aMotion; // mean anomaly at the catalogue's epoch, rad; mean motion, rad/day
+
+out float Alpha;
+
+/** Uniform variables */
+
+uniform mat4 uSkyViewProjection; // ecliptic directions to clip space
+uniform vec3 uEarth;             // heliocentric, AU
+uniform float uDays;             // since the catalogue's epoch
+uniform float uLimit;            // faintest magnitude at full alpha
+uniform float uPointSize;        // pixels, at the limit
+
+const float TWO_PI = 6.2831853;
+const float LOG10 = 0.4342945;
+
+void main()
+{
+    // Kepler's equation M = E - e sin E, Newton's method from Danby's start:
+    // float precision up to e = 0.9, a thousandth of a radian at 0.99
+    float e = aAxisP.w;
+    float M = mod(aMotion.x + aMotion.y * uDays, TWO_PI);
+    float E = M + 0.85 * e * (sin(M) < 0.0 ? -1.0 : 1.0);
+    for (int i = 0; i < 4; i++)
+        E -= (E - e * sin(E) - M) / (1.0 - e * cos(E));
+    vec3 helio = aAxisP.xyz * (cos(E) - e) + aAxisQ.xyz * sin(E);
+    vec3 geo = helio - uEarth;
+
+    // Apparent magnitude, H-G with G = 0.15
+    float r = length(helio), delta = length(geo);
+    float tanHalf = min(tan(0.5 * acos(clamp(dot(helio, geo) / (r * delta), -1.0, 1.0))), 1000.0);
+    float phase = 0.85 * exp(-3.33 * pow(tanHalf, 0.63)) + 0.15 * exp(-1.87 * pow(tanHalf, 1.22));
+    float magnitude = aAxisQ.w + 5.0 * LOG10 * log(r * delta) - 2.5 * LOG10 * log(max(phase, 1e-30));
+
+    // Level of detail: brighter than the limit grows, fainter fades, and five
+    // magnitudes past it is not rasterised at all
+    float flux = pow(10.0, -0.4 * (magnitude - uLimit));
+    Alpha = min(flux, 1.0);
+    gl_PointSize = uPointSize * clamp(sqrt(flux), 1.0, 4.0);
+    gl_Position = flux > 0.01 ? (uSkyViewProjection * vec4(geo, 0.0)).xyww : vec4(2.0, 2.0, 2.0, 1.0);
+}
@@ -0,0 +1,192 @@
+#version 330 core
+
+/**
+* Half resolution sky and aerial perspective, from the tables of
+* Atmosphere.cpp (same parametrisation, distances in km about the planet
+* centre). The full resolution composite upsamples both targets.
+*/
+
+layout (location = 0) out vec4 Inscatter;     // rgb, bilateral key in a
+layout (location = 1) out vec4 Transmittance; // rgb
+
+#define TRANSMITTANCE_WIDTH  256
+#define TRANSMITTANCE_HEIGHT 64
+#define SCATTERING_R    32
+#define SCATTERING_MU   128
+#define SCATTERING_MU_S 32
+#define SCATTERING_NU   8
+
+struct Atmosphere_t {
+	vec3 center;      // world
+	float kmPerUnit;
+	vec3 sunDirection;
+	float bottomRadius;
+	float topRadius;
+	vec3 rayleighScattering;
+	float mieScattering;
+	float miePhaseG;
+	float sunAngularRadius;
+	float muSMin;
+};
+
+/** Uniform variables */
+
+uniform Atmosphere_t uAtmosphere;
+uniform sampler2D uTransmittance;
+uniform sampler3D uScattering;
+
+uniform mat4 uInverseViewProjection;
+uniform vec3 uCamera; // km, planet centred
+uniform vec2 uTargetSize;
+
+/** Functions */
+
+float ClampCosine(float mu) {
+	return clamp(mu, -1.0, 1.0);
+}
+
+float SafeSqrt(float a) {
+	return sqrt(max(a, 0.0));
+}
+
+float DistanceToTop(float r, float mu) {
+	return max(0.0, -r * mu + SafeSqrt(r * r * (mu * mu - 1.0) + uAtmosphere.topRadius * uAtmosphere.topRadius));
+}
+
+bool RayIntersectsGround(float r, float mu) {
+	return mu < 0.0 && r * r * (mu * mu - 1.0) + uAtmosphere.bottomRadius * uAtmosphere.bottomRadius >= 0.0;
+}
+
+float CoordFromUnit(float x, int size) {
+	return 0.5 / float(size) + x * (1.0 - 1.0 / float(size));
+}
+
+vec3 TransmittanceToTop(float r, float mu) {
+	float H = sqrt(uAtmosphere.topRadius * uAtmosphere.topRadius - uAtmosphere.bottomRadius * uAtmosphere.bottomRadius);
+	float rho = SafeSqrt(r * r - uAtmosphere.bottomRadius * uAtmosphere.bottomRadius);
+	float d = DistanceToTop(r, mu);
+	float dMin = uAtmosphere.topRadius - r;
+	float dMax = rho + H;
+	vec2 uv = vec2(
+		CoordFromUnit((d - dMin) / (dMax - dMin), TRANSMITTANCE_WIDTH),
+		CoordFromUnit(rho / H, TRANSMITTANCE_HEIGHT));
+	return texture(uTransmittance, uv).rgb;
+}
+
+// From r to d along mu
+vec3 Transmittance(float r, float mu, float d, bool ground) {
+	float rd = clamp(sqrt(d * d + 2.0 * r * mu * d + r * r), uAtmosphere.bottomRadius, uAtmosphere.topRadius);
+	float muD = ClampCosine((r * mu + d) / rd);
+	if (ground)
+		return min(TransmittanceToTop(rd, -muD) / max(TransmittanceToTop(r, -mu), vec3(1e-20)), vec3(1.0));
+	return min(TransmittanceToTop(r, mu) / max(TransmittanceToTop(rd, muD), vec3(1e-20)), vec3(1.0));
+}
+
+vec4 Scattering(float r, float mu, float muS, float nu, bool ground) {
+
+	float H = sqrt(uAtmosphere.topRadius * uAtmosphere.topRadius - uAtmosphere.bottomRadius * uAtmosphere.bottomRadius);
+	float rho = SafeSqrt(r * r - uAtmosphere.bottomRadius * uAtmosphere.bottomRadius);
+	float uR = CoordFromUnit(rho / H, SCATTERING_R);
+
+	float rMu = r * mu;
+	float discriminant = rMu * rMu - r * r + uAtmosphere.bottomRadius * uAtmosphere.bottomRadius;
+	float uMu;
+	if (ground) {
+		float d = -rMu - SafeSqrt(discriminant);
+		float dMin = r - uAtmosphere.bottomRadius;
+		float dMax = rho;
+		uMu = 0.5 - 0.5 * CoordFromUnit(dMax == dMin ? 0.0 : (d - dMin) / (dMax - dMin), SCATTERING_MU / 2);
+	} else {
+		float d = -rMu + SafeSqrt(discriminant + H * H);
+		float dMin = uAtmosphere.topRadius - r;
+		float dMax = rho + H;
+		uMu = 0.5 + 0.5 * CoordFromUnit((d - dMin) / (dMax - dMin), SCATTERING_MU / 2);
+	}
+
+	float dMin = uAtmosphere.topRadius - uAtmosphere.bottomRadius;
+	float a = (DistanceToTop(uAtmosphere.bottomRadius, muS) - dMin) / (H - dMin);
+	float A = (DistanceToTop(uAtmosphere.bottomRadius, uAtmosphere.muSMin) - dMin) / (H - dMin);
+	float uMuS = CoordFromUnit(max(1.0 - a / A, 0.0) / (1.0 + a), SCATTERING_MU_S);
+
+	// nu is not filtered by the texture, lerp between its two slices
+	float texX = (nu + 1.0) * 0.5 * float(SCATTERING_NU - 1);
+	float sliceX = floor(texX);
+	float lerp = texX - sliceX;
+	vec3 uvw0 = vec3((sliceX + uMuS) / float(SCATTERING_NU), uMu, uR);
+	vec3 uvw1 = vec3((sliceX + 1.0 + uMuS) / float(SCATTERING_NU), uMu, uR);
+	return mix(texture(uScattering, uvw0), texture(uScattering, uvw1), lerp);
+}
+
+float RayleighPhase(float nu) {
+	return 3.0 / (16.0 * 3.14159265) * (1.0 + nu * nu);
+}
+
+float MiePhase(float g, float nu) {
+	float k = 3.0 / (8.0 * 3.14159265) * (1.0 - g * g) / (2.0 + g * g);
+	return k * (1.0 + nu * nu) / pow(1.0 + g * g - 2.0 * g * nu, 1.5);
+}
+
+// Rayleigh plus the Mie term rebuilt from the red channel kept in alpha
+vec3 Radiance(vec4 scattering, float nu) {
+	vec3 mie = scattering.r > 0.0
+		? scattering.rgb * scattering.a / scattering.r
+			* (uAtmosphere.rayleighScattering.r / uAtmosphere.mieScattering)
+			* (vec3(uAtmosphere.mieScattering) / uAtmosphere.rayleighScattering)
+		: vec3(0.0);
+	return scattering.rgb * RayleighPhase(nu) + mie * MiePhase(uAtmosphere.miePhaseG, nu);
+}
+
+void main() {
+
+	vec2 ndc = gl_FragCoord.xy / uTargetSize * 2.0 - 1.0;
+	vec4 nearPoint = uInverseViewProjection * vec4(ndc, -1.0, 1.0);
+	vec4 farPoint = uInverseViewProjection * vec4(ndc, 1.0, 1.0);
+	vec3 ray = normalize(farPoint.xyz / farPoint.w - nearPoint.xyz / nearPoint.w);
+
+	Inscatter = vec4(0.0);
+	Transmittance = vec4(1.0);
+
+	// Enter the atmosphere first if the camera is above it
+	vec3 camera = uCamera;
+	float r = length(camera);
+	float rMu = dot(camera, ray);
+	float top = uAtmosphere.topRadius;
+	float toTop = -rMu - SafeSqrt(rMu * rMu - r * r + top * top);
+	float entered = 0.0;
+	if (toTop > 0.0) {
+		camera += ray * toTop;
+		r = top;
+		rMu += toTop;
+		entered = toTop;
+	} else if (r > top) {
+		return; // misses the atmosphere
+	}
+
+	float mu = rMu / r;
+	float muS = dot(camera, uAtmosphere.sunDirection) / r;
+	float nu = dot(ray, uAtmosphere.sunDirection);
+	bool ground = RayIntersectsGround(r, mu);
+	vec4 scattering = Scattering(r, mu, muS, nu, ground);
+
+	float rayLength;
+	if (ground) {
+		// To the planet: subtract what lies behind the ground point
+		float bottom = uAtmosphere.bottomRadius;
+		rayLength = -rMu - SafeSqrt(rMu * rMu - r * r + bottom * bottom);
+		float rP = clamp(sqrt(rayLength * rayLength + 2.0 * r * mu * rayLength + r * r), bottom, top);
+		float muP = ClampCosine((r * mu + rayLength) / rP);
+		float muSP = ClampCosine((r * muS + rayLength * nu) / rP);
+		vec3 transmittance = Transmittance(r, mu, rayLength, true);
+		vec4 scatteringP = Scattering(rP, muP, muSP, nu, true);
+		scattering = max(scattering - transmittance.rgbr * scatteringP, vec4(0.0));
+		// Mie at the terminator is poorly sampled, fade it as the reference does
+		scattering.a *= smoothstep(0.0, 0.01, muS);
+		Transmittance = vec4(transmittance, 1.0);
+	} else {
+		rayLength = DistanceToTop(r, mu);
+		Transmittance = vec4(TransmittanceToTop(r, mu), 1.0);
+	}
+
+	// Key of the bilateral upsample, where the ray ends relative to the atmosphere size
+	Inscatter = vec4(Radiance(scattering, nu), (entered + rayLength) / top);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#version 330 core
+
+/**
+* Bilateral upsample of the half resolution atmosphere over the frame.
+* Dual-source blending does colour = scene * transmittance + in-scatter
+* (glBlendFunc(GL_ONE, GL_SRC1_COLOR)).
+*/
+
+layout (location = 0, index = 0) out vec4 Inscatter;
+layout (location = 0, index = 1) out vec4 Transmittance;
+
+struct Atmosphere_t {
+	vec3 center;      // world
+	float kmPerUnit;
+	float bottomRadius;
+	float topRadius;
+};
+
+/** Uniform variables */
+
+uniform Atmosphere_t uAtmosphere;
+uniform sampler2D uHalfInscatter;     // rgb, key in a
+uniform sampler2D uHalfTransmittance;
+
+uniform mat4 uInverseViewProjection;
+uniform mat4 uViewProjection;
+uniform vec3 uCamera; // km, planet centred
+uniform vec2 uTargetSize;
+uniform float uExposure;
+uniform float uGamma;
+
+void main() {
+
+	vec2 ndc = gl_FragCoord.xy / uTargetSize * 2.0 - 1.0;
+	vec4 nearPoint = uInverseViewProjection * vec4(ndc, -1.0, 1.0);
+	vec4 farPoint = uInverseViewProjection * vec4(ndc, 1.0, 1.0);
+	vec3 eye = nearPoint.xyz / nearPoint.w;
+	vec3 ray = normalize(farPoint.xyz / farPoint.w - eye);
+
+	// Where this ray enters and leaves the atmosphere, as atmosphere.frag keys it
+	float r = length(uCamera);
+	float rMu = dot(uCamera, ray);
+	float top = uAtmosphere.topRadius, bottom = uAtmosphere.bottomRadius;
+	float discriminant = rMu * rMu - r * r + top * top;
+	if (discriminant < 0.0 || -rMu + sqrt(discriminant) <= 0.0)
+		discard;
+	float entry = max(-rMu - sqrt(discriminant), 0.0);
+	float ground = rMu * rMu - r * r + bottom * bottom;
+	float exit = ground >= 0.0 && -rMu - sqrt(ground) > 0.0 ? -rMu - sqrt(ground) : -rMu + sqrt(discriminant);
+	float key = exit / top;
+
+	// Bodies in front of the atmosphere fail the depth test
+	vec4 clip = uViewProjection * vec4(eye + ray * (entry / uAtmosphere.kmPerUnit), 1.0);
+	gl_FragDepth = entry > 0.0 ? clamp(clip.z / clip.w * 0.5 + 0.5, 0.0, 1.0) : 0.0;
+
+	// Bilinear weights, scaled down across jumps of the key (the planet's limb)
+	ivec2 halfSize = textureSize(uHalfInscatter, 0);
+	vec2 position = gl_FragCoord.xy * vec2(halfSize) / uTargetSize - 0.5;
+	vec2 base = floor(position);
+	vec2 f = position - base;
+	vec3 inscatter = vec3(0.0), transmittance = vec3(0.0);
+	float total = 0.0;
+	for (int i = 0; i < 4; i++) {
+		ivec2 offset = ivec2(i & 1, i >> 1);
+		ivec2 texel = clamp(ivec2(base) + offset, ivec2(0), halfSize - 1);
+		vec4 low = texelFetch(uHalfInscatter, texel, 0);
+		float bilinear = (offset.x == 1 ? f.x : 1.0 - f.x) * (offset.y == 1 ? f.y : 1.0 - f.y);
+		float weight = (bilinear + 1e-4) / (0.01 + abs(low.a - key) / max(key, 1e-3));
+		inscatter += low.rgb * weight;
+		transmittance += texelFetch(uHalfTransmittance, texel, 0).rgb * weight;
+		total += weight;
+	}
+	inscatter /= total;
+	transmittance /= total;
+
+	// The scene is already display encoded, so are these
+	Inscatter = vec4(pow(1.0 - exp(-uExposure * inscatter), vec3(1.0 / uGamma)), 1.0);
+	Transmittance = vec4(pow(transmittance, vec3(1.0 / uGamma)), 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,248 @@
+#version 330 core
+
+/**
+* The cloud shell (see CloudLayer.h). Coverage is the red channel of the
+* diffuse map scrolled with time; the shell is lit by the sun, through the
+* atmosphere when it is on and shadowed as object.frag shadows the ground
+* (so the Moon's shadow crosses the clouds in an eclipse), and by the torch
+* and the clustered lights. Colour is premultiplied and display encoded,
+* ready for glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA).
+*/
+
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out float FragDistance; // from the camera, keys the upsample
+
+/** Spot Light, the torch */
+
+struct Spot_Light_t {
+	vec3 position;
+	vec3 direction;
+	vec3 diffuse;
+	float constant;
+	float linear;
+	float quadratic;
+	float innerCutOff;
+	float outerCutOff;
+};
+
+/** Texture mapping */
+
+struct TextureMap_t {
+	sampler2DArray texture_diffuse1;
+	sampler2DArray texture_normal1;
+	sampler2DArray texture_packed1;
+};
+
+/** Atmosphere, the tables of Atmosphere.h */
+
+struct Atmosphere_t {
+	vec3 center;      // world
+	float kmPerUnit;
+	float bottomRadius;
+	float topRadius;
+	float sunAngularRadius;
+};
+
+/** Uniform variables */
+
+uniform vec3 uCameraPos;
+uniform mat4 uView;
+uniform vec3 uSunDirection; // towards the sun
+uniform vec3 uSunColor;
+
+uniform bool uEnableTorch;
+uniform Spot_Light_t uSpotLight;
+
+// Clustered point and spot lights (see LightClusters.h), tiles sized to this target
+uniform usamplerBuffer uClusterGrid;
+uniform usamplerBuffer uLightIndices;
+uniform samplerBuffer uLightData;
+uniform ivec3 uClusterDims;
+uniform vec2 uClusterTileSize;
+uniform vec2 uClusterDepth;
+
+// Shadow, as object.frag
+#define MAX_SHADOW_TILES 4
+uniform sampler2D uShadowMap;
+uniform mat4 uShadowMatrices[MAX_SHADOW_TILES];
+uniform vec4 uShadowTiles[MAX_SHADOW_TILES];
+uniform float uShadowTexelDepth[MAX_SHADOW_TILES];
+uniform int uShadowTileCount;
+uniform int uShadowMode; // 0 shadow map, 1 analytic spheres
+
+#define MAX_OCCLUDERS 8
+uniform vec4 uOccluders[MAX_OCCLUDERS];
+uniform int uOccluderCount;
+uniform float uSunAngularRadius;
+
+uniform TextureMap_t uMaterial;
+uniform vec3 uMaterialLayers; // diffuse, normal, packed
+
+uniform Atmosphere_t uAtmosphere;
+uniform sampler2D uTransmittance;
+uniform sampler2D uIrradiance;
+uniform bool uEnableAtmosphere;
+
+uniform bool uEnableNormal;
+uniform float uTime;
+uniform float uGamma;
+
+/** Stream variables */
+
+in VS_OUT {
+    vec3 FragPos;
+    vec3 Normal;
+    vec2 TexCoords;
+	mat3 TBN;
+} fs_in;
+
+vec3 CalcSunLight(vec3 fragPos, vec3 normal, out vec3 skyLight) {
+
+	skyLight = vec3(0.0);
+	if (!uEnableAtmosphere)
+		return uSunColor;
+
+	// As CalcAtmosphereLight in object.frag, at the height of the shell
+	float bottom = uAtmosphere.bottomRadius, top = uAtmosphere.topRadius;
+	vec3 p = (fragPos - uAtmosphere.center) * uAtmosphere.kmPerUnit;
+	float r = clamp(length(p), bottom, top);
+	vec3 up = normalize(p);
+	float muS = dot(up, uSunDirection);
+
+	float H = sqrt(top * top - bottom * bottom);
+	float rho = sqrt(max(r * r - bottom * bottom, 0.0));
+	float d = max(0.0, -r * muS + sqrt(max(r * r * (muS * muS - 1.0) + top * top, 0.0)));
+	float dMin = top - r, dMax = rho + H;
+	vec2 uv = vec2(
+		0.5 / 256.0 + (d - dMin) / (dMax - dMin) * (1.0 - 1.0 / 256.0),
+		0.5 / 64.0 + rho / H * (1.0 - 1.0 / 64.0));
+	float sinH = bottom / r;
+	float cosH = -sqrt(max(1.0 - sinH * sinH, 0.0));
+	float disc = smoothstep(-sinH * uAtmosphere.sunAngularRadius, sinH * uAtmosphere.sunAngularRadius, muS - cosH);
+
+	vec2 irradianceUv = vec2(
+		0.5 / 64.0 + (muS * 0.5 + 0.5) * (1.0 - 1.0 / 64.0),
+		0.5 / 16.0 + (r - bottom) / (top - bottom) * (1.0 - 1.0 / 16.0));
+	skyLight = texture(uIrradiance, irradianceUv).rgb * (1.0 + dot(normal, up)) * 0.5 * uSunColor;
+
+	return texture(uTransmittance, uv).rgb * disc * uSunColor;
+}
+
+float CalcParallelShadow(vec3 fragPos, vec3 normal) {
+	// As object.frag: every tile holds one caster, the darkest tile wins
+	float shadow = 0.0;
+	vec2 texelSize = 1.0 / textureSize(uShadowMap, 0);
+	float slope = 1.0 - max(dot(normal, uSunDirection), 0.0);
+	for (int i = 0; i < uShadowTileCount; i++) {
+		vec3 projCoords = (uShadowMatrices[i] * vec4(fragPos, 1.0)).xyz * 0.5 + 0.5;
+		if (any(lessThan(projCoords, vec3(0.0))) || any(greaterThan(projCoords, vec3(1.0))))
+			continue;
+		vec2 atlasCoords = uShadowTiles[i].xy + projCoords.xy * uShadowTiles[i].zw;
+		float bias = uShadowTexelDepth[i] * (1.5 + 4.0 * slope);
+		float tileShadow = 0.0;
+		for (int x = -1; x <= 1; x++)
+			for (int y = -1; y <= 1; y++)
+				tileShadow += (projCoords.z - bias > texture(uShadowMap, atlasCoords + vec2(x, y) * texelSize).r) ? 1.0 : 0.0;
+		shadow = max(shadow, tileShadow / 9.0);
+	}
+	return shadow;
+}
+
+float CalcSphereShadow(vec3 fragPos) {
+	// As object.frag: the fraction of the solar disc the spheres hide
+	float rs = uSunAngularRadius;
+	float sunArea = 3.14159265 * rs * rs;
+	float lit = 1.0;
+	for (int i = 0; i < uOccluderCount; i++) {
+		vec3 toOccluder = uOccluders[i].xyz - fragPos;
+		float dist = length(toOccluder);
+		float radius = uOccluders[i].w;
+		if (dist <= radius * 1.01)
+			continue;
+		vec3 dir = toOccluder / dist;
+		float cosAngle = dot(dir, uSunDirection);
+		if (cosAngle <= 0.0)
+			continue;
+		float d = atan(length(cross(dir, uSunDirection)), cosAngle);
+		float ro = asin(radius / dist);
+		if (d >= rs + ro)
+			continue;
+
+		float overlap;
+		if (d <= abs(rs - ro)) {
+			overlap = 3.14159265 * min(rs, ro) * min(rs, ro);
+		} else {
+			float a = rs * rs * acos(clamp((d * d + rs * rs - ro * ro) / (2.0 * d * rs), -1.0, 1.0));
+			float b = ro * ro * acos(clamp((d * d + ro * ro - rs * rs) / (2.0 * d * ro), -1.0, 1.0));
+			float c = 0.5 * sqrt(max((-d + rs + ro) * (d + rs - ro) * (d - rs + ro) * (d + rs + ro), 0.0));
+			overlap = a + b - c;
+		}
+		lit *= 1.0 - clamp(overlap / sunArea, 0.0, 1.0);
+	}
+	return 1.0 - lit;
+}
+
+vec3 CalcLocalLights(vec3 fragPos, vec3 normal) {
+
+	// Diffuse only, clouds have no highlight
+	vec3 result = vec3(0.0);
+	if (uEnableTorch) {
+		vec3 toLight = uSpotLight.position - fragPos;
+		float distance = length(toLight);
+		vec3 lightDir = toLight / distance;
+		float attenuation = 1.0 / (uSpotLight.constant + uSpotLight.linear * distance + uSpotLight.quadratic * distance * distance);
+		float theta = dot(lightDir, normalize(-uSpotLight.direction));
+		float intensity = clamp((theta - uSpotLight.outerCutOff) / (uSpotLight.innerCutOff - uSpotLight.outerCutOff), 0.0, 1.0);
+		result += attenuation * intensity * max(dot(normal, lightDir), 0.0) * uSpotLight.diffuse;
+	}
+
+	// The lights of this fragment's froxel, as CalcClusteredLights in object.frag
+	float depth = -(uView * vec4(fragPos, 1.0)).z;
+	ivec3 cell = ivec3(
+		ivec2(gl_FragCoord.xy / uClusterTileSize),
+		int(floor(log(max(depth, 1e-4)) * uClusterDepth.x + uClusterDepth.y)));
+	cell = clamp(cell, ivec3(0), uClusterDims - 1);
+	int cluster = (cell.z * uClusterDims.y + cell.y) * uClusterDims.x + cell.x;
+	uvec2 range = texelFetch(uClusterGrid, cluster).rg;
+	for (uint i = 0u; i < range.y; i++) {
+		int light = int(texelFetch(uLightIndices, int(range.x + i)).r) * 4;
+		vec4 positionRange = texelFetch(uLightData, light);
+		vec4 attenuationOuter = texelFetch(uLightData, light + 2);
+		vec4 directionInner = texelFetch(uLightData, light + 3);
+
+		vec3 toLight = positionRange.xyz - fragPos;
+		float distance = length(toLight);
+		if (distance >= positionRange.w)
+			continue;
+		vec3 lightDir = toLight / distance;
+		float attenuation = 1.0 / (attenuationOuter.x + attenuationOuter.y*distance + attenuationOuter.z*distance*distance);
+		float theta = dot(lightDir, -directionInner.xyz);
+		float cone = clamp((theta - attenuationOuter.w) / max(directionInner.w - attenuationOuter.w, 1e-4), 0.0, 1.0);
+		result += attenuation * cone * max(dot(normal, lightDir), 0.0) * texelFetch(uLightData, light + 1).rgb;
+	}
+
+	return result;
+}
+
+void main() {
+
+	// The clouds drift east
+	vec2 texCoords = vec2(fract(fs_in.TexCoords.x + 0.05 * uTime), fs_in.TexCoords.y);
+	// Clear sky is still written: its distance keeps the upsample from smearing clouds into it
+	float coverage = texture(uMaterial.texture_diffuse1, vec3(texCoords, uMaterialLayers.x)).r;
+
+	vec3 normal = normalize(fs_in.Normal);
+	if (uEnableNormal) {
+		normal = texture(uMaterial.texture_normal1, vec3(texCoords, uMaterialLayers.y)).rgb;
+		normal = normalize(fs_in.TBN * normalize(normal * 2.0 - 1.0));
+	}
+
+	vec3 skyLight;
+	vec3 sunLight = CalcSunLight(fs_in.FragPos, normal, skyLight);
+	float shadow = uShadowMode == 1 ? CalcSphereShadow(fs_in.FragPos) : CalcParallelShadow(fs_in.FragPos, normal);
+	vec3 color = max(dot(normal, uSunDirection), 0.0) * sunLight * (1.2 - shadow) + skyLight
+		+ CalcLocalLights(fs_in.FragPos, normal);
+
+	FragColor = vec4(pow(color, vec3(1.0 / uGamma)) * coverage, coverage);
+	FragDistance = length(fs_in.FragPos - uCameraPos);
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#version 330 core
+
+/**
+* Depth-aware upsample of the low resolution cloud shell (see CloudLayer.h),
+* premultiplied over the frame (glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA)).
+*/
+
+layout (location = 0) out vec4 FragColor;
+
+/** Uniform variables */
+
+uniform sampler2D uLowColor;    // premultiplied
+uniform sampler2D uLowDistance; // 0 where the shell was not drawn
+
+uniform mat4 uInverseViewProjection;
+uniform mat4 uViewProjection;
+uniform vec3 uCameraPos;
+uniform vec4 uShell; // world centre xyz, radius w
+uniform vec2 uTargetSize;
+
+void main() {
+
+	vec2 ndc = gl_FragCoord.xy / uTargetSize * 2.0 - 1.0;
+	vec4 farPoint = uInverseViewProjection * vec4(ndc, 1.0, 1.0);
+	vec3 ray = normalize(farPoint.xyz / farPoint.w - uCameraPos);
+
+	// Nearest hit of the shell sphere, what cloud.frag measured as its distance
+	vec3 toCamera = uCameraPos - uShell.xyz;
+	float b = dot(toCamera, ray);
+	float discriminant = b * b - dot(toCamera, toCamera) + uShell.w * uShell.w;
+	if (discriminant < 0.0)
+		discard;
+	float hit = -b - sqrt(discriminant);
+	if (hit <= 0.0)
+		hit = -b + sqrt(discriminant);
+	if (hit <= 0.0)
+		discard;
+
+	// Bodies in front of the shell fail the depth test
+	vec4 clip = uViewProjection * vec4(uCameraPos + ray * hit, 1.0);
+	gl_FragDepth = clamp(clip.z / clip.w * 0.5 + 0.5, 0.0, 1.0);
+
+	// Bilinear weights, scaled down for texels whose distance is off this pixel's
+	ivec2 lowSize = textureSize(uLowColor, 0);
+	vec2 position = gl_FragCoord.xy * vec2(lowSize) / uTargetSize - 0.5;
+	vec2 base = floor(position);
+	vec2 f = position - base;
+	vec4 color = vec4(0.0);
+	float total = 0.0;
+	for (int i = 0; i < 4; i++) {
+		ivec2 offset = ivec2(i & 1, i >> 1);
+		ivec2 texel = clamp(ivec2(base) + offset, ivec2(0), lowSize - 1);
+		float lowDistance = texelFetch(uLowDistance, texel, 0).r;
+		float bilinear = (offset.x == 1 ? f.x : 1.0 - f.x) * (offset.y == 1 ? f.y : 1.0 - f.y);
+		float weight = (bilinear + 1e-4) / (0.01 + abs(lowDistance - hit) / hit);
+		color += texelFetch(uLowColor, texel, 0) * weight;
+		total += weight;
+	}
+	color /= total;
+	if (color.a < 0.001)
+		discard;
+
+	FragColor = color;
+}
\ No newline at end of file
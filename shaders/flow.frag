@@ -0,0 +1,21 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 Corner;
+in float Fade;
+
+uniform int uMode;
+uniform vec4 uColor; // alpha of a single particle, they add up
+
+void main() {
+
+	float across = 1.0 - Corner.x * Corner.x;
+	float t = Corner.y * 0.5 + 0.5; // tail to head, bottom to top
+	if (uMode == 2) {
+		// Oxygen green low, red at the top, above a sharp lower edge
+		vec3 color = mix(vec3(0.25, 1.0, 0.45), vec3(1.0, 0.25, 0.35), smoothstep(0.5, 1.0, t));
+		FragColor = vec4(color, uColor.a * Fade * across * smoothstep(0.0, 0.08, t) * (1.0 - t));
+	} else
+		FragColor = vec4(uColor.rgb, uColor.a * Fade * across * t);
+}
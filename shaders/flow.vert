@@ -0,0 +1,51 @@
+#version 330 core
+
+/**
+* Flow particles (see FlowParticles.h), one instanced quad each: a streak
+* trailing behind a wind particle, just off the ground, or a strip of
+* aurora curtain standing 100 to 300 km up.
+*/
+
+layout (location = 0) in vec2 aCorner; // of the quad, -1 to 1
+layout (location = 1) in vec4 aState;  // per instance, see flow_update.vert
+
+out vec2 Corner;
+out float Fade;
+
+/** Uniform variables */
+
+uniform sampler2D uField;
+uniform int uMode;
+uniform float uSpeedup;
+uniform float uStreak; // display seconds of motion a streak spans
+
+uniform mat4 uViewProjection;
+uniform mat4 uEarthFixedToWorld; // km
+uniform mat3 uMagneticToFixed;   // geomagnetic axes to Earth-fixed
+
+const float PI = 3.14159265358979;
+const float EARTH_RADIUS = 6371.0; // km
+
+void main()
+{
+    float lon = aState.x, lat = aState.y;
+    vec3 up = vec3(cos(lat) * cos(lon), cos(lat) * sin(lon), sin(lat));
+    vec3 east = vec3(-sin(lon), cos(lon), 0.0);
+    vec3 position;
+    if (uMode == 2) {
+        up = uMagneticToFixed * up;
+        east = uMagneticToFixed * east;
+        position = up * (EARTH_RADIUS + 200.0 + 100.0 * aCorner.y) + east * 40.0 * aCorner.x;
+    } else {
+        vec2 wind = texture(uField, vec2(lon / (2.0 * PI) + 0.5, 0.5 - lat / PI)).xy;
+        float speed = length(wind);
+        vec3 direction = speed > 0.0 ? (east * wind.x + cross(up, east) * wind.y) / speed : east;
+        float streak = 20.0 + speed * uSpeedup * uStreak / 1000.0;
+        position = up * EARTH_RADIUS * 1.004 + direction * streak * 0.5 * (aCorner.y - 1.0)
+            + cross(up, direction) * 12.0 * aCorner.x;
+    }
+    gl_Position = uViewProjection * uEarthFixedToWorld * vec4(position, 1.0);
+    Corner = aCorner;
+    // In and out over half a second
+    Fade = clamp(aState.z / 0.5, 0.0, 1.0) * clamp((aState.w - aState.z) / 0.5, 0.0, 1.0);
+}
@@ -0,0 +1,71 @@
+#version 330 core
+
+/**
+* One step of the flow particles (see FlowParticles.h), captured by transform
+* feedback into the other state buffer; nothing is rasterized.
+*/
+
+layout (location = 0) in vec4 aState; // longitude, latitude (rad), age, lifetime (s)
+
+out vec4 State;
+
+/** Uniform variables */
+
+uniform sampler2D uField; // wind, m/s east and north
+uniform int uMode;        // FlowMode
+uniform float uStep;      // display seconds
+uniform float uSpeedup;   // seconds of wind per display second
+uniform int uSeed;        // different every step
+
+const float PI = 3.14159265358979;
+const float EARTH_RADIUS = 6371000.0; // m
+const float OVAL = 1.17;              // geomagnetic latitude of the auroral ovals, rad
+const float OVAL_WIDTH = 0.07;
+
+// Integer hash (lowbias32), well mixed in every bit
+uint hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Uniform in [0, 1), independent per particle, step and stream
+float random(uint stream)
+{
+    uint x = hash((uint(gl_VertexID) * 8u + stream) ^ hash(uint(uSeed)));
+    return float(x >> 8) / 16777216.0;
+}
+
+void main()
+{
+    vec4 state = aState;
+    state.z += uStep;
+    if (uMode == 2) {
+        // Drifting westward around the geomagnetic pole
+        state.x -= 0.05 * uStep;
+    } else {
+        // Carried by the wind, the metres turned into angles on the sphere
+        vec2 wind = texture(uField, vec2(state.x / (2.0 * PI) + 0.5, 0.5 - state.y / PI)).xy;
+        float metres = uStep * uSpeedup;
+        state.x += wind.x * metres / (EARTH_RADIUS * max(cos(state.y), 0.05));
+        state.y = clamp(state.y + wind.y * metres / EARTH_RADIUS, -0.5 * PI, 0.5 * PI);
+    }
+    state.x = mod(state.x + PI, 2.0 * PI) - PI;
+
+    // Respawn when expired, anywhere on the globe for the wind, in either
+    // oval for the aurora. A negative age is a reset: start part way through
+    // so they do not all expire together
+    if (aState.z < 0.0 || state.z > state.w) {
+        float lifetime = mix(2.0, 5.0, random(0u));
+        float lon = PI * (2.0 * random(1u) - 1.0);
+        float lat = uMode == 2
+            ? (random(2u) < 0.5 ? -1.0 : 1.0) * (OVAL + OVAL_WIDTH * (random(3u) + random(4u) - 1.0))
+            : asin(2.0 * random(2u) - 1.0);
+        state = vec4(lon, lat, aState.z < 0.0 ? lifetime * random(5u) : 0.0, lifetime);
+    }
+    State = state;
+}
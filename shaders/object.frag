@@ -38,77 +38,119 @@ struct Spot_Light_t {
 
 /** Texture mapping */
 
+// Material textures are layers of 2D arrays, see Material.h
 struct TextureMap_t {
 	// diffuse
-	sampler2D texture_diffuse1;
-	sampler2D texture_diffuse2;
-	// specular
-	sampler2D texture_specular1;
-	sampler2D texture_specular2;
+	sampler2DArray texture_diffuse1;
 	// normal
-	sampler2D texture_normal1;
-	sampler2D texture_normal2;
-	// height
-	sampler2D texture_height1;
-	sampler2D texture_height2;
-	// emission
-	sampler2D texture_emission1;
-	sampler2D texture_emission2;
+	sampler2DArray texture_normal1;
+	// packed: r height, g specular mask, b emission intensity (see MaterialCooker.h)
+	sampler2DArray texture_packed1;
 	// To be added ...
 };
 
+/** Atmosphere, the tables of Atmosphere.h */
+
+struct Atmosphere_t {
+	vec3 center;      // world
+	float kmPerUnit;
+	float bottomRadius;
+	float topRadius;
+	float sunAngularRadius;
+};
+
 /** Function definition */
 
 vec4 CalcDirectionalLight(
 	Directional_Light_t light,
 	vec3 normal, vec3 viewDir,
-	vec2 texCoords, sampler2D diffuse, sampler2D specular);
+	vec4 diffuse, float specular);
 
 vec4 CalcPointLight(
 	Point_Light_t light,
 	vec3 normal, vec3 viewDir, vec3 fragPos,
-	vec2 texCoords, sampler2D diffuse, sampler2D specular);
+	vec4 diffuse, float specular);
 
 vec4 CalcSpotLight(
 	Spot_Light_t light,
 	vec3 normal, vec3 viewDir, vec3 fragPos,
-	vec2 texCoords, sampler2D diffuse, sampler2D specular);
+	vec4 diffuse, float specular);
 
 vec4 CalcEmission(
-	vec2 texCoords, sampler2D emission,
+	float emission,
 	vec4 testLight);
 
 float CalcParallelShadow(vec3 lightDir, vec3 normal);
 
+float CalcSphereShadow(vec3 lightDir);
+
+vec3 CalcAtmosphereLight(
+	vec3 fragPos, vec3 lightDir, vec3 normal,
+	out vec3 skyLight);
+
+vec4 CalcClusteredLights(
+	vec3 normal, vec3 viewDir, vec3 fragPos,
+	vec4 diffuse, float specular);
+
 vec2 ParallaxMapping(
-	vec2 texCoords, sampler2D height, float scale,
+	vec2 texCoords, sampler2DArray height, float layer, float scale,
 	vec3 viewDir, vec3 normal);
 
+vec2 QuadtreeParallaxMapping(
+	vec2 texCoords, sampler2DArray height, float layer, float scale,
+	vec3 viewDir);
+
 /** Uniform variables */
 
 // Camera
 uniform vec3 uCameraPos;
+uniform mat4 uView;
 
 // Lighting
-#define NR_POINT_LIGHTS 4
 uniform Directional_Light_t uDirectionalLight;
 uniform Spot_Light_t uSpotLight;
 uniform Point_Light_t uPointLight;
-uniform Point_Light_t uPointLights[NR_POINT_LIGHTS];
+
+// Clustered point and spot lights (see LightClusters.h)
+uniform usamplerBuffer uClusterGrid;  // per froxel: first index, count
+uniform usamplerBuffer uLightIndices;
+uniform samplerBuffer uLightData;     // 4 texels per light
+uniform ivec3 uClusterDims;
+uniform vec2 uClusterTileSize;        // pixels
+uniform vec2 uClusterDepth;           // slice = log(view depth) * x + y
 
 // Texture (Model Importer specified)
 uniform TextureMap_t uMaterial;
+uniform vec3 uMaterialLayers; // diffuse, normal, packed
 
-// Shadow
+// Shadow, an atlas of per-caster tiles (see ParallelShadow.h)
+#define MAX_SHADOW_TILES 4
 uniform sampler2D uShadowMap;
+uniform mat4 uShadowMatrices[MAX_SHADOW_TILES]; // world to tile NDC
+uniform vec4 uShadowTiles[MAX_SHADOW_TILES];    // atlas offset xy, scale zw
+uniform float uShadowTexelDepth[MAX_SHADOW_TILES];
+uniform int uShadowTileCount;
+uniform int uShadowMode; // 0 shadow map, 1 analytic spheres (see ShadowMode)
+
+// Eclipse shadows: spheres against a sun of finite angular size
+#define MAX_OCCLUDERS 8
+uniform vec4 uOccluders[MAX_OCCLUDERS]; // world centre xyz, radius w
+uniform int uOccluderCount;
+uniform float uSunAngularRadius;
+
+// Atmosphere: sunlight through the air and sky light (DRAW_ATMOSPHERE draws)
+uniform Atmosphere_t uAtmosphere;
+uniform sampler2D uTransmittance;
+uniform sampler2D uIrradiance;
+uniform bool uEnableAtmosphere;
 
 // Control
 uniform bool uEnableTorch;
 uniform bool uEnableEmission;
 uniform bool uEnableNormal;
-uniform float uTime;
 uniform float uGamma;
 uniform float uHeightScale;
+uniform bool uQuadtreeParallax; // traverse the min-depth pyramid instead of marching layers
 
 /** Stream variables */
 
@@ -118,7 +160,6 @@ in VS_OUT {
     vec3 FragPos;
     vec3 Normal;
     vec2 TexCoords;
-	vec4 FragPosLightSpace;
 	mat3 TBN;
 } fs_in;
 
@@ -132,61 +173,50 @@ void main() {
 
 	if (uEnableNormal) {
 		// get parallax map
-		texCoords = ParallaxMapping(texCoords, uMaterial.texture_height1, uHeightScale,
-			transpose(fs_in.TBN) * viewDir, transpose(fs_in.TBN) * fs_in.Normal);
+		if (uQuadtreeParallax)
+			texCoords = QuadtreeParallaxMapping(texCoords, uMaterial.texture_packed1, uMaterialLayers.z, uHeightScale,
+				transpose(fs_in.TBN) * viewDir);
+		else
+			texCoords = ParallaxMapping(texCoords, uMaterial.texture_packed1, uMaterialLayers.z, uHeightScale,
+				transpose(fs_in.TBN) * viewDir, transpose(fs_in.TBN) * fs_in.Normal);
 		// get normal map
-		normal = texture(uMaterial.texture_normal1, fs_in.TexCoords).rgb;
+		normal = texture(uMaterial.texture_normal1, vec3(fs_in.TexCoords, uMaterialLayers.y)).rgb;
 		// transform normal vector to world space coordinates
 		normal = normalize(normal * 2.0 - 1.0); // [0,1] -> [-1,1]
 		normal = normalize(fs_in.TBN * normal);
 	}
 
-	// Tell whether it is cloud texture
-	vec4 testColor = texture(uMaterial.texture_diffuse1, texCoords);
-	if (testColor.x > 0.001 && testColor.y < 0.001 && testColor.z < 0.001) {
-		float offset = 0.05 * uTime;
-		texCoords.x = fract(texCoords.x + offset);
-	}
+	// Every material texture is fetched once, the lighting below works on the values
+	// (the cloud shell has its own shader, cloud.frag)
+	vec4 diffuseColor = texture(uMaterial.texture_diffuse1, vec3(texCoords, uMaterialLayers.x));
+	vec4 material = texture(uMaterial.texture_packed1, vec3(texCoords, uMaterialLayers.z));
 
 	vec4 resultColor = vec4(0.0);
 
 	// Directional lighting
 	vec4 directionalLightColor = CalcDirectionalLight(
 		uDirectionalLight, normal, viewDir,
-		texCoords, uMaterial.texture_diffuse1, uMaterial.texture_specular1);
+		diffuseColor, material.g);
 
 	// Spot lighting
 	vec4 spotLightColor = vec4(0.0);
 	if (uEnableTorch)
 		spotLightColor = CalcSpotLight(
 			uSpotLight, normal, viewDir, fs_in.FragPos,
-			texCoords, uMaterial.texture_diffuse1, uMaterial.texture_specular1);
+			diffuseColor, material.g);
 
-	// Point lighting
-	/**
-	for (int i=0; i<NR_POINT_LIGHTS; i++) {
-		resultColor += CalcPointLight(
-			uPointLights[i], normal, viewDir, fs_in.FragPos,
-			texCoords, uMaterial.texture_diffuse1, uMaterial.texture_specular1);
-	}*/
+	// Point and spot lighting, only the lights of this fragment's cluster
+	vec4 clusterLightColor = CalcClusteredLights(
+		normal, viewDir, fs_in.FragPos,
+		diffuseColor, material.g);
 
 	//
 	vec4 emissionLight = vec4(0.0);
 	if (uEnableEmission)
-		emissionLight = CalcEmission(
-			texCoords, uMaterial.texture_emission1, directionalLightColor);
+		emissionLight = CalcEmission(material.b, directionalLightColor);
 
 	// Light sum
-	resultColor = directionalLightColor + spotLightColor;
-
-	// Greyscale process
-	if (testColor.x > 0.001 && testColor.y < 0.001 && testColor.z < 0.001) {
-		// Cloud part
-		resultColor = vec4(resultColor.r);
-	} else if (testColor.x < 0.001 && testColor.y < 0.001 && testColor.z < 0.001) {
-		// Transparent part
-		resultColor.a = 0.0;
-	}
+	resultColor = directionalLightColor + spotLightColor + clusterLightColor;
 
 	// Result
 	FragColor = resultColor + emissionLight;
@@ -195,7 +225,7 @@ void main() {
 	FragColor.xyz = pow(FragColor.xyz, vec3(1.0 / uGamma));
 }
 
-vec2 ParallaxMapping(vec2 texCoords, sampler2D height, float scale, vec3 viewDir, vec3 normal) {
+vec2 ParallaxMapping(vec2 texCoords, sampler2DArray height, float layer, float scale, vec3 viewDir, vec3 normal) {
 	
 	//float disp = texture(height, texCoords).r;     
 	//return texCoords - viewDir.xy * (disp * scale);
@@ -212,7 +242,7 @@ vec2 ParallaxMapping(vec2 texCoords, sampler2D height, float scale, vec3 viewDir
 	vec2 deltaTexCoords = P / numLayers;
 	
 	vec2 currentTexCoords = texCoords;
-	float currentDepthValue = texture(height, currentTexCoords).r;
+	float currentDepthValue = texture(height, vec3(currentTexCoords, layer)).r;
 
 	for (int i = 0; i < numLayers; i++) {
 		if (currentLayerDepth >= currentDepthValue)
@@ -220,76 +250,264 @@ vec2 ParallaxMapping(vec2 texCoords, sampler2D height, float scale, vec3 viewDir
 		// shift texture coordinates along direction of P
 		currentTexCoords -= deltaTexCoords;
 		// get depth map value at current texture coordinates
-		currentDepthValue = texture(height, currentTexCoords).r;
+		currentDepthValue = texture(height, vec3(currentTexCoords, layer)).r;
 		// get depth of next layer
 		currentLayerDepth += layerDepth;
 	}
 
 	vec2 prevTexCoords = currentTexCoords + deltaTexCoords;
 	float afterDepth = currentDepthValue - currentLayerDepth;
-	float beforeDepth = texture(height, prevTexCoords).r - currentLayerDepth + layerDepth;
+	float beforeDepth = texture(height, vec3(prevTexCoords, layer)).r - currentLayerDepth + layerDepth;
 	float weight = afterDepth / (afterDepth - beforeDepth);
 	currentTexCoords = prevTexCoords * weight + currentTexCoords * (1.0 - weight);
 
 	return currentTexCoords;
 }
 
+vec2 QuadtreeParallaxMapping(vec2 texCoords, sampler2DArray height, float layer, float scale, vec3 viewDir) {
+
+	// The same ray as ParallaxMapping, uv(t) = texCoords + dir * t for depth t in [0, 1].
+	// Alpha of mip k > 0 holds the smallest depth under each texel (MaterialCooker.h),
+	// so the ray can skip to that depth, or out of the texel, without missing anything.
+	vec2 dir = -viewDir.xy * scale;
+	float reach = max(abs(dir.x), abs(dir.y));
+	ivec2 baseSize = textureSize(height, 0).xy;
+	int maxLevel = int(log2(float(max(baseSize.x, baseSize.y))));
+
+	int level = maxLevel;
+	float t = 0.0;
+	float above = 0.0; // last depth known to be above the surface
+	for (int i = 0; i < 64 && level >= 0; i++) {
+		vec2 size = vec2(textureSize(height, level).xy);
+		vec2 cell = floor((texCoords + dir * t) * size);
+		ivec3 texel = ivec3(mod(cell, size), int(layer));
+		float depth = level == 0 ? texelFetch(height, texel, 0).r : texelFetch(height, texel, level).a;
+
+		// the surface may be in this texel, look closer
+		if (t >= depth) {
+			level--;
+			continue;
+		}
+		above = t;
+
+		// depth at which the ray leaves the texel
+		vec2 edge = (cell + step(0.0, dir)) / size;
+		vec2 exit = vec2(2.0);
+		if (abs(dir.x) > 1e-6) exit.x = (edge.x - texCoords.x) / dir.x;
+		if (abs(dir.y) > 1e-6) exit.y = (edge.y - texCoords.y) / dir.y;
+		float leave = min(exit.x, exit.y);
+
+		if (depth <= leave) {
+			t = depth;
+			level--;
+		} else {
+			// into the neighbour, a hundredth of a texel past the edge, from a coarser level
+			t = leave + 0.01 / (reach * max(size.x, size.y));
+			level = min(level + 1, maxLevel);
+		}
+		if (t >= 1.0) {
+			t = 1.0;
+			break;
+		}
+	}
+
+	// Texel-accurate so far, two secant steps on the filtered height smooth it
+	float afterDepth = texture(height, vec3(texCoords + dir * t, layer)).r - t;
+	float beforeDepth = texture(height, vec3(texCoords + dir * above, layer)).r - above;
+	float weight = clamp(beforeDepth / max(beforeDepth - afterDepth, 1e-4), 0.0, 1.0);
+	float middle = mix(above, t, weight);
+	float middleDepth = texture(height, vec3(texCoords + dir * middle, layer)).r - middle;
+	if (middleDepth > 0.0) {
+		above = middle;
+		beforeDepth = middleDepth;
+	} else {
+		t = middle;
+		afterDepth = middleDepth;
+	}
+	weight = clamp(beforeDepth / max(beforeDepth - afterDepth, 1e-4), 0.0, 1.0);
+	t = mix(above, t, weight);
+
+	return texCoords + dir * t;
+}
+
 float CalcParallelShadow(vec3 lightDir, vec3 normal) {
-	// perform perspective divide
-	vec3 projCoords = fs_in.FragPosLightSpace.xyz / fs_in.FragPosLightSpace.w;
-	//
-	if (projCoords.z > 1.0) return 0.0;
-	// transform to [0, 1] range
-	projCoords = projCoords * 0.5 + 0.5;
-	// get closest depth value from light's perspective
-	//float closestDepth = texture(shadowMap, projCoords.xy).r;
-	// get depth of current fragment from light's perspective
-	float currentDepth = projCoords.z;
-	// check whether current frag pos is in shadow
-	float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
-	//float shadow = shadow += (currentDepth - bias > closestDepth) ? 1.0 : 0.0;
+	// Every tile holds one caster, the darkest tile wins
 	float shadow = 0.0;
 	vec2 texelSize = 1.0 / textureSize(uShadowMap, 0);
-	for (int x = -1; x <= 1; x++) {
-		for (int y = -1; y <= 1; y++) {
-			float pcfDepth = texture(uShadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
-			shadow += (currentDepth - bias > pcfDepth) ? 1.0 : 0.0;
+	float slope = 1.0 - max(dot(normal, lightDir), 0.0);
+	for (int i = 0; i < uShadowTileCount; i++) {
+		// orthographic, no perspective divide; transform to [0, 1] range
+		vec3 projCoords = (uShadowMatrices[i] * vec4(fs_in.FragPos, 1.0)).xyz * 0.5 + 0.5;
+		// outside the tile, or in front of its caster
+		if (any(lessThan(projCoords, vec3(0.0))) || any(greaterThan(projCoords, vec3(1.0))))
+			continue;
+		vec2 atlasCoords = uShadowTiles[i].xy + projCoords.xy * uShadowTiles[i].zw;
+		// get depth of current fragment from light's perspective
+		float currentDepth = projCoords.z;
+		// bias of a texel or two, more at grazing angles
+		float bias = uShadowTexelDepth[i] * (1.5 + 4.0 * slope);
+		float tileShadow = 0.0;
+		for (int x = -1; x <= 1; x++) {
+			for (int y = -1; y <= 1; y++) {
+				float pcfDepth = texture(uShadowMap, atlasCoords + vec2(x, y) * texelSize).r;
+				tileShadow += (currentDepth - bias > pcfDepth) ? 1.0 : 0.0;
+			}
 		}
+		shadow = max(shadow, tileShadow / 9.0);
 	}
-	shadow /= 9.0;
 
 	return shadow;
 }
 
+float CalcSphereShadow(vec3 lightDir) {
+	// Fraction of the solar disc each sphere hides, from the angular radii of
+	// sun and occluder and the angle between their centres
+	float rs = uSunAngularRadius;
+	float sunArea = 3.14159265 * rs * rs;
+	float lit = 1.0;
+	for (int i = 0; i < uOccluderCount; i++) {
+		vec3 toOccluder = uOccluders[i].xyz - fs_in.FragPos;
+		float dist = length(toOccluder);
+		float radius = uOccluders[i].w;
+		// the receiver itself, N.L already darkens its night side
+		if (dist <= radius * 1.01)
+			continue;
+		vec3 dir = toOccluder / dist;
+		float cosAngle = dot(dir, lightDir);
+		if (cosAngle <= 0.0)
+			continue;
+		// atan keeps precision at the tiny angles a penumbra spans
+		float d = atan(length(cross(dir, lightDir)), cosAngle);
+		float ro = asin(radius / dist);
+		if (d >= rs + ro)
+			continue;
+
+		float overlap;
+		if (d <= abs(rs - ro)) {
+			// annular or total
+			overlap = 3.14159265 * min(rs, ro) * min(rs, ro);
+		} else {
+			// lens of two intersecting discs
+			float a = rs * rs * acos(clamp((d * d + rs * rs - ro * ro) / (2.0 * d * rs), -1.0, 1.0));
+			float b = ro * ro * acos(clamp((d * d + ro * ro - rs * rs) / (2.0 * d * ro), -1.0, 1.0));
+			float c = 0.5 * sqrt(max((-d + rs + ro) * (d + rs - ro) * (d - rs + ro) * (d + rs + ro), 0.0));
+			overlap = a + b - c;
+		}
+		lit *= 1.0 - clamp(overlap / sunArea, 0.0, 1.0);
+	}
+
+	return 1.0 - lit;
+}
+
+vec3 CalcAtmosphereLight(vec3 fragPos, vec3 lightDir, vec3 normal, out vec3 skyLight) {
+
+	// Planet centred km, as the tables are made (Atmosphere.cpp)
+	float bottom = uAtmosphere.bottomRadius, top = uAtmosphere.topRadius;
+	vec3 p = (fragPos - uAtmosphere.center) * uAtmosphere.kmPerUnit;
+	float r = clamp(length(p), bottom, top);
+	vec3 up = normalize(p);
+	float muS = dot(up, lightDir);
+
+	// Transmittance to the top of the atmosphere towards the sun
+	float H = sqrt(top * top - bottom * bottom);
+	float rho = sqrt(max(r * r - bottom * bottom, 0.0));
+	float d = max(0.0, -r * muS + sqrt(max(r * r * (muS * muS - 1.0) + top * top, 0.0)));
+	float dMin = top - r, dMax = rho + H;
+	vec2 uv = vec2(
+		0.5 / 256.0 + (d - dMin) / (dMax - dMin) * (1.0 - 1.0 / 256.0),
+		0.5 / 64.0 + rho / H * (1.0 - 1.0 / 64.0));
+	// only the part of the sun's disc above the horizon
+	float sinH = bottom / r;
+	float cosH = -sqrt(max(1.0 - sinH * sinH, 0.0));
+	float disc = smoothstep(-sinH * uAtmosphere.sunAngularRadius, sinH * uAtmosphere.sunAngularRadius, muS - cosH);
+
+	// Sky irradiance is tabulated for a horizontal surface, a tilted one sees part of the sky
+	vec2 irradianceUv = vec2(
+		0.5 / 64.0 + (muS * 0.5 + 0.5) * (1.0 - 1.0 / 64.0),
+		0.5 / 16.0 + (r - bottom) / (top - bottom) * (1.0 - 1.0 / 16.0));
+	skyLight = texture(uIrradiance, irradianceUv).rgb * (1.0 + dot(normal, up)) * 0.5;
+
+	return texture(uTransmittance, uv).rgb * disc;
+}
+
+vec4 CalcClusteredLights(vec3 normal, vec3 viewDir, vec3 fragPos,
+	vec4 diffuse, float specular) {
+
+	// Froxel of this fragment: screen tile and exponential depth slice
+	float depth = -(uView * vec4(fragPos, 1.0)).z;
+	ivec3 cell = ivec3(
+		ivec2(gl_FragCoord.xy / uClusterTileSize),
+		int(floor(log(max(depth, 1e-4)) * uClusterDepth.x + uClusterDepth.y)));
+	cell = clamp(cell, ivec3(0), uClusterDims - 1);
+	int cluster = (cell.z * uClusterDims.y + cell.y) * uClusterDims.x + cell.x;
+	uvec2 range = texelFetch(uClusterGrid, cluster).rg;
+
+	vec4 result = vec4(0.0);
+	for (uint i = 0u; i < range.y; i++) {
+		int light = int(texelFetch(uLightIndices, int(range.x + i)).r) * 4;
+		vec4 positionRange = texelFetch(uLightData, light);
+		vec3 color = texelFetch(uLightData, light + 1).rgb;
+		vec4 attenuationOuter = texelFetch(uLightData, light + 2); // constant, linear, quadratic, outer cut off
+		vec4 directionInner = texelFetch(uLightData, light + 3);
+
+		vec3 toLight = positionRange.xyz - fragPos;
+		float distance = length(toLight);
+		if (distance >= positionRange.w)
+			continue;
+		vec3 lightDir = toLight / distance;
+
+		// Physics
+		float attenuation = 1.0 / (attenuationOuter.x + attenuationOuter.y*distance + attenuationOuter.z*distance*distance);
+		// Cone, always 1 for point lights (outer cut off below -1)
+		float theta = dot(lightDir, -directionInner.xyz);
+		float cone = clamp((theta - attenuationOuter.w) / max(directionInner.w - attenuationOuter.w, 1e-4), 0.0, 1.0);
+
+		// diffuse
+		float diffEff = max(dot(normal, lightDir), 0.0);
+		// specular
+		vec3 halfwayDir = normalize(lightDir + viewDir);
+		float specEff = pow(max(dot(normal, halfwayDir), 0.0), 32.0);
+
+		result += attenuation * cone * vec4(color, 0.0) * (diffEff * diffuse + specEff * specular);
+	}
+
+	return result;
+}
+
 vec4 CalcDirectionalLight(Directional_Light_t light, vec3 normal, vec3 viewDir,
-	vec2 texCoords, sampler2D diffuse, sampler2D specular) {
+	vec4 diffuse, float specular) {
 
 	vec4 ambientColor, diffuseColor, specularColor;
 
 	vec3 lightDir = normalize(-light.direction);
 
+	// through the atmosphere the sun reddens towards the terminator, and the sky lights the rest
+	vec3 sunLight = vec3(1.0), skyLight = vec3(0.0);
+	if (uEnableAtmosphere)
+		sunLight = CalcAtmosphereLight(fs_in.FragPos, lightDir, normal, skyLight);
+
 	// ambient
-	ambientColor = vec4(light.ambient, 1.0) * texture(diffuse, texCoords);
+	ambientColor = vec4(light.ambient, 1.0) * diffuse + vec4(skyLight * light.diffuse, 0.0) * diffuse;
 
 	// diffuse
 	float diffEff = max(dot(normal, lightDir), 0.0);
-	diffuseColor = diffEff * vec4(light.diffuse, 1.0) * texture(diffuse, texCoords);
+	diffuseColor = diffEff * vec4(light.diffuse * sunLight, 1.0) * diffuse;
 
 	// specular
 	//vec3 reflectDir = reflect(-lightDir, normal);
 	vec3 halfwayDir = normalize(lightDir + viewDir);
 	//float specEff = pow(max(dot(viewDir, reflectDir), 0.0), 64.0);
 	float specEff = pow(max(dot(normal, halfwayDir), 0.0), 32.0);
-	specularColor = specEff * vec4(light.specular, 1.0) * texture(specular, texCoords);
+	specularColor = specEff * vec4(light.specular * sunLight, 1.0) * specular;
 
-	float shadow = CalcParallelShadow(lightDir, normal);
+	float shadow = uShadowMode == 1 ? CalcSphereShadow(lightDir) : CalcParallelShadow(lightDir, normal);
 
 	// result
 	return ambientColor + (diffuseColor + specularColor) * (1.2 - shadow);
 }
 
 vec4 CalcPointLight(Point_Light_t light, vec3 normal, vec3 viewDir, vec3 fragPos,
-	vec2 texCoords, sampler2D diffuse, sampler2D specular) {
+	vec4 diffuse, float specular) {
 
 	vec4 ambientColor, diffuseColor, specularColor;
 
@@ -300,25 +518,25 @@ vec4 CalcPointLight(Point_Light_t light, vec3 normal, vec3 viewDir, vec3 fragPos
 	float attenuation = 1.0 / (light.constant + light.linear*distance + light.quadratic*distance*distance);
 
 	// ambient
-	ambientColor = vec4(light.ambient, 1.0) * texture(diffuse, texCoords);
+	ambientColor = vec4(light.ambient, 1.0) * diffuse;
 
 	// diffuse
 	float diffEff = max(dot(normal, lightDir), 0.0);
-	diffuseColor = diffEff * vec4(light.diffuse, 1.0) * texture(diffuse, texCoords);
+	diffuseColor = diffEff * vec4(light.diffuse, 1.0) * diffuse;
 
 	// specular
 	//vec3 reflectDir = reflect(-lightDir, normal);
 	vec3 halfwayDir = normalize(lightDir + viewDir);
 	//float specEff = pow(max(dot(viewDir, reflectDir), 0.0), 64.0);
 	float specEff = pow(max(dot(normal, halfwayDir), 0.0), 32.0);
-	specularColor = specEff * vec4(light.specular, 1.0) * texture(specular, texCoords);
+	specularColor = specEff * vec4(light.specular, 1.0) * specular;
 
 	// result
 	return attenuation * (ambientColor + diffuseColor + specularColor);
 }
 
 vec4 CalcSpotLight(Spot_Light_t light, vec3 normal, vec3 viewDir, vec3 fragPos,
-	vec2 texCoords, sampler2D diffuse, sampler2D specular) {
+	vec4 diffuse, float specular) {
 
 	vec4 ambientColor, diffuseColor, specularColor;
 
@@ -332,30 +550,30 @@ vec4 CalcSpotLight(Spot_Light_t light, vec3 normal, vec3 viewDir, vec3 fragPos,
 	float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
 
 	// Ambient lighting
-	ambientColor = vec4(light.ambient, 1.0) * texture(diffuse, texCoords);
+	ambientColor = vec4(light.ambient, 1.0) * diffuse;
 
 	// Diffuse lighting
 	float diffEff = max(dot(normal, lightDir), 0.0);
-	diffuseColor = diffEff * vec4(light.diffuse, 1.0) * texture(diffuse, texCoords);
+	diffuseColor = diffEff * vec4(light.diffuse, 1.0) * diffuse;
 
 	// Specular lighting
 	//vec3 reflectDir = reflect(-lightDir, normal);
 	vec3 halfwayDir = normalize(lightDir + viewDir);
 	//float specEff = pow(max(dot(viewDir, reflectDir), 0.0), 64.0);
 	float specEff = pow(max(dot(normal, halfwayDir), 0.0), 32.0);
-	specularColor = specEff * vec4(light.specular, 1.0) * texture(specular, texCoords);
+	specularColor = specEff * vec4(light.specular, 1.0) * specular;
 
 	// Result lighting
 	return attenuation * (ambientColor + (diffuseColor + specularColor) * intensity);
 }
 
-vec4 CalcEmission(vec2 texCoords, sampler2D emission, vec4 testLight) {
+vec4 CalcEmission(float emission, vec4 testLight) {
 
-	// emission
-	vec4 emissionColor = texture(emission, texCoords);
+	// emission, the packed map only keeps intensity so city lights get a fixed warm tint
+	vec4 emissionColor = vec4(emission * vec3(1.0, 0.9, 0.7), 1.0);
 
 	// Ignore black parts of emission texture, transparentize them
-	if (emissionColor.x < 0.3 || emissionColor.y < 0.3 || emissionColor.z < 0.3)
+	if (emission < 0.3)
 		emissionColor = vec4(0.0, 0.0, 0.0, 0.0);
 
 	// Turn off light if environment is bright enough (simulate city lighting)
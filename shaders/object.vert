@@ -10,29 +10,27 @@ out VS_OUT {
     vec3 FragPos;
     vec3 Normal;
     vec2 TexCoords;
-	vec4 FragPosLightSpace;
 	mat3 TBN;
 } vs_out;
 
 uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProjection;
-uniform mat4 uLightSpaceMatrix;
+uniform mat4 uModelViewProjection; // per draw, see RenderQueue
+uniform mat3 uNormalMatrix;        // per object and frame
 
-void main() {
+// Bit-identical to shadow.vert, the depth pre-pass is tested with GL_EQUAL
+invariant gl_Position;
 
-	gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0f);
+void main() {
 
-	mat3 normalMatrix = transpose(inverse(mat3(uModel)));
+	gl_Position = uModelViewProjection * vec4(aPos, 1.0f);
 
 	// To transform a vector V's components in tangent space to world space, TBN * V
-	vec3 T = normalize(normalMatrix * aTangent);
-	vec3 B = normalize(normalMatrix * aBitangent);
-	vec3 N = normalize(normalMatrix * aNormal);
+	vec3 T = normalize(uNormalMatrix * aTangent);
+	vec3 B = normalize(uNormalMatrix * aBitangent);
+	vec3 N = normalize(uNormalMatrix * aNormal);
 
 	vs_out.FragPos = vec3(uModel * vec4(aPos, 1.0));
-	vs_out.Normal = normalMatrix * aNormal;
+	vs_out.Normal = uNormalMatrix * aNormal;
 	vs_out.TexCoords = aTexCoords;
-	vs_out.FragPosLightSpace = uLightSpaceMatrix * vec4(vs_out.FragPos, 1.0);
 	vs_out.TBN = mat3(T, B, N);
 }
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 330 core
+
+out vec4 FragColor;
+
+uniform vec4 uColor; // alpha of a single particle, they add up
+
+void main() {
+
+	// Round sprites with a soft edge
+	float edge = length(gl_PointCoord * 2.0 - 1.0);
+	if (edge > 1.0)
+		discard;
+	FragColor = vec4(uColor.rgb, uColor.a * (1.0 - edge * edge));
+}
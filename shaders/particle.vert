@@ -0,0 +1,20 @@
+#version 330 core
+
+/**
+* N-body particles, one point each (see NBodyField.h and PointCloud.h).
+*/
+
+layout (location = 0) in vec4 aPosition; // Earth radii, w 0 for a particle that is gone
+
+/** Uniform variables */
+
+uniform mat4 uViewProjection;
+uniform mat4 uFieldToWorld;
+uniform float uPointSize; // pixels
+
+void main()
+{
+    // Particles that are gone go outside the clip volume
+    gl_Position = aPosition.w > 0.0 ? uViewProjection * uFieldToWorld * vec4(aPosition.xyz, 1.0) : vec4(2.0, 2.0, 2.0, 1.0);
+    gl_PointSize = uPointSize;
+}
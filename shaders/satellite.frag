@@ -0,0 +1,22 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in float Radius;
+
+uniform vec4 uHighlight; // one colour for every point when alpha is set
+
+void main() {
+
+	// Round sprites with a soft edge
+	float edge = length(gl_PointCoord * 2.0 - 1.0);
+	if (edge > 1.0)
+		discard;
+
+	// Low orbits cyan, medium yellow, geosynchronous and beyond red
+	vec3 low = vec3(0.3, 0.9, 1.0), medium = vec3(1.0, 0.85, 0.3), high = vec3(1.0, 0.35, 0.3);
+	vec3 color = Radius < 8400.0 ? low : (Radius < 35000.0 ? medium : high);
+	if (uHighlight.a > 0.0)
+		color = uHighlight.rgb;
+	FragColor = vec4(color, 1.0 - edge * edge);
+}
\ No newline at end of file
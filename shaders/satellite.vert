@@ -0,0 +1,23 @@
+#version 330 core
+
+/**
+* Satellites, one point each (see SatelliteCatalogue.h and PointCloud.h).
+*/
+
+layout (location = 0) in vec4 aPosition; // TEME km, w 0 for a failed satellite
+
+out float Radius; // km from the Earth's centre
+
+/** Uniform variables */
+
+uniform mat4 uViewProjection;
+uniform mat4 uTemeToWorld;
+uniform float uPointSize; // pixels
+
+void main()
+{
+    Radius = length(aPosition.xyz);
+    // Failed satellites go outside the clip volume
+    gl_Position = aPosition.w > 0.0 ? uViewProjection * uTemeToWorld * vec4(aPosition.xyz, 1.0) : vec4(2.0, 2.0, 2.0, 1.0);
+    gl_PointSize = uPointSize;
+}
\ No newline at end of file
@@ -3,11 +3,12 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec3 aTexCoords;
 
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProjection;
+uniform mat4 uModelViewProjection; // per draw, see RenderQueue
+
+// Also the depth pre-pass, must match object.vert bit for bit
+invariant gl_Position;
 
 void main()
 {
-    gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0);
+    gl_Position = uModelViewProjection * vec4(aPos, 1.0f);
 }
\ No newline at end of file
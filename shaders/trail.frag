@@ -0,0 +1,14 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec4 Color;
+in float Valid;
+
+void main() {
+
+	// No line across a gap in the samples
+	if (Valid < 0.999)
+		discard;
+	FragColor = Color;
+}
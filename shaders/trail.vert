@@ -0,0 +1,40 @@
+#version 330 core
+
+/**
+* Trails from a TrailRenderer (see TrailRenderer.h), with no vertex
+* attributes: each trail is a range of uLength vertices of the multi-draw,
+* drawn oldest sample first, and gl_VertexID picks the sample out of the ring.
+*/
+
+out vec4 Color;
+out float Valid; // 1 on samples, below on segments that reach a gap
+
+/** Uniform variables */
+
+uniform samplerBuffer uSamples;
+uniform int uTrails;
+uniform int uLength;
+uniform int uNewest; // row of the last sample
+uniform int uFilled; // rows with samples
+uniform int uFirstTrack;
+
+uniform mat4 uViewProjection;
+uniform mat4 uTrailToWorld;
+uniform mat4 uTrackToWorld; // trails from uFirstTrack on
+uniform vec4 uColor;
+uniform vec4 uTrackColor;
+
+void main()
+{
+    int trail = gl_VertexID / uLength;
+    int age = uFilled - 1 - gl_VertexID % uLength;
+    int row = (uNewest - age + uLength) % uLength;
+    vec4 sample = texelFetch(uSamples, row * uTrails + trail);
+
+    bool track = trail >= uFirstTrack;
+    gl_Position = uViewProjection * (track ? uTrackToWorld : uTrailToWorld) * vec4(sample.xyz, 1.0);
+    // Faded linearly with age, gone by the oldest sample the ring holds
+    Color = track ? uTrackColor : uColor;
+    Color.a *= 1.0 - float(age) / float(uLength);
+    Valid = sample.w;
+}